@@ -61,6 +61,23 @@
 # define VALUE_HIGH(val) 0
 #endif
 
+/*
+ * Without a host 16-byte compare-and-swap, fall back to the striped
+ * locks if enabled, and otherwise to serial execution.
+ */
+#if DATA_SIZE == 16 && !HAVE_CMPXCHG128
+# define ATOMIC16_CMPXCHG  atomic16_cmpxchg_locked
+# define ATOMIC16_CHECK_LOCKS(env, ra)                  \
+    do {                                                \
+        if (!atomic_locks_enabled) {                    \
+            cpu_loop_exit_atomic(env_cpu(env), ra);     \
+        }                                               \
+    } while (0)
+#else
+# define ATOMIC16_CMPXCHG  atomic16_cmpxchg
+# define ATOMIC16_CHECK_LOCKS(env, ra)  do { } while (0)
+#endif
+
 #if DATA_SIZE >= 4
 # define ABI_TYPE  DATA_TYPE
 #else
@@ -81,12 +98,12 @@ ABI_TYPE ATOMIC_NAME(cmpxchg)(CPUArchState *env, abi_ptr addr,
                               ABI_TYPE cmpv, ABI_TYPE newv,
                               MemOpIdx oi, uintptr_t retaddr)
 {
-    DATA_TYPE *haddr = atomic_mmu_lookup(env_cpu(env), addr, oi,
-                                         DATA_SIZE, retaddr);
-    DATA_TYPE ret;
+    DATA_TYPE *haddr, ret;
 
+    ATOMIC16_CHECK_LOCKS(env, retaddr);
+    haddr = atomic_mmu_lookup(env_cpu(env), addr, oi, DATA_SIZE, retaddr);
 #if DATA_SIZE == 16
-    ret = atomic16_cmpxchg(haddr, cmpv, newv);
+    ret = ATOMIC16_CMPXCHG(haddr, cmpv, newv);
 #else
     ret = qatomic_cmpxchg__nocheck(haddr, cmpv, newv);
 #endif
@@ -206,12 +223,12 @@ ABI_TYPE ATOMIC_NAME(cmpxchg)(CPUArchState *env, abi_ptr addr,
                               ABI_TYPE cmpv, ABI_TYPE newv,
                               MemOpIdx oi, uintptr_t retaddr)
 {
-    DATA_TYPE *haddr = atomic_mmu_lookup(env_cpu(env), addr, oi,
-                                         DATA_SIZE, retaddr);
-    DATA_TYPE ret;
+    DATA_TYPE *haddr, ret;
 
+    ATOMIC16_CHECK_LOCKS(env, retaddr);
+    haddr = atomic_mmu_lookup(env_cpu(env), addr, oi, DATA_SIZE, retaddr);
 #if DATA_SIZE == 16
-    ret = atomic16_cmpxchg(haddr, BSWAP(cmpv), BSWAP(newv));
+    ret = ATOMIC16_CMPXCHG(haddr, BSWAP(cmpv), BSWAP(newv));
 #else
     ret = qatomic_cmpxchg__nocheck(haddr, BSWAP(cmpv), BSWAP(newv));
 #endif
@@ -331,3 +348,5 @@ GEN_ATOMIC_HELPER_FN(add_fetch, ADD, DATA_TYPE, new)
 #undef SHIFT
 #undef VALUE_LOW
 #undef VALUE_HIGH
+#undef ATOMIC16_CMPXCHG
+#undef ATOMIC16_CHECK_LOCKS
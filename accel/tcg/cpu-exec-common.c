@@ -21,9 +21,95 @@
 #include "sysemu/cpus.h"
 #include "sysemu/tcg.h"
 #include "qemu/plugin.h"
+#include "qemu/cacheinfo.h"
+#include "qemu/memalign.h"
 #include "internal-common.h"
 
 bool tcg_allowed;
+bool atomic_locks_enabled;
+
+/*
+ * Wide atomic operations that the host cannot perform natively are
+ * serialized with an array of spinlocks, indexed by the 16-byte granule
+ * of the host address, so that only vCPUs accessing the same granules
+ * (or colliding in the hash) wait for each other.  As in util/atomic64.c,
+ * each lock is padded to the host's dcache line size.
+ *
+ * The operations are atomic with respect to each other only, see
+ * atomic16_cmpxchg_locked().
+ */
+#define NR_ATOMIC_LOCKS 256
+
+static void *atomic_lock_array;
+static size_t atomic_lock_size;
+
+/* The lock held by this thread, to be dropped if the access faults. */
+static __thread QemuSpin *atomic_lock_held;
+
+void atomic_locks_init(void)
+{
+    atomic_lock_size = ROUND_UP(sizeof(QemuSpin), qemu_dcache_linesize);
+    atomic_lock_array = qemu_memalign(qemu_dcache_linesize,
+                                      atomic_lock_size * NR_ATOMIC_LOCKS);
+    for (int i = 0; i < NR_ATOMIC_LOCKS; i++) {
+        qemu_spin_init(atomic_lock_array + i * atomic_lock_size);
+    }
+    atomic_locks_enabled = true;
+}
+
+static void atomic_lock(const void *haddr)
+{
+    uintptr_t idx = (uintptr_t)haddr >> 4;
+    QemuSpin *lock;
+
+    idx ^= (idx >> 8) ^ (idx >> 16);
+    lock = atomic_lock_array + (idx & (NR_ATOMIC_LOCKS - 1)) * atomic_lock_size;
+    qemu_spin_lock(lock);
+    atomic_lock_held = lock;
+}
+
+static void atomic_unlock(void)
+{
+    qemu_spin_unlock(atomic_lock_held);
+    atomic_lock_held = NULL;
+}
+
+/*
+ * Compare and swap 16 aligned bytes at @p, atomically with respect to
+ * the other atomic16_*_locked() functions.  An access that does not go
+ * through them, such as a host 8-byte atomic operation on one half of
+ * the granule, may still be lost, which is why the locks must be
+ * enabled explicitly.
+ */
+Int128 atomic16_cmpxchg_locked(Int128 *p, Int128 cmp, Int128 new)
+{
+    Int128 old;
+
+    atomic_lock(p);
+    old = *p;
+    if (int128_eq(old, cmp)) {
+        *p = new;
+    }
+    atomic_unlock();
+    return old;
+}
+
+Int128 atomic16_read_locked(Int128 *p)
+{
+    Int128 val;
+
+    atomic_lock(p);
+    val = *p;
+    atomic_unlock();
+    return val;
+}
+
+void atomic16_set_locked(Int128 *p, Int128 val)
+{
+    atomic_lock(p);
+    *p = val;
+    atomic_unlock();
+}
 
 /* exit the current TB, but without causing any exception to be raised */
 void cpu_loop_exit_noexc(CPUState *cpu)
@@ -34,6 +120,10 @@ void cpu_loop_exit_noexc(CPUState *cpu)
 
 void cpu_loop_exit(CPUState *cpu)
 {
+    /* A user-mode guest may have unmapped the memory under the lock. */
+    if (unlikely(atomic_lock_held)) {
+        atomic_unlock();
+    }
     /* Undo the setting in cpu_tb_exec.  */
     cpu->neg.can_do_io = true;
     /* Undo any setting in generated code.  */
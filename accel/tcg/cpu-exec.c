@@ -194,11 +194,17 @@ static bool tb_lookup_cmp(const void *p, const void *d)
         tb_page_addr0(tb) == desc->page_addr0 &&
         tb->cs_base == desc->cs_base &&
         tb->flags == desc->flags &&
-        tb_cflags(tb) == desc->cflags) {
+        (tb_cflags(tb) & ~CF_TIER2) == desc->cflags) {
         /* check next page if needed */
         tb_page_addr_t tb_phys_page1 = tb_page_addr1(tb);
         if (tb_phys_page1 == -1) {
             return true;
+        } else if (!desc->env) {
+            /*
+             * Lookup without a vCPU, see tb_htable_lookup_phys().
+             * The code starting at desc->pc runs into the next page.
+             */
+            return true;
         } else {
             tb_page_addr_t phys_page1;
             vaddr virt_page1;
@@ -245,6 +251,31 @@ static TranslationBlock *tb_htable_lookup(CPUState *cpu, vaddr pc,
     return qht_lookup_custom(&tb_ctx.htable, &desc, h, tb_lookup_cmp);
 }
 
+#ifndef CONFIG_USER_ONLY
+/*
+ * Like tb_htable_lookup(), for a caller that already knows the physical
+ * address of @pc and has no vCPU TLB to translate it with.  A TB that
+ * spans two pages matches regardless of its second page.
+ */
+TranslationBlock *tb_htable_lookup_phys(tb_page_addr_t phys_pc, vaddr pc,
+                                        uint64_t cs_base, uint32_t flags,
+                                        uint32_t cflags)
+{
+    struct tb_desc desc;
+    uint32_t h;
+
+    desc.env = NULL;
+    desc.cs_base = cs_base;
+    desc.flags = flags;
+    desc.cflags = cflags;
+    desc.pc = pc;
+    desc.page_addr0 = phys_pc;
+    h = tb_hash_func(phys_pc, (cflags & CF_PCREL ? 0 : pc),
+                     flags, cs_base, cflags);
+    return qht_lookup_custom(&tb_ctx.htable, &desc, h, tb_lookup_cmp);
+}
+#endif
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
                                           uint64_t cs_base, uint32_t flags,
@@ -265,7 +296,7 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
                jc->array[hash].pc == pc &&
                tb->cs_base == cs_base &&
                tb->flags == flags &&
-               tb_cflags(tb) == cflags)) {
+               (tb_cflags(tb) & ~CF_TIER2) == cflags)) {
         goto hit;
     }
 
@@ -433,6 +464,27 @@ const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
     return tb->tc.ptr;
 }
 
+/*
+ * helper_ras_push: record a guest call in the return-address stack
+ *
+ * The prediction for the return is the TB that the jump cache has for
+ * @pc at the time of the call, if any.  translator_ras_return() checks
+ * that it is still valid for the CPU state when the return happens.
+ */
+void HELPER(ras_push)(CPUArchState *env, uint64_t pc)
+{
+    CPUState *cpu = env_cpu(env);
+    CPUReturnStack *ras = &cpu->tb_ras;
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
+    uint32_t hash = tb_jmp_cache_hash_func(pc);
+    TranslationBlock *tb = qatomic_read(&jc->array[hash].tb);
+    unsigned i = ras->top++ % TB_RAS_SIZE;
+
+    ras->ent[i].pc = pc;
+    qatomic_set(&ras->ent[i].tb,
+                tb && jc->array[hash].pc == pc ? tb : NULL);
+}
+
 /* Execute a TB, and fix up the CPU state afterwards if necessary */
 /*
  * Disable CFI checks.
@@ -579,6 +631,7 @@ void cpu_exec_step_atomic(CPUState *cpu)
         g_assert(cpu == current_cpu);
         g_assert(!cpu->running);
         cpu->running = true;
+        qatomic_inc(&tb_ctx.tb_atomic_step_count);
 
         cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
 
@@ -636,6 +689,12 @@ void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr)
     tb_target_set_jmp_target(c_tb, n, jmp_rx, jmp_rw);
 }
 
+static inline bool tb_jmp_is_xpage(const TranslationBlock *tb,
+                                   const TranslationBlock *tb_next)
+{
+    return (tb_page_addr0(tb) ^ tb_page_addr0(tb_next)) & TARGET_PAGE_MASK;
+}
+
 static inline void tb_add_jump(TranslationBlock *tb, int n,
                                TranslationBlock *tb_next)
 {
@@ -655,6 +714,9 @@ static inline void tb_add_jump(TranslationBlock *tb, int n,
     if (old) {
         goto out_unlock_next;
     }
+    if (tb_jmp_is_xpage(tb, tb_next)) {
+        qatomic_inc(&tb_ctx.tb_xpage_link_count);
+    }
 
     /* patch the native jump address */
     tb_set_jmp_target(tb, n, (uintptr_t)tb_next->tc.ptr);
@@ -741,6 +803,10 @@ static inline bool cpu_handle_exception(CPUState *cpu, int *ret)
     const TCGCPUOps *tcg_ops = cpu->cc->tcg_ops;
     tcg_ops->fake_user_interrupt(cpu);
 #endif /* TARGET_I386 */
+    if (cpu_vdso_syscall(cpu)) {
+        cpu->exception_index = -1;
+        return false;
+    }
     *ret = cpu->exception_index;
     cpu->exception_index = -1;
     return true;
@@ -906,6 +972,11 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
 {
     trace_exec_tb(tb, pc);
     tb = cpu_tb_exec(cpu, tb, tb_exit);
+    if (unlikely(*tb_exit == TB_EXIT_PROMOTE)) {
+        *last_tb = NULL;
+        tb_promote(cpu, tb);
+        return;
+    }
     if (*tb_exit != TB_EXIT_REQUESTED) {
         *last_tb = tb;
         return;
@@ -941,7 +1012,8 @@ static inline void cpu_loop_exec_tb(CPUState *cpu, TranslationBlock *tb,
     if (insns_left > 0 && insns_left < tb->icount)  {
         assert(insns_left <= CF_COUNT_MASK);
         assert(cpu->icount_extra == 0);
-        cpu->cflags_next_tb = (tb->cflags & ~CF_COUNT_MASK) | insns_left;
+        cpu->cflags_next_tb = (tb->cflags & ~(CF_COUNT_MASK | CF_TIER2))
+                              | insns_left;
     }
 #endif
 }
@@ -985,6 +1057,10 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
             }
 
             tb = tb_lookup(cpu, pc, cs_base, flags, cflags);
+            if (tb == NULL && tb_workers_wait(pc, cs_base, flags, cflags)) {
+                /* A translation worker was busy with this very block. */
+                tb = tb_lookup(cpu, pc, cs_base, flags, cflags);
+            }
             if (tb == NULL) {
                 CPUJumpCache *jc;
                 uint32_t h;
@@ -1099,6 +1175,7 @@ void tcg_exec_unrealizefn(CPUState *cpu)
     tcg_iommu_free_notifier_list(cpu);
 #endif /* !CONFIG_USER_ONLY */
 
+    tb_workers_forget_cpu(cpu);
     tlb_destroy(cpu);
     g_free_rcu(cpu->tb_jmp_cache, rcu);
 }
@@ -167,6 +167,7 @@ static void tb_jmp_cache_clear_page(CPUState *cpu, vaddr page_addr)
     for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
         qatomic_set(&jc->array[i0 + i].tb, NULL);
     }
+    tb_ras_clear(cpu);
 }
 
 /**
@@ -287,8 +288,7 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
 {
     desc->n_used_entries = 0;
-    desc->large_page_addr = -1;
-    desc->large_page_mask = -1;
+    desc->n_large_pages = 0;
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
     memset(desc->vtable, -1, sizeof(desc->vtable));
@@ -326,6 +326,157 @@ static inline void tlb_n_used_entries_dec(CPUState *cpu, uintptr_t mmu_idx)
     cpu->neg.tlb.d[mmu_idx].n_used_entries--;
 }
 
+/*
+ * Page table walk cache: a direct-mapped cache of table descriptors,
+ * in which targets look before loading a descriptor from guest memory
+ * during a page table walk.  Like the paging-structure caches of real
+ * hardware, it saves the memory accesses (and, for a stage 1 table
+ * behind stage 2, the stage 2 translation) for the upper levels of
+ * the tables, which are shared by many pages.
+ *
+ * The RAM pages that hold cached descriptors are write protected with
+ * the code dirty bits, like pages with translated code, and are noted
+ * in tlb_walk_pages.  A store to one of them bumps tlb_walk_gen, which
+ * empties the cache of every vCPU at its next lookup.  The protection
+ * is lifted when the last TB of a page goes away, and a store may race
+ * with a walk on another vCPU, so page flushes also check the cached
+ * descriptors against memory: the architectures require one after a
+ * table descriptor is changed.
+ */
+#define TLB_WALK_PAGES_BITS 12
+
+/* Filter of the pages holding cached descriptors; bits are never cleared */
+static unsigned long tlb_walk_pages[BITS_TO_LONGS(1 << TLB_WALK_PAGES_BITS)];
+static unsigned tlb_walk_gen;
+
+static inline long tlb_walk_page_bit(ram_addr_t ram_addr)
+{
+    return (ram_addr >> TARGET_PAGE_BITS) &
+           MAKE_64BIT_MASK(0, TLB_WALK_PAGES_BITS);
+}
+
+static uint64_t tlb_walk_load(const CPUTLBWalkEntry *e)
+{
+    switch (e->memop) {
+    case MO_LEUL:
+        return ldl_le_p(e->host);
+    case MO_BEUL:
+        return ldl_be_p(e->host);
+    case MO_LEUQ:
+        return ldq_le_p(e->host);
+    case MO_BEUQ:
+        return ldq_be_p(e->host);
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static inline CPUTLBWalkEntry *tlb_walk_entry(CPUState *cpu, int mmu_idx,
+                                              hwaddr addr)
+{
+    unsigned index = (addr >> 3) ^ (addr >> (3 + CPU_TLB_WALK_BITS)) ^ mmu_idx;
+
+    return &cpu->neg.tlb.c.walk[index & MAKE_64BIT_MASK(0, CPU_TLB_WALK_BITS)];
+}
+
+bool tlb_walk_cache_lookup(CPUState *cpu, int mmu_idx, hwaddr addr,
+                           uint64_t *pval)
+{
+    CPUTLBWalkEntry *e = tlb_walk_entry(cpu, mmu_idx, addr);
+    unsigned gen = qatomic_load_acquire(&tlb_walk_gen);
+
+    assert_cpu_is_self(cpu);
+    if (unlikely(gen != cpu->neg.tlb.c.walk_gen)) {
+        /* A cached descriptor may have been changed. */
+        tlb_walk_cache_flush(cpu);
+        cpu->neg.tlb.c.walk_gen = gen;
+    }
+    if (e->addr == addr && e->mmu_idx == mmu_idx) {
+        *pval = e->val;
+        qatomic_set(&cpu->neg.tlb.c.walk_hit_count,
+                    cpu->neg.tlb.c.walk_hit_count + 1);
+        return true;
+    }
+    qatomic_set(&cpu->neg.tlb.c.walk_miss_count,
+                cpu->neg.tlb.c.walk_miss_count + 1);
+    return false;
+}
+
+void tlb_walk_cache_insert(CPUState *cpu, int mmu_idx, hwaddr addr,
+                           uint64_t val, void *host, MemOp memop)
+{
+    CPUTLBWalkEntry *e = tlb_walk_entry(cpu, mmu_idx, addr);
+    ram_addr_t ram_addr;
+
+    assert_cpu_is_self(cpu);
+    WITH_RCU_READ_LOCK_GUARD() {
+        ram_addr = qemu_ram_addr_from_host(host);
+    }
+    if (ram_addr == RAM_ADDR_INVALID) {
+        return;
+    }
+
+    set_bit_atomic(tlb_walk_page_bit(ram_addr), tlb_walk_pages);
+    if (cpu_physical_memory_get_dirty_flag(ram_addr, DIRTY_MEMORY_CODE)) {
+        tlb_protect_code(ram_addr);
+    }
+
+    e->addr = addr;
+    e->val = val;
+    e->host = host;
+    e->mmu_idx = mmu_idx;
+    e->memop = memop;
+
+    /* A store before the page was protected was not seen. */
+    if (tlb_walk_load(e) != val) {
+        e->addr = -1;
+    }
+}
+
+/* Called for a store to @ram_addr, which is write protected. */
+static void tlb_walk_cache_notdirty(ram_addr_t ram_addr)
+{
+    if (test_bit(tlb_walk_page_bit(ram_addr), tlb_walk_pages)) {
+        qatomic_inc(&tlb_walk_gen);
+    }
+}
+
+/*
+ * Called for a flush of [@addr, @addr + @len) in @idxmap.  Drop the
+ * descriptors loaded from there through @idxmap, e.g. a stage 2 flush
+ * of the intermediate physical address of a table.  Keep the others
+ * only if memory still holds them.
+ */
+static void tlb_walk_cache_flush_range(CPUState *cpu, vaddr addr,
+                                       vaddr len, uint16_t idxmap)
+{
+    for (int i = 0; i < ARRAY_SIZE(cpu->neg.tlb.c.walk); i++) {
+        CPUTLBWalkEntry *e = &cpu->neg.tlb.c.walk[i];
+
+        if (e->addr == -1) {
+            continue;
+        }
+        if ((((idxmap >> e->mmu_idx) & 1) && e->addr - addr < len) ||
+            tlb_walk_load(e) != e->val) {
+            e->addr = -1;
+        }
+    }
+}
+
+void tlb_walk_cache_discard(CPUState *cpu, int mmu_idx, hwaddr addr)
+{
+    CPUTLBWalkEntry *e = tlb_walk_entry(cpu, mmu_idx, addr);
+
+    if (e->addr == addr && e->mmu_idx == mmu_idx) {
+        e->addr = -1;
+    }
+}
+
+void tlb_walk_cache_flush(CPUState *cpu)
+{
+    memset(cpu->neg.tlb.c.walk, -1, sizeof(cpu->neg.tlb.c.walk));
+}
+
 void tlb_init(CPUState *cpu)
 {
     int64_t now = get_clock_realtime();
@@ -335,6 +486,7 @@ void tlb_init(CPUState *cpu)
 
     /* All tlbs are initialized flushed. */
     cpu->neg.tlb.c.dirty = 0;
+    tlb_walk_cache_flush(cpu);
 
     for (i = 0; i < NB_MMU_MODES; i++) {
         tlb_mmu_init(&cpu->neg.tlb.d[i], &cpu->neg.tlb.f[i], now);
@@ -399,6 +551,7 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
 
     tcg_flush_jmp_cache(cpu);
+    tlb_walk_cache_flush(cpu);
 
     if (to_clean == ALL_MMUIDX_BITS) {
         qatomic_set(&cpu->neg.tlb.c.full_flush_count,
@@ -507,25 +660,78 @@ static inline void tlb_flush_vtlb_page_locked(CPUState *cpu, int mmu_idx,
     tlb_flush_vtlb_page_mask_locked(cpu, mmu_idx, page, -1);
 }
 
-static void tlb_flush_page_locked(CPUState *cpu, int midx, vaddr page)
+/* Called with tlb_c.lock held */
+static void tlb_flush_large_page_locked(CPUState *cpu, int midx,
+                                        const CPUTLBLargePage *lp)
 {
-    vaddr lp_addr = cpu->neg.tlb.d[midx].large_page_addr;
-    vaddr lp_mask = cpu->neg.tlb.d[midx].large_page_mask;
+    CPUTLBDescFast *f = &cpu->neg.tlb.f[midx];
+    size_t n_entries = tlb_n_entries(f);
+    vaddr n_pages = (~lp->mask >> TARGET_PAGE_BITS) + 1;
 
-    /* Check if we need to flush due to large pages.  */
-    if ((page & lp_mask) == lp_addr) {
-        tlb_debug("forcing full flush midx %d (%016"
-                  VADDR_PRIx "/%016" VADDR_PRIx ")\n",
-                  midx, lp_addr, lp_mask);
-        tlb_flush_one_mmuidx_locked(cpu, midx, get_clock_realtime());
+    tlb_debug("flushing large pages midx %d (%016"
+              VADDR_PRIx "/%016" VADDR_PRIx ")\n",
+              midx, lp->addr, lp->mask);
+
+    /*
+     * Every page of the region may be in the tlb.  Look them up one
+     * by one if that is quicker than scanning the whole table.
+     */
+    if (n_pages <= n_entries) {
+        for (vaddr i = 0; i < n_pages; i++) {
+            vaddr page = lp->addr + (i << TARGET_PAGE_BITS);
+
+            if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
+                tlb_n_used_entries_dec(cpu, midx);
+            }
+        }
     } else {
-        if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
-            tlb_n_used_entries_dec(cpu, midx);
+        for (size_t i = 0; i < n_entries; i++) {
+            if (tlb_flush_entry_mask_locked(&f->table[i],
+                                            lp->addr, lp->mask)) {
+                tlb_n_used_entries_dec(cpu, midx);
+            }
+        }
+    }
+    tlb_flush_vtlb_page_mask_locked(cpu, midx, lp->addr, lp->mask);
+}
+
+/*
+ * Flush the large page regions of @midx that intersect the range
+ * [@addr, @addr + @len - 1], and forget about them.
+ * Called with tlb_c.lock held.
+ */
+static void tlb_flush_large_pages_locked(CPUState *cpu, int midx,
+                                         vaddr addr, vaddr len)
+{
+    CPUTLBDesc *d = &cpu->neg.tlb.d[midx];
+    vaddr last = addr + len - 1;
+    unsigned i = 0;
+
+    while (i < d->n_large_pages) {
+        CPUTLBLargePage lp = d->large_pages[i];
+
+        if (lp.addr <= last && addr <= (lp.addr | ~lp.mask)) {
+            d->large_pages[i] = d->large_pages[--d->n_large_pages];
+            tlb_flush_large_page_locked(cpu, midx, &lp);
+            qatomic_set(&cpu->neg.tlb.c.large_flush_count,
+                        cpu->neg.tlb.c.large_flush_count + 1);
+        } else {
+            i++;
         }
-        tlb_flush_vtlb_page_locked(cpu, midx, page);
     }
 }
 
+static void tlb_flush_page_locked(CPUState *cpu, int midx, vaddr page)
+{
+    /* Check if we need to flush due to large pages.  */
+    tlb_flush_large_pages_locked(cpu, midx, page, TARGET_PAGE_SIZE);
+
+    if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
+        tlb_n_used_entries_dec(cpu, midx);
+    }
+    tlb_flush_vtlb_page_locked(cpu, midx, page);
+}
+
 /**
  * tlb_flush_page_by_mmuidx_async_0:
  * @cpu: cpu on which to flush
@@ -552,6 +758,7 @@ static void tlb_flush_page_by_mmuidx_async_0(CPUState *cpu,
         }
     }
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
+    tlb_walk_cache_flush_range(cpu, addr, TARGET_PAGE_SIZE, idxmap);
 
     /*
      * Discard jump cache entries for any tb which might potentially
@@ -672,7 +879,6 @@ static void tlb_flush_range_locked(CPUState *cpu, int midx,
                                    vaddr addr, vaddr len,
                                    unsigned bits)
 {
-    CPUTLBDesc *d = &cpu->neg.tlb.d[midx];
     CPUTLBDescFast *f = &cpu->neg.tlb.f[midx];
     vaddr mask = MAKE_64BIT_MASK(0, bits);
 
@@ -694,18 +900,8 @@ static void tlb_flush_range_locked(CPUState *cpu, int midx,
         return;
     }
 
-    /*
-     * Check if we need to flush due to large pages.
-     * Because large_page_mask contains all 1's from the msb,
-     * we only need to test the end of the range.
-     */
-    if (((addr + len - 1) & d->large_page_mask) == d->large_page_addr) {
-        tlb_debug("forcing full flush midx %d ("
-                  "%016" VADDR_PRIx "/%016" VADDR_PRIx ")\n",
-                  midx, d->large_page_addr, d->large_page_mask);
-        tlb_flush_one_mmuidx_locked(cpu, midx, get_clock_realtime());
-        return;
-    }
+    /* Check if we need to flush due to large pages.  */
+    tlb_flush_large_pages_locked(cpu, midx, addr, len);
 
     for (vaddr i = 0; i < len; i += TARGET_PAGE_SIZE) {
         vaddr page = addr + i;
@@ -742,6 +938,7 @@ static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
         }
     }
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
+    tlb_walk_cache_flush_range(cpu, d.addr, d.len, d.idxmap);
 
     /*
      * If the length is larger than the jump cache size, then it will take
@@ -985,28 +1182,56 @@ static void tlb_set_dirty(CPUState *cpu, vaddr addr)
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
 }
 
-/* Our TLB does not support large pages, so remember the area covered by
-   large pages and trigger a full TLB flush if these are invalidated.  */
+/*
+ * Our TLB does not support large pages, so remember the areas covered
+ * by large pages, and flush all of an area if any page in it is
+ * invalidated.  Once all CPU_TLB_LARGE_PAGES slots are in use, extend
+ * the area that grows the least to include the new page.  This is a
+ * compromise between unnecessary flushes and the cost of maintaining
+ * a full variable size TLB.
+ */
 static void tlb_add_large_page(CPUState *cpu, int mmu_idx,
                                vaddr addr, uint64_t size)
 {
-    vaddr lp_addr = cpu->neg.tlb.d[mmu_idx].large_page_addr;
+    CPUTLBDesc *d = &cpu->neg.tlb.d[mmu_idx];
     vaddr lp_mask = ~(size - 1);
+    CPUTLBLargePage *best = NULL;
+    vaddr best_mask = 0;
+    unsigned i;
 
-    if (lp_addr == (vaddr)-1) {
-        /* No previous large page.  */
-        lp_addr = addr;
-    } else {
-        /* Extend the existing region to include the new page.
-           This is a compromise between unnecessary flushes and
-           the cost of maintaining a full variable size TLB.  */
-        lp_mask &= cpu->neg.tlb.d[mmu_idx].large_page_mask;
-        while (((lp_addr ^ addr) & lp_mask) != 0) {
-            lp_mask <<= 1;
+    addr &= lp_mask;
+    for (i = 0; i < d->n_large_pages; i++) {
+        CPUTLBLargePage *lp = &d->large_pages[i];
+
+        /* Already covered? */
+        if ((addr & lp->mask) == lp->addr && (lp->mask & ~lp_mask) == 0) {
+            return;
+        }
+    }
+
+    if (d->n_large_pages < CPU_TLB_LARGE_PAGES) {
+        d->large_pages[d->n_large_pages++] = (CPUTLBLargePage) {
+            .addr = addr,
+            .mask = lp_mask,
+        };
+        return;
+    }
+
+    for (i = 0; i < CPU_TLB_LARGE_PAGES; i++) {
+        CPUTLBLargePage *lp = &d->large_pages[i];
+        vaddr mask = lp->mask & lp_mask;
+
+        while (((lp->addr ^ addr) & mask) != 0) {
+            mask <<= 1;
+        }
+        /* A larger mask describes a smaller area. */
+        if (!best || mask > best_mask) {
+            best = lp;
+            best_mask = mask;
         }
     }
-    cpu->neg.tlb.d[mmu_idx].large_page_addr = lp_addr & lp_mask;
-    cpu->neg.tlb.d[mmu_idx].large_page_mask = lp_mask;
+    best->addr &= best_mask;
+    best->mask = best_mask;
 }
 
 static inline void tlb_set_compare(CPUTLBEntryFull *full, CPUTLBEntry *ent,
@@ -1332,6 +1557,7 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
     trace_memory_notdirty_write_access(mem_vaddr, ram_addr, size);
 
     if (!cpu_physical_memory_get_dirty_flag(ram_addr, DIRTY_MEMORY_CODE)) {
+        tlb_walk_cache_notdirty(ram_addr);
         tb_invalidate_phys_range_fast(ram_addr, size, retaddr);
     }
 
@@ -1518,6 +1744,19 @@ void *tlb_vaddr_to_host(CPUArchState *env, abi_ptr addr,
     return flags ? NULL : host;
 }
 
+void *tlb_vaddr_to_host_nofill(CPUArchState *env, abi_ptr addr,
+                               MMUAccessType access_type, int mmu_idx)
+{
+    CPUTLBEntry *entry = tlb_entry(env_cpu(env), mmu_idx, addr);
+    uint64_t tlb_addr = tlb_read_idx(entry, access_type);
+
+    /* Any flag, TLB_INVALID_MASK included, rules out direct access. */
+    if (tlb_addr != (addr & TARGET_PAGE_MASK)) {
+        return NULL;
+    }
+    return (void *)((uintptr_t)addr + entry->addend);
+}
+
 /*
  * Return a ram_addr_t for the virtual address for execution.
  *
@@ -2886,10 +3125,8 @@ static void do_st16_mmu(CPUState *cpu, vaddr addr, Int128 val,
 #include "atomic_template.h"
 #endif
 
-#if defined(CONFIG_ATOMIC128) || HAVE_CMPXCHG128
 #define DATA_SIZE 16
 #include "atomic_template.h"
-#endif
 
 /* Code access functions.  */
 
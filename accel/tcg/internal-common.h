@@ -9,6 +9,7 @@
 #ifndef ACCEL_TCG_INTERNAL_COMMON_H
 #define ACCEL_TCG_INTERNAL_COMMON_H
 
+#include "qemu/int128.h"
 #include "exec/cpu-common.h"
 #include "exec/translation-block.h"
 
@@ -16,6 +17,37 @@ extern int64_t max_delay;
 extern int64_t max_advance;
 
 extern bool one_insn_per_tb;
+extern uint32_t tb_tier2_threshold;
+extern unsigned tb_n_workers;
+extern bool tb_ras_enabled;
+extern bool atomic_locks_enabled;
+
+/*
+ * Fallbacks for 16-byte atomic operations that the host does not
+ * support, used instead of cpu_loop_exit_atomic() if enabled by the
+ * atomic-locks accelerator property.
+ */
+void atomic_locks_init(void);
+Int128 atomic16_cmpxchg_locked(Int128 *p, Int128 cmp, Int128 new);
+Int128 atomic16_read_locked(Int128 *p);
+void atomic16_set_locked(Int128 *p, Int128 val);
+
+void tb_ras_clear(CPUState *cpu);
+
+/*
+ * Per-TB execution counter for hot TB promotion.  These live outside
+ * code_gen_buffer, so that the stores from generated code do not share
+ * cache lines with host code.
+ */
+typedef struct TBExecCounter {
+    uint64_t count;     /* updated without atomics by generated code */
+    uint16_t icount;    /* guest insns in the TB */
+    bool tier2;         /* the TB is a tier-2 translation */
+} TBExecCounter;
+
+TBExecCounter *tb_exec_counter_new(void);
+void tb_exec_counter_release(TBExecCounter *counter);
+void tb_exec_counter_stats(uint64_t *tier1_insns, uint64_t *tier2_insns);
 
 /*
  * Return true if CS is not running in parallel with other cpus, either
@@ -46,6 +78,8 @@ static inline bool cpu_plugin_mem_cbs_enabled(const CPUState *cpu)
 TranslationBlock *tb_gen_code(CPUState *cpu, vaddr pc,
                               uint64_t cs_base, uint32_t flags,
                               int cflags);
+void tb_promote(CPUState *cpu, TranslationBlock *tb);
+void tb_evict(CPUState *cpu);
 void page_init(void);
 void tb_htable_init(void);
 void tb_reset_jump(TranslationBlock *tb, int n);
@@ -11,6 +11,7 @@
 
 #include "exec/exec-all.h"
 #include "exec/translate-all.h"
+#include "tcg/tcg.h"
 
 /*
  * Access to the various translations structures need to be serialised
@@ -71,6 +72,59 @@ G_NORETURN void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr);
 
 bool tb_invalidate_phys_page_unwind(tb_page_addr_t addr, uintptr_t pc);
 
+#ifdef CONFIG_USER_ONLY
+TranslationBlock *tb_pcache_lookup(tb_page_addr_t phys_pc, uint64_t cs_base,
+                                   uint32_t flags, uint32_t cflags);
+void tb_pcache_flush(void);
+#endif
+
+TranslationBlock *tb_gen_code_host(CPUState *cpu, vaddr pc,
+                                   uint64_t cs_base, uint32_t flags,
+                                   int cflags, tb_page_addr_t phys_pc,
+                                   void *host_pc);
+
+#ifdef CONFIG_USER_ONLY
+static inline void tb_workers_queue_successors(CPUState *cpu,
+                                               TranslationBlock *tb,
+                                               vaddr pc,
+                                               tb_page_addr_t phys_pc,
+                                               void *host_pc) { }
+static inline bool tb_workers_wait(vaddr pc, uint64_t cs_base,
+                                   uint32_t flags, uint32_t cflags)
+{
+    return false;
+}
+static inline void tb_workers_pause(void) { }
+static inline void tb_workers_resume(void) { }
+static inline void tb_workers_forget_cpu(CPUState *cpu) { }
+static inline void tb_worker_check_fetch(void) { }
+#else
+TranslationBlock *tb_htable_lookup_phys(tb_page_addr_t phys_pc, vaddr pc,
+                                        uint64_t cs_base, uint32_t flags,
+                                        uint32_t cflags);
+void tb_workers_init(unsigned n);
+void tb_workers_queue_successors(CPUState *cpu, TranslationBlock *tb,
+                                 vaddr pc, tb_page_addr_t phys_pc,
+                                 void *host_pc);
+bool tb_workers_wait(vaddr pc, uint64_t cs_base,
+                     uint32_t flags, uint32_t cflags);
+void tb_workers_pause(void);
+void tb_workers_resume(void);
+void tb_workers_forget_cpu(CPUState *cpu);
+
+/*
+ * Translation workers have no softmmu TLB of their own.  Called by the
+ * translator before it fetches code through the TLB of the vCPU: a
+ * worker abandons the block instead, see setjmp_gen_code().
+ */
+static inline void tb_worker_check_fetch(void)
+{
+    if (unlikely(tcg_ctx && tcg_ctx->speculative)) {
+        siglongjmp(tcg_ctx->jmp_trans, -4);
+    }
+}
+#endif
+
 /* Return the current PC from CPU, which may be cached in TB. */
 static inline vaddr log_pc(CPUState *cpu, const TranslationBlock *tb)
 {
@@ -48,8 +48,11 @@ static void dump_accel_info(GString *buf)
                                                     &error_fatal);
 
     g_string_append_printf(buf, "Accelerator settings:\n");
-    g_string_append_printf(buf, "one-insn-per-tb: %s\n\n",
+    g_string_append_printf(buf, "one-insn-per-tb: %s\n",
                            one_insn_per_tb ? "on" : "off");
+    g_string_append_printf(buf, "tier2-threshold: %" PRIu32 "\n",
+                           tb_tier2_threshold);
+    g_string_append_printf(buf, "tb-workers: %u\n\n", tb_n_workers);
 }
 
 static void print_qht_statistics(struct qht_stats hst, GString *buf)
@@ -126,19 +129,104 @@ static gboolean tb_tree_stats_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
-static void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
+static void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide,
+                             size_t *plarge)
 {
     CPUState *cpu;
-    size_t full = 0, part = 0, elide = 0;
+    size_t full = 0, part = 0, elide = 0, large = 0;
 
     CPU_FOREACH(cpu) {
         full += qatomic_read(&cpu->neg.tlb.c.full_flush_count);
         part += qatomic_read(&cpu->neg.tlb.c.part_flush_count);
         elide += qatomic_read(&cpu->neg.tlb.c.elide_flush_count);
+        large += qatomic_read(&cpu->neg.tlb.c.large_flush_count);
     }
     *pfull = full;
     *ppart = part;
     *pelide = elide;
+    *plarge = large;
+}
+
+static void dump_tlb_flush_info(GString *buf)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        g_string_append_printf(buf, "  CPU#%-3d full %zu, partial %zu, "
+                               "elided %zu, large page %zu\n",
+                               cpu->cpu_index,
+                               qatomic_read(&cpu->neg.tlb.c.full_flush_count),
+                               qatomic_read(&cpu->neg.tlb.c.part_flush_count),
+                               qatomic_read(&cpu->neg.tlb.c.elide_flush_count),
+                               qatomic_read(&cpu->neg.tlb.c.large_flush_count));
+    }
+}
+
+static void dump_tlb_walk_info(GString *buf)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        size_t hit = qatomic_read(&cpu->neg.tlb.c.walk_hit_count);
+        size_t miss = qatomic_read(&cpu->neg.tlb.c.walk_miss_count);
+
+        g_string_append_printf(buf, "  CPU#%-3d hits %zu, misses %zu "
+                               "(%0.1f%%)\n", cpu->cpu_index, hit, miss,
+                               hit + miss ? (double)hit * 100 / (hit + miss)
+                               : 0);
+    }
+}
+
+/*
+ * Number of cross-page goto_tb taken that passed their guard: each one
+ * saved a lookup in helper_lookup_tb_ptr() once the jump was linked.
+ * The others went through that lookup.
+ */
+static void xpage_jump_counts(uint64_t *jumps, uint64_t *misses)
+{
+    CPUState *cpu;
+
+    *jumps = *misses = 0;
+    CPU_FOREACH(cpu) {
+        *jumps += qatomic_read_u64(&cpu->tb_xpage_jmp_count);
+        *misses += qatomic_read_u64(&cpu->tb_xpage_miss_count);
+    }
+}
+
+/*
+ * Guest returns that took, or failed, the return-address stack guard.
+ * The counters are updated by the vCPUs as they run.
+ */
+static void ras_counts(uint64_t *hits, uint64_t *misses)
+{
+    CPUState *cpu;
+
+    *hits = *misses = 0;
+    CPU_FOREACH(cpu) {
+        *hits += qatomic_read_u64(&cpu->tb_ras.hit_count);
+        *misses += qatomic_read_u64(&cpu->tb_ras.miss_count);
+    }
+}
+
+static void dump_opt_info(GString *buf)
+{
+    TCGOptStats st;
+
+    tcg_opt_stats(&st);
+    g_string_append_printf(buf, "TCG ops             %zu, after optimizer "
+                           "%zu (-%0.1f%%), after liveness %zu (-%0.1f%%)\n",
+                           st.ops_in, st.ops_opt,
+                           st.ops_in ?
+                           (st.ops_in - (double)st.ops_opt) * 100 / st.ops_in
+                           : 0,
+                           st.ops_live,
+                           st.ops_in ?
+                           (st.ops_opt - (double)st.ops_live) * 100 / st.ops_in
+                           : 0);
+    g_string_append_printf(buf, "env loads forwarded %zu\n", st.ld_forward);
+    g_string_append_printf(buf, "env stores elided   %zu duplicate, "
+                           "%zu dead\n", st.st_dup, st.st_dead);
+    g_string_append_printf(buf, "extensions elided   %zu\n", st.ext_elim);
 }
 
 static void tcg_dump_info(GString *buf)
@@ -150,7 +238,8 @@ static void dump_exec_info(GString *buf)
 {
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
-    size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t nb_tbs, flush_full, flush_part, flush_elide, flush_large;
+    uint64_t xpage_jumps, xpage_misses;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -189,13 +278,78 @@ static void dump_exec_info(GString *buf)
     g_string_append_printf(buf, "\nStatistics:\n");
     g_string_append_printf(buf, "TB flush count      %u\n",
                            qatomic_read(&tb_ctx.tb_flush_count));
+    g_string_append_printf(buf, "TB flush pause      %" PRIu64 " us "
+                           "(max %" PRIu64 " us)\n",
+                           qatomic_read_u64(&tb_ctx.tb_flush_time_ns) /
+                           SCALE_US,
+                           qatomic_read_u64(&tb_ctx.tb_flush_time_max_ns) /
+                           SCALE_US);
+    g_string_append_printf(buf, "TB evict count      %u "
+                           "(%u regions, %u TBs)\n",
+                           qatomic_read(&tb_ctx.tb_evict_count),
+                           qatomic_read(&tb_ctx.tb_evict_region_count),
+                           qatomic_read(&tb_ctx.tb_evict_tb_count));
+    g_string_append_printf(buf, "TB evict pause      %" PRIu64 " us "
+                           "(max %" PRIu64 " us)\n",
+                           qatomic_read_u64(&tb_ctx.tb_evict_time_ns) /
+                           SCALE_US,
+                           qatomic_read_u64(&tb_ctx.tb_evict_time_max_ns) /
+                           SCALE_US);
     g_string_append_printf(buf, "TB invalidate count %u\n",
                            qatomic_read(&tb_ctx.tb_phys_invalidate_count));
+    if (tb_tier2_threshold) {
+        uint64_t tier1_insns, tier2_insns;
+
+        tb_exec_counter_stats(&tier1_insns, &tier2_insns);
+        g_string_append_printf(buf, "TB promote count    %u "
+                               "(tier-2 insns %0.1f%%)\n",
+                               qatomic_read(&tb_ctx.tb_promote_count),
+                               tier1_insns + tier2_insns ?
+                               (double)tier2_insns * 100 /
+                               (tier1_insns + tier2_insns) : 0);
+    }
+    if (tb_n_workers) {
+        g_string_append_printf(buf, "TB worker count     %u "
+                               "(aborted %u, dropped %u, waited for %u)\n",
+                               qatomic_read(&tb_ctx.tb_spec_count),
+                               qatomic_read(&tb_ctx.tb_spec_abort_count),
+                               qatomic_read(&tb_ctx.tb_spec_drop_count),
+                               qatomic_read(&tb_ctx.tb_spec_wait_count));
+    }
+
+    xpage_jump_counts(&xpage_jumps, &xpage_misses);
+    g_string_append_printf(buf, "cross page jumps    %" PRIu64
+                           " (links %u, guard misses %" PRIu64 ")\n",
+                           xpage_jumps,
+                           qatomic_read(&tb_ctx.tb_xpage_link_count),
+                           xpage_misses);
+    g_string_append_printf(buf, "SMC write count     %u "
+                           "(filtered %u, invalidating %u)\n",
+                           qatomic_read(&tb_ctx.tb_smc_write_count),
+                           qatomic_read(&tb_ctx.tb_smc_skip_count),
+                           qatomic_read(&tb_ctx.tb_smc_inval_count));
+    g_string_append_printf(buf, "exclusive atomics   %u%s\n",
+                           qatomic_read(&tb_ctx.tb_atomic_step_count),
+                           atomic_locks_enabled ? " (atomic locks on)" : "");
+    if (tb_ras_enabled) {
+        uint64_t ras_hits, ras_misses;
+
+        ras_counts(&ras_hits, &ras_misses);
+        g_string_append_printf(buf, "return stack hits   %" PRIu64
+                               " (misses %" PRIu64 ")\n",
+                               ras_hits, ras_misses);
+    }
+
+    dump_opt_info(buf);
 
-    tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
+    tlb_flush_counts(&flush_full, &flush_part, &flush_elide, &flush_large);
     g_string_append_printf(buf, "TLB full flushes    %zu\n", flush_full);
     g_string_append_printf(buf, "TLB partial flushes %zu\n", flush_part);
     g_string_append_printf(buf, "TLB elided flushes  %zu\n", flush_elide);
+    g_string_append_printf(buf, "TLB large flushes   %zu\n", flush_large);
+    dump_tlb_flush_info(buf);
+    g_string_append_printf(buf, "TLB page walk cache\n");
+    dump_tlb_walk_info(buf);
     tcg_dump_info(buf);
 }
 
@@ -239,6 +393,7 @@ static void hmp_tcg_register(void)
 {
     monitor_register_hmp_info_hrt("jit", qmp_x_query_jit);
     monitor_register_hmp_info_hrt("opcount", qmp_x_query_opcount);
+    monitor_register_hmp_info_hrt("profile", qmp_x_query_profile);
 }
 
 type_init(hmp_tcg_register);
@@ -177,26 +177,81 @@ static void gen_udata_cond_cb(struct qemu_plugin_conditional_cb *cb)
     tcg_temp_free_ptr(ptr);
 }
 
-static void gen_inline_add_u64_cb(struct qemu_plugin_inline_cb *cb)
+/*
+ * Point @ptr to the element of an indexed op selected by @addr. For a
+ * bitmap, the element is a bit: point to its word and return its number
+ * within the word.
+ */
+static TCGv_i64 gen_inline_index(enum plugin_dyn_cb_type type,
+                                 struct qemu_plugin_inline_cb *cb,
+                                 TCGv_ptr ptr, TCGv_i64 addr)
 {
-    TCGv_ptr ptr = gen_plugin_u64_ptr(cb->entry);
-    TCGv_i64 val = tcg_temp_ebb_new_i64();
-
-    tcg_gen_ld_i64(val, ptr, 0);
-    tcg_gen_addi_i64(val, val, cb->imm);
-    tcg_gen_st_i64(val, ptr, 0);
+    TCGv_i64 index = tcg_temp_ebb_new_i64();
+    TCGv_ptr offset = tcg_temp_ebb_new_ptr();
+    TCGv_i64 bit = NULL;
+
+    tcg_gen_shri_i64(index, addr, cb->shift);
+    tcg_gen_andi_i64(index, index, cb->mask);
+    if (type == PLUGIN_CB_INLINE_SET_BIT) {
+        bit = tcg_temp_ebb_new_i64();
+        tcg_gen_andi_i64(bit, index, 63);
+        tcg_gen_shri_i64(index, index, 6);
+    }
+    tcg_gen_shli_i64(index, index, 3);
+    tcg_gen_trunc_i64_ptr(offset, index);
+    tcg_gen_add_ptr(ptr, ptr, offset);
 
-    tcg_temp_free_i64(val);
-    tcg_temp_free_ptr(ptr);
+    tcg_temp_free_ptr(offset);
+    tcg_temp_free_i64(index);
+    return bit;
 }
 
-static void gen_inline_store_u64_cb(struct qemu_plugin_inline_cb *cb)
+static void gen_inline_op(enum plugin_dyn_cb_type type,
+                          struct qemu_plugin_inline_cb *cb, TCGv_i64 addr)
 {
     TCGv_ptr ptr = gen_plugin_u64_ptr(cb->entry);
-    TCGv_i64 val = tcg_constant_i64(cb->imm);
+    TCGv_i64 imm = tcg_constant_i64(cb->imm);
+    TCGv_i64 val = tcg_temp_ebb_new_i64();
+    TCGv_i64 bit = NULL;
+
+    if (cb->indexed) {
+        bit = gen_inline_index(type, cb, ptr, addr);
+    } else if (type == PLUGIN_CB_INLINE_SET_BIT) {
+        tcg_gen_addi_ptr(ptr, ptr, cb->imm / 64 * sizeof(uint64_t));
+    }
 
+    switch (type) {
+    case PLUGIN_CB_INLINE_ADD_U64:
+        tcg_gen_ld_i64(val, ptr, 0);
+        tcg_gen_add_i64(val, val, imm);
+        break;
+    case PLUGIN_CB_INLINE_STORE_U64:
+        tcg_gen_mov_i64(val, imm);
+        break;
+    case PLUGIN_CB_INLINE_MIN_U64:
+        tcg_gen_ld_i64(val, ptr, 0);
+        tcg_gen_umin_i64(val, val, imm);
+        break;
+    case PLUGIN_CB_INLINE_MAX_U64:
+        tcg_gen_ld_i64(val, ptr, 0);
+        tcg_gen_umax_i64(val, val, imm);
+        break;
+    case PLUGIN_CB_INLINE_SET_BIT:
+        tcg_gen_ld_i64(val, ptr, 0);
+        if (bit) {
+            tcg_gen_shl_i64(bit, tcg_constant_i64(1), bit);
+            tcg_gen_or_i64(val, val, bit);
+            tcg_temp_free_i64(bit);
+        } else {
+            tcg_gen_ori_i64(val, val, 1ull << (cb->imm % 64));
+        }
+        break;
+    default:
+        g_assert_not_reached();
+    }
     tcg_gen_st_i64(val, ptr, 0);
 
+    tcg_temp_free_i64(val);
     tcg_temp_free_ptr(ptr);
 }
 
@@ -212,6 +267,157 @@ static void gen_mem_cb(struct qemu_plugin_regular_cb *cb,
     tcg_temp_free_i32(cpu_index);
 }
 
+/*
+ * Append a record to the trace buffer of the running vCPU. There is no
+ * check for room here, as this may sit between a memory access and the
+ * rest of the instruction: see gen_trace_reserve.
+ */
+static void gen_trace_cb(struct qemu_plugin_trace_cb *cb,
+                         qemu_plugin_meminfo_t meminfo, TCGv_i64 addr)
+{
+    qemu_plugin_u64 entry = { .score = cb->buf->score, .offset = 0 };
+    TCGv_ptr vcpu = gen_plugin_u64_ptr(entry);
+    TCGv_ptr rec = tcg_temp_ebb_new_ptr();
+    TCGv_i64 left = tcg_temp_ebb_new_i64();
+
+    tcg_gen_ld_ptr(rec, vcpu, offsetof(struct qemu_plugin_trace_vcpu, next));
+    tcg_gen_st_i64(tcg_constant_i64(cb->pc), rec,
+                   offsetof(qemu_plugin_trace_record, pc));
+    tcg_gen_st_i64(addr ? addr : tcg_constant_i64(0), rec,
+                   offsetof(qemu_plugin_trace_record, vaddr));
+    tcg_gen_st_i32(tcg_constant_i32(meminfo), rec,
+                   offsetof(qemu_plugin_trace_record, info));
+    tcg_gen_st_i32(tcg_constant_i32(cb->flags), rec,
+                   offsetof(qemu_plugin_trace_record, flags));
+    tcg_gen_addi_ptr(rec, rec, sizeof(qemu_plugin_trace_record));
+    tcg_gen_st_ptr(rec, vcpu, offsetof(struct qemu_plugin_trace_vcpu, next));
+
+    tcg_gen_ld_i64(left, vcpu, offsetof(struct qemu_plugin_trace_vcpu, left));
+    tcg_gen_subi_i64(left, left, 1);
+    tcg_gen_st_i64(left, vcpu, offsetof(struct qemu_plugin_trace_vcpu, left));
+
+    tcg_temp_free_i64(left);
+    tcg_temp_free_ptr(rec);
+    tcg_temp_free_ptr(vcpu);
+}
+
+struct trace_reserve {
+    struct qemu_plugin_trace_cb *cb;
+    unsigned int records;
+};
+
+/*
+ * Drain the trace buffer of the running vCPU unless @records more
+ * records fit in it.
+ */
+static void gen_trace_drain_unless(struct qemu_plugin_trace_cb *cb,
+                                   unsigned int records)
+{
+    qemu_plugin_u64 entry = {
+        .score = cb->buf->score,
+        .offset = offsetof(struct qemu_plugin_trace_vcpu, left),
+    };
+    TCGv_ptr ptr = gen_plugin_u64_ptr(entry);
+    TCGv_i64 val = tcg_temp_ebb_new_i64();
+    TCGLabel *after_drain = gen_new_label();
+
+    /* See exec_trace_op for the room needed by an access from a helper. */
+    g_assert(records <= PLUGIN_TRACE_INSN_MAX);
+
+    tcg_gen_ld_i64(val, ptr, 0);
+    tcg_gen_brcondi_i64(TCG_COND_GEU, val, records, after_drain);
+    TCGv_i32 cpu_index = gen_cpu_index();
+    tcg_gen_call2(cb->drain, cb->info, NULL,
+                  tcgv_i32_temp(cpu_index),
+                  tcgv_ptr_temp(tcg_constant_ptr(cb->buf)));
+    tcg_temp_free_i32(cpu_index);
+    gen_set_label(after_drain);
+
+    tcg_temp_free_i64(val);
+    tcg_temp_free_ptr(ptr);
+}
+
+/* Records a trace callback appends, given the inline accesses of its insn */
+static unsigned int trace_cb_records(const struct qemu_plugin_trace_cb *cb,
+                                     bool mem, unsigned int n_loads,
+                                     unsigned int n_stores)
+{
+    if (!mem) {
+        return 1;
+    }
+    return (cb->rw & QEMU_PLUGIN_MEM_R ? n_loads : 0) +
+           (cb->rw & QEMU_PLUGIN_MEM_W ? n_stores : 0);
+}
+
+/*
+ * Before an instruction, drain each trace buffer it appends to unless
+ * all of its records fit, so that the appends themselves never branch.
+ * Branching next to a memory access would end the extended basic block
+ * in the middle of the guest instruction.
+ */
+static void gen_trace_reserve(struct qemu_plugin_insn *insn, TCGOp *insn_op)
+{
+    const GArray *arrs[] = { insn->insn_cbs, insn->mem_cbs };
+    g_autoptr(GArray) reserve = NULL;
+    unsigned int n_loads = 0, n_stores = 0;
+    TCGOp *op;
+
+    for (op = QTAILQ_NEXT(insn_op, link);
+         op && op->opc != INDEX_op_insn_start;
+         op = QTAILQ_NEXT(op, link)) {
+        if (op->opc == INDEX_op_plugin_mem_cb) {
+            if (qemu_plugin_mem_is_store(op->args[1])) {
+                n_stores++;
+            } else {
+                n_loads++;
+            }
+        }
+    }
+
+    /* Sum up the records of each buffer, keyed by its first callback. */
+    for (int a = 0; a < ARRAY_SIZE(arrs); a++) {
+        for (int i = 0, n = (arrs[a] ? arrs[a]->len : 0); i < n; i++) {
+            struct qemu_plugin_dyn_cb *cb =
+                &g_array_index(arrs[a], struct qemu_plugin_dyn_cb, i);
+            struct trace_reserve *r = NULL;
+            unsigned int records;
+
+            if (cb->type != PLUGIN_CB_TRACE) {
+                continue;
+            }
+            records = trace_cb_records(&cb->trace, a == 1, n_loads, n_stores);
+            if (!records) {
+                continue;
+            }
+
+            if (!reserve) {
+                reserve = g_array_new(false, false,
+                                      sizeof(struct trace_reserve));
+            }
+            for (int j = 0; j < reserve->len; j++) {
+                struct trace_reserve *e =
+                    &g_array_index(reserve, struct trace_reserve, j);
+                if (e->cb->buf == cb->trace.buf) {
+                    r = e;
+                    break;
+                }
+            }
+            if (r) {
+                r->records += records;
+            } else {
+                struct trace_reserve e = { &cb->trace, records };
+                g_array_append_val(reserve, e);
+            }
+        }
+    }
+
+    for (int j = 0; reserve && j < reserve->len; j++) {
+        struct trace_reserve *r =
+            &g_array_index(reserve, struct trace_reserve, j);
+        gen_trace_drain_unless(r->cb, r->records);
+    }
+}
+
 static void inject_cb(struct qemu_plugin_dyn_cb *cb)
 
 {
@@ -223,10 +429,14 @@ static void inject_cb(struct qemu_plugin_dyn_cb *cb)
         gen_udata_cond_cb(&cb->cond);
         break;
     case PLUGIN_CB_INLINE_ADD_U64:
-        gen_inline_add_u64_cb(&cb->inline_insn);
-        break;
     case PLUGIN_CB_INLINE_STORE_U64:
-        gen_inline_store_u64_cb(&cb->inline_insn);
+    case PLUGIN_CB_INLINE_MIN_U64:
+    case PLUGIN_CB_INLINE_MAX_U64:
+    case PLUGIN_CB_INLINE_SET_BIT:
+        gen_inline_op(cb->type, &cb->inline_insn, NULL);
+        break;
+    case PLUGIN_CB_TRACE:
+        gen_trace_cb(&cb->trace, 0, NULL);
         break;
     default:
         g_assert_not_reached();
@@ -245,8 +455,16 @@ static void inject_mem_cb(struct qemu_plugin_dyn_cb *cb,
         break;
     case PLUGIN_CB_INLINE_ADD_U64:
     case PLUGIN_CB_INLINE_STORE_U64:
+    case PLUGIN_CB_INLINE_MIN_U64:
+    case PLUGIN_CB_INLINE_MAX_U64:
+    case PLUGIN_CB_INLINE_SET_BIT:
         if (rw & cb->inline_insn.rw) {
-            inject_cb(cb);
+            gen_inline_op(cb->type, &cb->inline_insn, addr);
+        }
+        break;
+    case PLUGIN_CB_TRACE:
+        if (rw & cb->trace.rw) {
+            gen_trace_cb(&cb->trace, meminfo, addr);
         }
         break;
     default:
@@ -324,6 +542,7 @@ static void plugin_gen_inject(struct qemu_plugin_tb *plugin_tb)
                 assert(insn != NULL);
 
                 gen_enable_mem_helper(plugin_tb, insn);
+                gen_trace_reserve(insn, op);
 
                 cbs = insn->insn_cbs;
                 for (i = 0, n = (cbs ? cbs->len : 0); i < n; i++) {
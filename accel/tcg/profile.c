@@ -0,0 +1,182 @@
+/*
+ * Sampling profiler for guest code
+ *
+ * A virtual clock timer asks each running vCPU to record where it is.
+ * The vCPU takes the sample between two TBs, from its program counter
+ * and, with "-accel tcg,return-stack=on", the return addresses of the
+ * calls that are still open.  Samples are symbolized with the ELF
+ * files loaded for the guest, and aggregated as folded stacks.
+ *
+ * This is the guest side counterpart of tcg/perf.c: it shows where the
+ * guest spends its time, without the cost of a plugin callback per TB.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/lockable.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/type-helpers.h"
+#include "qapi/qapi-commands-machine.h"
+#include "disas/disas.h"
+#include "hw/core/cpu.h"
+#include "sysemu/tcg.h"
+#include "internal-common.h"
+
+#define PROFILE_INTERVAL_US 1000
+
+static QemuMutex profile_lock;
+static QEMUTimer *profile_timer;
+static int64_t profile_interval_ns;
+/* Folded stack -> uint64_t sample count, protected by profile_lock */
+static GHashTable *profile_stacks;
+
+static void profile_add(GString *stack)
+{
+    uint64_t *count;
+
+    QEMU_LOCK_GUARD(&profile_lock);
+    count = g_hash_table_lookup(profile_stacks, stack->str);
+    if (count) {
+        g_string_free(stack, true);
+    } else {
+        count = g_new0(uint64_t, 1);
+        g_hash_table_insert(profile_stacks, g_string_free(stack, false),
+                            count);
+    }
+    (*count)++;
+}
+
+static void profile_add_frame(GString *stack, vaddr pc)
+{
+    const char *sym = lookup_symbol(pc);
+
+    if (sym[0]) {
+        g_string_append_printf(stack, ";%s", sym);
+    } else {
+        g_string_append_printf(stack, ";0x%" VADDR_PRIx, pc);
+    }
+}
+
+static void profile_sample(CPUState *cpu, run_on_cpu_data data)
+{
+    GString *stack = g_string_new(NULL);
+
+    g_string_printf(stack, "cpu%d", cpu->cpu_index);
+
+    /*
+     * The live entries of the return-address stack are the ones below
+     * top, oldest first.  This is only as good as the pairing of calls
+     * and returns in the guest: frames left by a non-local return are
+     * reported until they are overwritten.
+     */
+    if (tb_ras_enabled) {
+        CPUReturnStack *ras = &cpu->tb_ras;
+        uint32_t depth = MIN(ras->top, TB_RAS_SIZE);
+
+        for (uint32_t i = depth; i > 0; i--) {
+            profile_add_frame(stack,
+                              ras->ent[(ras->top - i) % TB_RAS_SIZE].pc);
+        }
+    }
+    profile_add_frame(stack, cpu->cc->get_pc(cpu));
+
+    profile_add(stack);
+    qatomic_set(&cpu->tb_profile_pending, false);
+}
+
+static void profile_tick(void *opaque)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        if (qatomic_read(&cpu->halted)) {
+            GString *stack = g_string_new(NULL);
+
+            g_string_printf(stack, "cpu%d;[halted]", cpu->cpu_index);
+            profile_add(stack);
+            continue;
+        }
+
+        /* Skip a vCPU that is still busy with its last sample, e.g. in I/O */
+        if (!qatomic_read(&cpu->tb_profile_pending)) {
+            qatomic_set(&cpu->tb_profile_pending, true);
+            async_run_on_cpu(cpu, profile_sample, RUN_ON_CPU_NULL);
+        }
+    }
+
+    timer_mod(profile_timer,
+              qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + profile_interval_ns);
+}
+
+void qmp_x_profile_start(bool has_interval_us, uint32_t interval_us,
+                         Error **errp)
+{
+    if (!tcg_enabled()) {
+        error_setg(errp, "Profiling is only available with accel=tcg");
+        return;
+    }
+    if (profile_timer) {
+        error_setg(errp, "Profiling is already running");
+        return;
+    }
+    if (!has_interval_us) {
+        interval_us = PROFILE_INTERVAL_US;
+    } else if (interval_us == 0) {
+        error_setg(errp, "Parameter 'interval-us' must be positive");
+        return;
+    }
+
+    if (!profile_stacks) {
+        qemu_mutex_init(&profile_lock);
+        profile_stacks = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, g_free);
+    } else {
+        QEMU_LOCK_GUARD(&profile_lock);
+        g_hash_table_remove_all(profile_stacks);
+    }
+
+    profile_interval_ns = (int64_t)interval_us * SCALE_US;
+    profile_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, profile_tick, NULL);
+    timer_mod(profile_timer,
+              qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + profile_interval_ns);
+}
+
+void qmp_x_profile_stop(Error **errp)
+{
+    if (!profile_timer) {
+        error_setg(errp, "Profiling is not running");
+        return;
+    }
+
+    timer_free(profile_timer);
+    profile_timer = NULL;
+}
+
+HumanReadableText *qmp_x_query_profile(Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+    GList *keys, *l;
+
+    if (!tcg_enabled()) {
+        error_setg(errp, "Profiling is only available with accel=tcg");
+        return NULL;
+    }
+    if (!profile_stacks) {
+        return human_readable_text_from_str(buf);
+    }
+
+    QEMU_LOCK_GUARD(&profile_lock);
+    keys = g_list_sort(g_hash_table_get_keys(profile_stacks),
+                       (GCompareFunc)g_strcmp0);
+    for (l = keys; l; l = l->next) {
+        uint64_t *count = g_hash_table_lookup(profile_stacks, l->data);
+
+        g_string_append_printf(buf, "%s %" PRIu64 "\n",
+                               (char *)l->data, *count);
+    }
+    g_list_free(keys);
+
+    return human_readable_text_from_str(buf);
+}
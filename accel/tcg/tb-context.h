@@ -35,6 +35,28 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    unsigned tb_promote_count;
+    unsigned tb_evict_count;
+    unsigned tb_evict_region_count;
+    unsigned tb_evict_tb_count;
+    /* translation workers, see tb-workers.c */
+    unsigned tb_spec_count;
+    unsigned tb_spec_abort_count;
+    unsigned tb_spec_drop_count;
+    unsigned tb_spec_wait_count;
+    /* cross-page goto_tb, see translator_goto_tb_xpage() */
+    unsigned tb_xpage_link_count;
+    /* writes to pages with code, see tb_invalidate_phys_range_fast() */
+    unsigned tb_smc_write_count;
+    unsigned tb_smc_skip_count;     /* filtered by the code bitmap */
+    unsigned tb_smc_inval_count;    /* writes that invalidated TBs */
+    /* atomic operations executed with all vCPUs stopped */
+    unsigned tb_atomic_step_count;
+    /* time spent with all vCPUs stopped, in ns */
+    uint64_t tb_flush_time_ns;
+    uint64_t tb_flush_time_max_ns;
+    uint64_t tb_evict_time_ns;
+    uint64_t tb_evict_time_max_ns;
 };
 
 extern TBContext tb_ctx;
@@ -18,8 +18,10 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/bitmap.h"
 #include "qemu/interval-tree.h"
 #include "qemu/qtree.h"
+#include "qemu/timer.h"
 #include "exec/cputlb.h"
 #include "exec/log.h"
 #include "exec/exec-all.h"
@@ -51,16 +53,36 @@ static bool tb_cmp(const void *ap, const void *bp)
     return ((tb_cflags(a) & CF_PCREL || a->pc == b->pc) &&
             a->cs_base == b->cs_base &&
             a->flags == b->flags &&
-            (tb_cflags(a) & ~CF_INVALID) == (tb_cflags(b) & ~CF_INVALID) &&
+            (tb_cflags(a) & ~(CF_INVALID | CF_TIER2)) ==
+            (tb_cflags(b) & ~(CF_INVALID | CF_TIER2)) &&
             tb_page_addr0(a) == tb_page_addr0(b) &&
             tb_page_addr1(a) == tb_page_addr1(b));
 }
 
+/*
+ * Execution counters for hot TB promotion.  They are allocated in
+ * chunks and released all at once by tb_flush, at which point the
+ * guest insns they account for are folded into @retired.
+ */
+#define TB_EXEC_COUNTER_CHUNK 4096
+
+static struct {
+    QemuMutex lock;
+    GPtrArray *chunks;
+    GPtrArray *free;            /* entries released by tb_evict */
+    unsigned used;              /* entries used in the last chunk */
+    uint64_t retired[2];        /* tier-1 and tier-2 insns before flush */
+} tb_exec_counters;
+
 void tb_htable_init(void)
 {
     unsigned int mode = QHT_MODE_AUTO_RESIZE;
 
     qht_init(&tb_ctx.htable, tb_cmp, CODE_GEN_HTABLE_SIZE, mode);
+
+    qemu_mutex_init(&tb_exec_counters.lock);
+    tb_exec_counters.chunks = g_ptr_array_new_with_free_func(g_free);
+    tb_exec_counters.free = g_ptr_array_new();
 }
 
 typedef struct PageDesc PageDesc;
@@ -183,8 +205,17 @@ struct PageDesc {
     QemuSpin lock;
     /* list of TBs intersecting this ram page */
     uintptr_t first_tb;
+    /*
+     * Bytes of the page covered by the TBs in the list, built once the
+     * page has seen SMC_BITMAP_USE_THRESHOLD writes, so that writes to
+     * data sharing the page with code can be filtered cheaply.
+     */
+    unsigned long *code_bitmap;
+    unsigned int code_write_count;
 };
 
+#define SMC_BITMAP_USE_THRESHOLD 10
+
 void page_table_config_init(void)
 {
     uint32_t v_l1_bits;
@@ -650,6 +681,56 @@ static void page_collection_unlock(struct page_collection *set)
     g_free(set);
 }
 
+/*
+ * Return in @start and @last the bytes of the page covered by @tb,
+ * which is linked in the list of that page with tag @n.
+ */
+static void tb_page_range(const TranslationBlock *tb, unsigned int n,
+                          tb_page_addr_t *start, tb_page_addr_t *last)
+{
+    /* NOTE: this is subtle as a TB may span two physical pages */
+    *start = tb_page_addr0(tb);
+    *last = *start + tb->size - 1;
+    if (n == 0) {
+        *last = MIN(*last, *start | ~TARGET_PAGE_MASK);
+    } else {
+        *start = tb_page_addr1(tb);
+        *last = *start + (*last & ~TARGET_PAGE_MASK);
+    }
+}
+
+/* Called with @p->lock held. */
+static void invalidate_page_bitmap(PageDesc *p)
+{
+    assert_page_locked(p);
+    g_free(p->code_bitmap);
+    p->code_bitmap = NULL;
+    p->code_write_count = 0;
+}
+
+/* Called with @p->lock held. */
+static void page_bitmap_add(PageDesc *p, const TranslationBlock *tb,
+                            unsigned int n)
+{
+    tb_page_addr_t start, last;
+
+    tb_page_range(tb, n, &start, &last);
+    bitmap_set(p->code_bitmap, start & ~TARGET_PAGE_MASK, last - start + 1);
+}
+
+/* Called with @p->lock held. */
+static void build_page_bitmap(PageDesc *p)
+{
+    TranslationBlock *tb;
+    PageForEachNext n;
+
+    assert_page_locked(p);
+    p->code_bitmap = bitmap_new(TARGET_PAGE_SIZE);
+    PAGE_FOR_EACH_TB(unused, unused, p, tb, n) {
+        page_bitmap_add(p, tb, n);
+    }
+}
+
 /* Set to NULL all the 'first_tb' fields in all PageDescs. */
 static void tb_remove_all_1(int level, void **lp)
 {
@@ -664,6 +745,7 @@ static void tb_remove_all_1(int level, void **lp)
         for (i = 0; i < V_L2_SIZE; ++i) {
             page_lock(&pd[i]);
             pd[i].first_tb = (uintptr_t)NULL;
+            invalidate_page_bitmap(&pd[i]);
             page_unlock(&pd[i]);
         }
     } else {
@@ -697,6 +779,9 @@ static void tb_page_add(PageDesc *p, TranslationBlock *tb, unsigned int n)
     tb->page_next[n] = p->first_tb;
     page_already_protected = p->first_tb != 0;
     p->first_tb = (uintptr_t)tb | n;
+    if (p->code_bitmap) {
+        page_bitmap_add(p, tb, n);
+    }
 
     /*
      * If some code is already present, then the pages are already
@@ -733,6 +818,8 @@ static void tb_page_remove(PageDesc *pd, TranslationBlock *tb)
     PAGE_FOR_EACH_TB(unused, unused, pd, tb1, n1) {
         if (tb1 == tb) {
             *pprev = tb1->page_next[n1];
+            /* Other TBs may cover the same bytes; rebuild when needed. */
+            invalidate_page_bitmap(pd);
             return;
         }
         pprev = &tb1->page_next[n1];
@@ -755,10 +842,103 @@ static void tb_remove(TranslationBlock *tb)
 }
 #endif /* CONFIG_USER_ONLY */
 
+TBExecCounter *tb_exec_counter_new(void)
+{
+    TBExecCounter *chunk, *ret;
+
+    qemu_mutex_lock(&tb_exec_counters.lock);
+    if (tb_exec_counters.free->len) {
+        ret = g_ptr_array_steal_index_fast(tb_exec_counters.free,
+                                           tb_exec_counters.free->len - 1);
+        qemu_mutex_unlock(&tb_exec_counters.lock);
+        return ret;
+    }
+    if (tb_exec_counters.chunks->len == 0 ||
+        tb_exec_counters.used == TB_EXEC_COUNTER_CHUNK) {
+        g_ptr_array_add(tb_exec_counters.chunks,
+                        g_new0(TBExecCounter, TB_EXEC_COUNTER_CHUNK));
+        tb_exec_counters.used = 0;
+    }
+    chunk = g_ptr_array_index(tb_exec_counters.chunks,
+                              tb_exec_counters.chunks->len - 1);
+    ret = &chunk[tb_exec_counters.used++];
+    qemu_mutex_unlock(&tb_exec_counters.lock);
+
+    return ret;
+}
+
+/* Called with tb_exec_counters.lock held. */
+static void tb_exec_counter_sum(uint64_t insns[2])
+{
+    for (guint i = 0; i < tb_exec_counters.chunks->len; i++) {
+        const TBExecCounter *chunk = g_ptr_array_index(tb_exec_counters.chunks,
+                                                       i);
+
+        /* Unused entries are zero and do not contribute. */
+        for (unsigned j = 0; j < TB_EXEC_COUNTER_CHUNK; j++) {
+            insns[chunk[j].tier2] +=
+                qatomic_read_u64(&chunk[j].count) * chunk[j].icount;
+        }
+    }
+}
+
+void tb_exec_counter_stats(uint64_t *tier1_insns, uint64_t *tier2_insns)
+{
+    uint64_t insns[2] = { 0, 0 };
+
+    if (!tb_exec_counters.chunks) {
+        *tier1_insns = *tier2_insns = 0;
+        return;
+    }
+
+    qemu_mutex_lock(&tb_exec_counters.lock);
+    tb_exec_counter_sum(insns);
+    *tier1_insns = insns[0] + tb_exec_counters.retired[0];
+    *tier2_insns = insns[1] + tb_exec_counters.retired[1];
+    qemu_mutex_unlock(&tb_exec_counters.lock);
+}
+
+/* Called once the TB using @counter is gone, or was never published. */
+void tb_exec_counter_release(TBExecCounter *counter)
+{
+    qemu_mutex_lock(&tb_exec_counters.lock);
+    tb_exec_counters.retired[counter->tier2] +=
+        counter->count * counter->icount;
+    *counter = (TBExecCounter) { };
+    g_ptr_array_add(tb_exec_counters.free, counter);
+    qemu_mutex_unlock(&tb_exec_counters.lock);
+}
+
+/* Called from do_tb_flush, when no TB can be running. */
+static void tb_exec_counter_reset(void)
+{
+    if (!tb_exec_counters.chunks) {
+        return;
+    }
+
+    qemu_mutex_lock(&tb_exec_counters.lock);
+    tb_exec_counter_sum(tb_exec_counters.retired);
+    g_ptr_array_set_size(tb_exec_counters.chunks, 0);
+    g_ptr_array_set_size(tb_exec_counters.free, 0);
+    tb_exec_counters.used = 0;
+    qemu_mutex_unlock(&tb_exec_counters.lock);
+}
+
+static void tb_account_pause(uint64_t *total, uint64_t *max, int64_t start)
+{
+    uint64_t delta = get_clock() - start;
+
+    qatomic_set_u64(total, qatomic_read_u64(total) + delta);
+    if (delta > qatomic_read_u64(max)) {
+        qatomic_set_u64(max, delta);
+    }
+}
+
 /* flush all the translation blocks */
 static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 {
     bool did_flush = false;
+    int64_t start = get_clock();
 
     mmap_lock();
     /* If it is already been done on request of another CPU, just retry. */
@@ -766,6 +946,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
         goto done;
     }
     did_flush = true;
+    tb_workers_pause();
 
     CPU_FOREACH(cpu) {
         tcg_flush_jmp_cache(cpu);
@@ -773,10 +954,17 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 
     qht_reset_size(&tb_ctx.htable, CODE_GEN_HTABLE_SIZE);
     tb_remove_all();
+#ifdef CONFIG_USER_ONLY
+    tb_pcache_flush();
+#endif
+    tb_exec_counter_reset();
 
     tcg_region_reset_all();
+    tb_workers_resume();
     /* XXX: flush processor icache at this point if cache flush is expensive */
     qatomic_inc(&tb_ctx.tb_flush_count);
+    tb_account_pause(&tb_ctx.tb_flush_time_ns, &tb_ctx.tb_flush_time_max_ns,
+                     start);
 
 done:
     mmap_unlock();
@@ -902,7 +1090,8 @@ static void tb_jmp_cache_inval_tb(TranslationBlock *tb)
  * In !user-mode, if @rm_from_page_list is set, call with the TB's pages'
  * locks held.
  */
-static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
+static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list,
+                                  bool inval_jmp_cache)
 {
     uint32_t h;
     tb_page_addr_t phys_pc;
@@ -918,7 +1107,7 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     /* remove the TB from the hash list */
     phys_pc = tb_page_addr0(tb);
     h = tb_hash_func(phys_pc, (orig_cflags & CF_PCREL ? 0 : tb->pc),
-                     tb->flags, tb->cs_base, orig_cflags);
+                     tb->flags, tb->cs_base, orig_cflags & ~CF_TIER2);
     if (!qht_remove(&tb_ctx.htable, tb, h)) {
         return;
     }
@@ -929,7 +1118,9 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    tb_jmp_cache_inval_tb(tb);
+    if (inval_jmp_cache) {
+        tb_jmp_cache_inval_tb(tb);
+    }
 
     /* suppress this TB from the two jump lists */
     tb_remove_from_jmp_list(tb, 0);
@@ -945,7 +1136,7 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
 static void tb_phys_invalidate__locked(TranslationBlock *tb)
 {
     qemu_thread_jit_write();
-    do_tb_phys_invalidate(tb, true);
+    do_tb_phys_invalidate(tb, true, true);
     qemu_thread_jit_execute();
 }
 
@@ -957,10 +1148,85 @@ void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr)
 {
     if (page_addr == -1 && tb_page_addr0(tb) != -1) {
         tb_lock_pages(tb);
-        do_tb_phys_invalidate(tb, true);
+        do_tb_phys_invalidate(tb, true, true);
         tb_unlock_pages(tb);
     } else {
-        do_tb_phys_invalidate(tb, false);
+        do_tb_phys_invalidate(tb, false, true);
+    }
+}
+
+static gboolean tb_evict_one(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+    size_t *n_tbs = data;
+
+    /* The jump caches have been flushed as a whole already. */
+    tb_lock_pages(tb);
+    do_tb_phys_invalidate(tb, true, false);
+    tb_unlock_pages(tb);
+
+    if (tb->exec_counter) {
+        tb_exec_counter_release(tb->exec_counter);
+    }
+    (*n_tbs)++;
+    return false;
+}
+
+/*
+ * Reclaim part of the code cache, invalidating only the TBs that
+ * live in the reclaimed regions.  Fall back to a full flush if there
+ * is nothing that can be reclaimed on its own.
+ */
+static void do_tb_evict(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    int64_t start = get_clock();
+    size_t n_regions, n_tbs = 0;
+    CPUState *other;
+
+    mmap_lock();
+    /* A full flush since the request has made room already. */
+    if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
+        goto done;
+    }
+
+    tb_workers_pause();
+    CPU_FOREACH(other) {
+        tcg_flush_jmp_cache(other);
+    }
+
+    qemu_thread_jit_write();
+    if (!tcg_region_evict(tb_evict_one, &n_tbs, &n_regions)) {
+        qemu_thread_jit_execute();
+        do_tb_flush(cpu, tb_flush_count);
+        tb_workers_resume();
+        goto done;
+    }
+    qemu_thread_jit_execute();
+    tb_workers_resume();
+
+    if (n_regions) {
+        qatomic_inc(&tb_ctx.tb_evict_count);
+        qatomic_set(&tb_ctx.tb_evict_region_count,
+                    tb_ctx.tb_evict_region_count + n_regions);
+        qatomic_set(&tb_ctx.tb_evict_tb_count,
+                    tb_ctx.tb_evict_tb_count + n_tbs);
+        tb_account_pause(&tb_ctx.tb_evict_time_ns,
+                         &tb_ctx.tb_evict_time_max_ns, start);
+    }
+
+done:
+    mmap_unlock();
+}
+
+void tb_evict(CPUState *cpu)
+{
+    unsigned tb_flush_count = qatomic_read(&tb_ctx.tb_flush_count);
+
+    if (cpu_in_serial_context(cpu)) {
+        do_tb_evict(cpu, RUN_ON_CPU_HOST_INT(tb_flush_count));
+    } else {
+        async_safe_run_on_cpu(cpu, do_tb_evict,
+                              RUN_ON_CPU_HOST_INT(tb_flush_count));
     }
 }
 
@@ -985,7 +1251,7 @@ TranslationBlock *tb_link_page(TranslationBlock *tb)
 
     /* add in the hash table */
     h = tb_hash_func(tb_page_addr0(tb), (tb->cflags & CF_PCREL ? 0 : tb->pc),
-                     tb->flags, tb->cs_base, tb->cflags);
+                     tb->flags, tb->cs_base, tb->cflags & ~CF_TIER2);
     qht_insert(&tb_ctx.htable, tb, h, &existing_tb);
 
     /* remove TB from the page(s) if we couldn't insert it */
@@ -1102,6 +1368,7 @@ tb_invalidate_phys_page_range__locked(struct page_collection *pages,
 {
     TranslationBlock *tb;
     PageForEachNext n;
+    bool modified = false;
 #ifdef TARGET_HAS_PRECISE_SMC
     bool current_tb_modified = false;
     TranslationBlock *current_tb = retaddr ? tcg_tb_lookup(retaddr) : NULL;
@@ -1117,15 +1384,7 @@ tb_invalidate_phys_page_range__locked(struct page_collection *pages,
     PAGE_FOR_EACH_TB(start, last, p, tb, n) {
         tb_page_addr_t tb_start, tb_last;
 
-        /* NOTE: this is subtle as a TB may span two physical pages */
-        tb_start = tb_page_addr0(tb);
-        tb_last = tb_start + tb->size - 1;
-        if (n == 0) {
-            tb_last = MIN(tb_last, tb_start | ~TARGET_PAGE_MASK);
-        } else {
-            tb_start = tb_page_addr1(tb);
-            tb_last = tb_start + (tb_last & ~TARGET_PAGE_MASK);
-        }
+        tb_page_range(tb, n, &tb_start, &tb_last);
         if (!(tb_last < start || tb_start > last)) {
 #ifdef TARGET_HAS_PRECISE_SMC
             if (current_tb == tb &&
@@ -1142,8 +1401,12 @@ tb_invalidate_phys_page_range__locked(struct page_collection *pages,
             }
 #endif /* TARGET_HAS_PRECISE_SMC */
             tb_phys_invalidate__locked(tb);
+            modified = true;
         }
     }
+    if (modified) {
+        qatomic_inc(&tb_ctx.tb_smc_inval_count);
+    }
 
     /* if no code remaining, no need to continue to use slow writes */
     if (!p->first_tb) {
@@ -1211,6 +1474,28 @@ static void tb_invalidate_phys_page_fast__locked(struct page_collection *pages,
     tb_invalidate_phys_page_range__locked(pages, p, start, start + len - 1, ra);
 }
 
+/*
+ * Return true if the write of @len bytes at @start, within the page of
+ * @p, cannot modify translated code.  This only looks at the code bitmap
+ * of the page, which is built once the page has seen enough writes.
+ */
+static bool page_write_misses_code(PageDesc *p, tb_page_addr_t start,
+                                   unsigned len)
+{
+    unsigned long nr = start & ~TARGET_PAGE_MASK;
+    bool miss;
+
+    page_lock(p);
+    if (!p->code_bitmap &&
+        ++p->code_write_count >= SMC_BITMAP_USE_THRESHOLD) {
+        build_page_bitmap(p);
+    }
+    miss = p->code_bitmap &&
+           find_next_bit(p->code_bitmap, nr + len, nr) >= nr + len;
+    page_unlock(p);
+    return miss;
+}
+
 /*
  * len must be <= 8 and start must be a multiple of len.
  * Called via softmmu_template.h when code areas are written to with
@@ -1221,6 +1506,17 @@ void tb_invalidate_phys_range_fast(ram_addr_t ram_addr,
                                    uintptr_t retaddr)
 {
     struct page_collection *pages;
+    PageDesc *p = page_find(ram_addr >> TARGET_PAGE_BITS);
+
+    qatomic_inc(&tb_ctx.tb_smc_write_count);
+    /*
+     * Filter writes next to code before page_collection_lock(), which
+     * also locks the pages of all the TBs in this one.
+     */
+    if (p && page_write_misses_code(p, ram_addr, size)) {
+        qatomic_inc(&tb_ctx.tb_smc_skip_count);
+        return;
+    }
 
     pages = page_collection_lock(ram_addr, ram_addr + size - 1);
     tb_invalidate_phys_page_fast__locked(pages, ram_addr, size, retaddr);
@@ -0,0 +1,463 @@
+/*
+ * Persistent translation block cache for user-mode emulation.
+ *
+ * Short-lived processes, e.g. compilers run by a build system, spend
+ * most of their time translating the same dynamic loader, libc and
+ * tool code over and over.  This cache records the contents of
+ * code_gen_buffer at exit and copies it back into place at startup,
+ * so that the translation blocks can be reused without retranslation.
+ *
+ * Generated code embeds absolute host addresses: helpers, the prologue,
+ * the TranslationBlock itself and guest_base.  Rather than relocating,
+ * the cache is only used when every one of these is unchanged, which
+ * is the case for a non-PIE emulator binary or with address space
+ * randomization disabled.  Each cached block is further checked
+ * against the guest code that is currently mapped before it is used.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cacheflush.h"
+#include "qemu/error-report.h"
+#include "qemu/log.h"
+#include "exec/exec-all.h"
+#include "exec/cpu_ldst.h"
+#include "exec/tb-pcache.h"
+#include "tcg/startup.h"
+#include "tcg/tcg.h"
+#include "internal-common.h"
+#include "internal-target.h"
+#include "trace.h"
+
+#define TB_PCACHE_MAGIC    0x43425451  /* "QTBC" */
+#define TB_PCACHE_VERSION  1
+
+typedef struct TBPCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    char build[64];
+    /* Identity of the emulator binary. */
+    uint64_t exe_dev;
+    uint64_t exe_ino;
+    uint64_t exe_size;
+    int64_t exe_mtime;
+    uint64_t text_ref;
+    /* Layout of the translation buffer. */
+    uint64_t guest_base;
+    uint64_t buffer;
+    uint64_t buffer_size;
+    uint32_t prologue_size;
+    uint32_t n_tbs;
+    uint64_t code_size;
+} TBPCacheHeader;
+
+/*
+ * One record per cached TB; the guest bytes covered by the TB follow
+ * the record, padded to a multiple of 8 bytes.
+ */
+typedef struct TBPCacheRecord {
+    uint64_t pc;
+    uint64_t cs_base;
+    uint32_t flags;
+    uint32_t cflags;
+    uint32_t tb_offset;
+    uint32_t size;
+} TBPCacheRecord;
+
+QEMU_BUILD_BUG_ON(sizeof(TBPCacheHeader) % 8);
+QEMU_BUILD_BUG_ON(sizeof(TBPCacheRecord) % 8);
+
+typedef struct TBPCacheEntry {
+    const TBPCacheRecord *rec;
+    struct TBPCacheEntry *next;
+    bool adopted;
+} TBPCacheEntry;
+
+static struct {
+    char *path;
+    TBPCacheHeader ident;
+
+    /* Contents of the cache file, valid until tb_pcache_reset(). */
+    char *blob;
+    size_t blob_size;
+    GHashTable *index;
+    TBPCacheEntry *entries;
+    void *code;
+    size_t code_size;
+
+    /* Statistics, protected by mmap_lock. */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stale;
+} pcache;
+
+static bool tb_pcache_same_ident(const TBPCacheHeader *a,
+                                 const TBPCacheHeader *b)
+{
+    return a->magic == b->magic &&
+           a->version == b->version &&
+           strncmp(a->build, b->build, sizeof(a->build)) == 0 &&
+           a->exe_dev == b->exe_dev &&
+           a->exe_ino == b->exe_ino &&
+           a->exe_size == b->exe_size &&
+           a->exe_mtime == b->exe_mtime &&
+           a->text_ref == b->text_ref;
+}
+
+void tb_pcache_init(const char *dir, int execfd, const char *cpu_type)
+{
+    g_autofree char *key = NULL;
+    g_autofree char *sum = NULL;
+    const TBPCacheHeader *hdr;
+    struct stat st;
+    gsize len;
+
+#ifdef CONFIG_TCG_INTERPRETER
+    warn_report("tb-cache: not supported with the TCG interpreter");
+    return;
+#endif
+    if (fstat(execfd, &st) < 0) {
+        warn_report("tb-cache: cannot stat guest binary: %s",
+                    strerror(errno));
+        return;
+    }
+    if (g_mkdir_with_parents(dir, 0700) < 0) {
+        warn_report("tb-cache: cannot create %s: %s", dir, strerror(errno));
+        return;
+    }
+
+    key = g_strdup_printf("%s:%" PRIu64 ":%" PRIu64 ":%" PRIu64 ":%" PRId64,
+                          cpu_type, (uint64_t)st.st_dev, (uint64_t)st.st_ino,
+                          (uint64_t)st.st_size, (int64_t)st.st_mtime);
+    sum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+    pcache.path = g_strdup_printf("%s/" TARGET_NAME "-%s.tbc", dir, sum);
+
+    pcache.ident.magic = TB_PCACHE_MAGIC;
+    pcache.ident.version = TB_PCACHE_VERSION;
+    pstrcpy(pcache.ident.build, sizeof(pcache.ident.build),
+            QEMU_VERSION " " TARGET_NAME);
+    if (stat("/proc/self/exe", &st) == 0) {
+        pcache.ident.exe_dev = st.st_dev;
+        pcache.ident.exe_ino = st.st_ino;
+        pcache.ident.exe_size = st.st_size;
+        pcache.ident.exe_mtime = st.st_mtime;
+    }
+    pcache.ident.text_ref = (uintptr_t)tb_pcache_init;
+
+    if (!g_file_get_contents(pcache.path, &pcache.blob, &len, NULL)) {
+        return;
+    }
+    pcache.blob_size = len;
+    hdr = (const TBPCacheHeader *)pcache.blob;
+    if (len < sizeof(*hdr) || !tb_pcache_same_ident(hdr, &pcache.ident)) {
+        g_clear_pointer(&pcache.blob, g_free);
+        return;
+    }
+
+    /* Ask for the buffer to be placed where the cached code expects it. */
+    tcg_set_code_gen_buffer_hint((void *)(uintptr_t)hdr->buffer);
+}
+
+static void tb_pcache_reset(void)
+{
+    g_clear_pointer(&pcache.index, g_hash_table_destroy);
+    g_clear_pointer(&pcache.entries, g_free);
+    g_clear_pointer(&pcache.blob, g_free);
+    pcache.code = NULL;
+    pcache.code_size = 0;
+}
+
+static bool tb_pcache_check_layout(const TBPCacheHeader *hdr)
+{
+    const void *prologue = tcg_splitwx_to_rw((const void *)tcg_qemu_tb_exec);
+    size_t prologue_size = tcg_ctx->code_gen_buffer - prologue;
+    size_t avail = tcg_ctx->code_gen_highwater - tcg_ctx->code_gen_buffer;
+    size_t need;
+
+    if (tcg_splitwx_diff != 0 ||
+        hdr->guest_base != guest_base ||
+        hdr->buffer != (uintptr_t)prologue ||
+        hdr->buffer_size != tcg_code_capacity() ||
+        hdr->prologue_size != prologue_size ||
+        hdr->code_size > avail ||
+        tcg_ctx->code_gen_ptr != tcg_ctx->code_gen_buffer) {
+        return false;
+    }
+
+    need = sizeof(*hdr) + ROUND_UP(hdr->prologue_size, 8)
+         + ROUND_UP(hdr->code_size, 8);
+    if (pcache.blob_size < need) {
+        return false;
+    }
+
+    /* The prologue embeds guest_base and helper addresses too. */
+    return memcmp(pcache.blob + sizeof(*hdr), prologue, prologue_size) == 0;
+}
+
+void tb_pcache_load(void)
+{
+    const TBPCacheHeader *hdr = (const TBPCacheHeader *)pcache.blob;
+    const char *p, *end;
+    uint32_t i, n;
+
+    if (!pcache.blob) {
+        return;
+    }
+
+    if (!tb_pcache_check_layout(hdr)) {
+        trace_tb_pcache_reject(pcache.path);
+        tb_pcache_reset();
+        return;
+    }
+
+    p = pcache.blob + sizeof(*hdr) + ROUND_UP(hdr->prologue_size, 8);
+    end = pcache.blob + pcache.blob_size;
+
+    pcache.code = tcg_ctx->code_gen_buffer;
+    pcache.code_size = hdr->code_size;
+    memcpy(pcache.code, p, pcache.code_size);
+    flush_idcache_range((uintptr_t)pcache.code, (uintptr_t)pcache.code,
+                        pcache.code_size);
+    qatomic_set(&tcg_ctx->code_gen_ptr, pcache.code + pcache.code_size);
+    p += ROUND_UP(hdr->code_size, 8);
+
+    pcache.index = g_hash_table_new(g_int64_hash, g_int64_equal);
+    pcache.entries = g_new0(TBPCacheEntry, hdr->n_tbs);
+
+    for (i = n = 0; i < hdr->n_tbs; i++) {
+        const TBPCacheRecord *rec = (const TBPCacheRecord *)p;
+        TBPCacheEntry *e;
+
+        if ((size_t)(end - p) < sizeof(*rec) ||
+            (size_t)(end - p) - sizeof(*rec) < ROUND_UP(rec->size, 8) ||
+            rec->size == 0 ||
+            rec->tb_offset % CODE_GEN_ALIGN ||
+            rec->tb_offset + sizeof(TranslationBlock) > pcache.code_size) {
+            break;
+        }
+        p += sizeof(*rec) + ROUND_UP(rec->size, 8);
+
+        e = &pcache.entries[n++];
+        e->rec = rec;
+        e->next = g_hash_table_lookup(pcache.index, &rec->pc);
+        g_hash_table_insert(pcache.index, (gpointer)&rec->pc, e);
+    }
+
+    trace_tb_pcache_load(pcache.path, n, pcache.code_size);
+}
+
+static TranslationBlock *tb_pcache_adopt(const TBPCacheRecord *rec)
+{
+    TranslationBlock *tb = pcache.code + rec->tb_offset;
+    TranslationBlock *existing_tb;
+    vaddr last = rec->pc + rec->size - 1;
+
+    /* Sanity check the block against its record. */
+    if (tb->cs_base != rec->cs_base ||
+        tb->flags != rec->flags ||
+        (tb->cflags & ~CF_INVALID) != rec->cflags ||
+        tb->size != rec->size ||
+        tb->tc.ptr < (void *)(tb + 1) ||
+        tb->tc.ptr + tb->tc.size > pcache.code + pcache.code_size) {
+        return NULL;
+    }
+
+    /* The guest code must be unchanged since the block was translated. */
+    if (!page_check_range(rec->pc, last, PAGE_EXEC) ||
+        memcmp(g2h_untagged(rec->pc), rec + 1, rec->size) != 0) {
+        return NULL;
+    }
+
+    tb->cflags = rec->cflags;
+    tb->exec_counter = NULL;
+    qemu_spin_init(&tb->jmp_lock);
+    tb->jmp_list_head = (uintptr_t)NULL;
+    tb->jmp_list_next[0] = (uintptr_t)NULL;
+    tb->jmp_list_next[1] = (uintptr_t)NULL;
+    tb->jmp_dest[0] = (uintptr_t)NULL;
+    tb->jmp_dest[1] = (uintptr_t)NULL;
+
+    /* Undo any chaining that was in place when the cache was written. */
+    if (tb->jmp_reset_offset[0] != TB_JMP_OFFSET_INVALID) {
+        tb_reset_jump(tb, 0);
+    }
+    if (tb->jmp_reset_offset[1] != TB_JMP_OFFSET_INVALID) {
+        tb_reset_jump(tb, 1);
+    }
+
+    memset(&tb->itree, 0, sizeof(tb->itree));
+    tb_set_page_addr0(tb, rec->pc);
+    tb_lock_page0(rec->pc);
+    if ((rec->pc ^ last) & TARGET_PAGE_MASK) {
+        tb_set_page_addr1(tb, last & TARGET_PAGE_MASK);
+        tb_lock_page1(rec->pc, last & TARGET_PAGE_MASK);
+    }
+
+    tcg_tb_insert(tb);
+    existing_tb = tb_link_page(tb);
+    if (unlikely(existing_tb != tb)) {
+        tcg_tb_remove(tb);
+    }
+    return existing_tb;
+}
+
+/* Called with mmap_lock held, from tb_gen_code. */
+TranslationBlock *tb_pcache_lookup(tb_page_addr_t phys_pc, uint64_t cs_base,
+                                   uint32_t flags, uint32_t cflags)
+{
+    uint64_t key = phys_pc;
+    TBPCacheEntry *e;
+
+    assert_memory_lock();
+    if (!pcache.path) {
+        return NULL;
+    }
+
+    e = pcache.index ? g_hash_table_lookup(pcache.index, &key) : NULL;
+    for (; e; e = e->next) {
+        const TBPCacheRecord *rec = e->rec;
+        TranslationBlock *tb;
+
+        if (e->adopted ||
+            rec->cs_base != cs_base ||
+            rec->flags != flags ||
+            rec->cflags != cflags) {
+            continue;
+        }
+
+        /* Whatever the outcome, never try this entry again. */
+        e->adopted = true;
+        tb = tb_pcache_adopt(rec);
+        if (tb) {
+            pcache.hits++;
+            return tb;
+        }
+        pcache.stale++;
+        break;
+    }
+    pcache.misses++;
+    return NULL;
+}
+
+/* Called with mmap_lock held, from do_tb_flush. */
+void tb_pcache_flush(void)
+{
+    assert_memory_lock();
+    if (pcache.index) {
+        tb_pcache_reset();
+    }
+}
+
+typedef struct TBPCacheSaveState {
+    GByteArray *recs;
+    const void *code;
+    const void *code_end;
+    uint32_t n_tbs;
+} TBPCacheSaveState;
+
+static gboolean tb_pcache_save_one(gpointer key, gpointer value, gpointer data)
+{
+    const TranslationBlock *tb = value;
+    TBPCacheSaveState *s = data;
+    static const uint8_t pad[8];
+    TBPCacheRecord rec;
+    vaddr pc = tb_page_addr0(tb);
+
+    /* Code that counts executions refers to this process's counters. */
+    if ((tb_cflags(tb) & CF_INVALID) || tb->exec_counter ||
+        (const void *)tb < s->code ||
+        tb->tc.ptr + tb->tc.size > s->code_end ||
+        !page_check_range(pc, pc + tb->size - 1, PAGE_EXEC)) {
+        return false;
+    }
+
+    rec = (TBPCacheRecord) {
+        .pc = pc,
+        .cs_base = tb->cs_base,
+        .flags = tb->flags,
+        .cflags = tb_cflags(tb),
+        .tb_offset = (const void *)tb - s->code,
+        .size = tb->size,
+    };
+    g_byte_array_append(s->recs, (const guint8 *)&rec, sizeof(rec));
+    g_byte_array_append(s->recs, g2h_untagged(pc), tb->size);
+    g_byte_array_append(s->recs, pad, ROUND_UP(tb->size, 8) - tb->size);
+    s->n_tbs++;
+    return false;
+}
+
+static bool tb_pcache_write(const char *path, const TBPCacheHeader *hdr,
+                            const void *prologue, const void *code,
+                            GByteArray *recs)
+{
+    static const uint8_t pad[8];
+    bool ok;
+    FILE *f;
+
+    f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    ok = fwrite(hdr, sizeof(*hdr), 1, f) == 1 &&
+         fwrite(prologue, 1, hdr->prologue_size, f) == hdr->prologue_size &&
+         fwrite(pad, 1, ROUND_UP(hdr->prologue_size, 8) - hdr->prologue_size,
+                f) == ROUND_UP(hdr->prologue_size, 8) - hdr->prologue_size &&
+         fwrite(code, 1, hdr->code_size, f) == hdr->code_size &&
+         fwrite(pad, 1, ROUND_UP(hdr->code_size, 8) - hdr->code_size,
+                f) == ROUND_UP(hdr->code_size, 8) - hdr->code_size &&
+         fwrite(recs->data, 1, recs->len, f) == recs->len;
+    return fclose(f) == 0 && ok;
+}
+
+void tb_pcache_save(void)
+{
+    g_autofree char *tmp = NULL;
+    TBPCacheSaveState s = { };
+    TBPCacheHeader hdr;
+    const void *prologue;
+
+    if (!pcache.path || tcg_splitwx_diff != 0) {
+        return;
+    }
+
+    mmap_lock();
+
+    trace_tb_pcache_stats(pcache.hits, pcache.misses, pcache.stale);
+    qemu_log_mask(CPU_LOG_TB_CACHE,
+                  "TB cache %s: %" PRIu64 " hits, %" PRIu64 " misses, %"
+                  PRIu64 " stale\n",
+                  pcache.path, pcache.hits, pcache.misses, pcache.stale);
+
+    /* Nothing new was translated: keep the file as it is. */
+    if (pcache.misses == 0) {
+        goto out;
+    }
+
+    prologue = tcg_splitwx_to_rw((const void *)tcg_qemu_tb_exec);
+    s.code = tcg_ctx->code_gen_buffer;
+    s.code_end = tcg_ctx->code_gen_ptr;
+    s.recs = g_byte_array_new();
+    tcg_tb_foreach(tb_pcache_save_one, &s);
+
+    hdr = pcache.ident;
+    hdr.guest_base = guest_base;
+    hdr.buffer = (uintptr_t)prologue;
+    hdr.buffer_size = tcg_code_capacity();
+    hdr.prologue_size = s.code - prologue;
+    hdr.n_tbs = s.n_tbs;
+    hdr.code_size = s.code_end - s.code;
+
+    /* Write to a private file and rename, so concurrent runs see either. */
+    tmp = g_strdup_printf("%s.%d", pcache.path, getpid());
+    if (tb_pcache_write(tmp, &hdr, prologue, s.code, s.recs) &&
+        rename(tmp, pcache.path) == 0) {
+        trace_tb_pcache_save(pcache.path, s.n_tbs, hdr.code_size);
+    } else {
+        unlink(tmp);
+    }
+    g_byte_array_unref(s.recs);
+
+ out:
+    mmap_unlock();
+}
@@ -0,0 +1,421 @@
+/*
+ * Background translation workers for multi-threaded TCG
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/memalign.h"
+#include "qemu/thread.h"
+#include "qemu/rcu.h"
+#include "qemu/plugin.h"
+#include "exec/exec-all.h"
+#include "hw/core/tcg-cpu-ops.h"
+#include "exec/translation-block.h"
+#include "tcg/tcg.h"
+#include "tcg/startup.h"
+#include "tb-context.h"
+#include "internal-common.h"
+#include "internal-target.h"
+
+/*
+ * With MTTCG, a vCPU that misses in the TB hash table stops to
+ * translate the block itself.  The workers here translate, ahead of
+ * time, the same-page goto_tb destinations of each new TB, so that the
+ * vCPU finds them with tb_lookup() instead.
+ *
+ * The vCPU keeps running meanwhile, so a request carries a private copy
+ * of the vCPU taken when the parent TB was translated, and the worker
+ * translates from that.  The copy is moved to the destination as if the
+ * vCPU had reached it, and cs_base and flags of the successor are
+ * computed from it with cpu_get_tb_cpu_state().  This assumes that the
+ * parent TB does not change them on the way, as a branch from an
+ * IT block or a change of mode would: the block is then translated for
+ * nothing, since a vCPU looks it up with the flags it really has.
+ *
+ * A request also carries the physical address and host mapping of the
+ * code, taken from the TB that produced it: workers have no softmmu TLB
+ * of their own, and a translation that would need one (typically because
+ * the block runs into the next page) is abandoned, see
+ * tb_worker_check_fetch().  Otherwise the block goes through
+ * tb_gen_code_host() like any other: the page lock of the first page
+ * is held while the guest code is read, and the TB is published by
+ * tb_link_page(), which resolves races with the vCPUs and write
+ * protects the page for SMC detection.
+ *
+ * Workers are not vCPUs, so start_exclusive() does not stop them;
+ * tb_flush() and TB eviction call tb_workers_pause() instead.
+ */
+
+#define TB_WORKER_QUEUE_LEN    256
+#define TB_WORKER_MAX_DEPTH    2
+
+typedef struct TBWorkerReq {
+    CPUState *cpu;              /* NULL if cancelled, or slot idle */
+    ArchCPU *snap;              /* private copy of @cpu, at @pc */
+    vaddr pc;
+    uint64_t cs_base;
+    uint32_t flags;
+    uint32_t cflags;
+    tb_page_addr_t phys_pc;
+    void *host_pc;
+    unsigned depth;             /* number of speculative ancestors */
+} TBWorkerReq;
+
+static struct {
+    QemuMutex lock;
+    QemuCond work_cond;         /* request queued or workers resumed */
+    QemuCond done_cond;         /* a worker finished a request */
+    TBWorkerReq queue[TB_WORKER_QUEUE_LEN];
+    unsigned head;
+    unsigned len;
+    TBWorkerReq *running;       /* one slot per worker */
+    unsigned n_running;
+    unsigned paused;
+} tb_workers;
+
+/* Request being translated by this thread, NULL for a vCPU. */
+static __thread TBWorkerReq *tb_worker_req;
+
+static void tb_worker_req_cancel(TBWorkerReq *req)
+{
+    req->cpu = NULL;
+    qemu_vfree(req->snap);
+    req->snap = NULL;
+}
+
+static bool tb_worker_req_match(const TBWorkerReq *req, vaddr pc,
+                                uint64_t cs_base, uint32_t flags,
+                                uint32_t cflags)
+{
+    return req->cpu && req->pc == pc && req->cs_base == cs_base &&
+           req->flags == flags && req->cflags == cflags;
+}
+
+static TBWorkerReq *tb_worker_queue_find(vaddr pc, uint64_t cs_base,
+                                         uint32_t flags, uint32_t cflags)
+{
+    for (unsigned i = 0; i < tb_workers.len; i++) {
+        TBWorkerReq *req =
+            &tb_workers.queue[(tb_workers.head + i) % TB_WORKER_QUEUE_LEN];
+
+        if (tb_worker_req_match(req, pc, cs_base, flags, cflags)) {
+            return req;
+        }
+    }
+    return NULL;
+}
+
+static bool tb_worker_running(vaddr pc, uint64_t cs_base,
+                              uint32_t flags, uint32_t cflags)
+{
+    for (unsigned i = 0; i < tb_n_workers; i++) {
+        if (tb_worker_req_match(&tb_workers.running[i],
+                                pc, cs_base, flags, cflags)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Copy @cpu and move the copy to @dest.  Return it with the state that a
+ * vCPU there would look the block up with, or NULL if the copy does not
+ * end up at @dest.
+ */
+static ArchCPU *tb_worker_snapshot(CPUState *cpu, TranslationBlock *tb,
+                                   vaddr dest, uint64_t *cs_base,
+                                   uint32_t *flags)
+{
+    ArchCPU *snap = qemu_memalign(__alignof__(ArchCPU), sizeof(ArchCPU));
+    CPUState *cs = env_cpu(&snap->env);
+    TranslationBlock at = {
+        .pc = dest,
+        .cs_base = tb->cs_base,
+        .flags = tb->flags,
+        .cflags = tb_cflags(tb) & ~CF_PCREL,
+    };
+    vaddr pc;
+
+    memcpy(snap, env_archcpu(cpu_env(cpu)), sizeof(ArchCPU));
+    if (cs->cc->tcg_ops->synchronize_from_tb) {
+        cs->cc->tcg_ops->synchronize_from_tb(cs, &at);
+    } else {
+        cs->cc->set_pc(cs, dest);
+    }
+    cpu_get_tb_cpu_state(&snap->env, &pc, cs_base, flags);
+    if (pc != dest) {
+        qemu_vfree(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+/*
+ * Called at the end of tb_gen_code_host(), on the thread that translated
+ * @tb: a vCPU, which @cpu is, or a worker, which @cpu is the copy of.
+ */
+void tb_workers_queue_successors(CPUState *cpu, TranslationBlock *tb,
+                                 vaddr pc, tb_page_addr_t phys_pc,
+                                 void *host_pc)
+{
+    uint32_t cflags = tb_cflags(tb) & ~CF_TIER2;
+    unsigned depth = tb_worker_req ? tb_worker_req->depth + 1 : 1;
+    CPUState *vcpu = tb_worker_req ? tb_worker_req->cpu : cpu;
+    TBWorkerReq reqs[ARRAY_SIZE(tcg_ctx->gen_tb_succ)];
+    int n = 0;
+
+    if (!tb_n_workers || !tcg_ctx->gen_tb_nb_succ ||
+        depth > TB_WORKER_MAX_DEPTH) {
+        return;
+    }
+    /* Leave blocks translated for special purposes alone. */
+    if (cflags & (CF_COUNT_MASK | CF_NO_GOTO_TB | CF_SINGLE_STEP |
+                  CF_MEMI_ONLY | CF_USE_ICOUNT | CF_NOIRQ | CF_BP_PAGE)) {
+        return;
+    }
+#ifdef CONFIG_PLUGIN
+    /* Plugins expect to see translations from the vCPU's thread. */
+    if (vcpu->plugin_state &&
+        test_bit(QEMU_PLUGIN_EV_VCPU_TB_TRANS,
+                 vcpu->plugin_state->event_mask)) {
+        return;
+    }
+#endif
+
+    /* Copy the vCPU outside of the lock, it is large. */
+    for (int i = 0; i < tcg_ctx->gen_tb_nb_succ; i++) {
+        vaddr dest = tcg_ctx->gen_tb_succ[i];
+        TBWorkerReq *req = &reqs[n];
+
+        if (dest == pc) {
+            continue;
+        }
+        req->snap = tb_worker_snapshot(cpu, tb, dest, &req->cs_base,
+                                       &req->flags);
+        if (!req->snap) {
+            continue;
+        }
+        req->cpu = vcpu;
+        req->pc = dest;
+        req->cflags = cflags;
+        /* translator_use_goto_tb() only records same-page targets */
+        req->phys_pc = phys_pc + (dest - pc);
+        req->host_pc = host_pc + (dest - pc);
+        req->depth = depth;
+        n++;
+    }
+
+    qemu_mutex_lock(&tb_workers.lock);
+    for (int i = 0; i < n; i++) {
+        TBWorkerReq *req = &reqs[i];
+
+        if (tb_worker_queue_find(req->pc, req->cs_base, req->flags,
+                                 req->cflags) ||
+            tb_worker_running(req->pc, req->cs_base, req->flags,
+                              req->cflags)) {
+            tb_worker_req_cancel(req);
+            continue;
+        }
+        if (tb_workers.len == TB_WORKER_QUEUE_LEN) {
+            qatomic_inc(&tb_ctx.tb_spec_drop_count);
+            tb_worker_req_cancel(req);
+            continue;
+        }
+
+        tb_workers.queue[(tb_workers.head + tb_workers.len) %
+                         TB_WORKER_QUEUE_LEN] = *req;
+        qatomic_set(&tb_workers.len, tb_workers.len + 1);
+        qemu_cond_signal(&tb_workers.work_cond);
+    }
+    qemu_mutex_unlock(&tb_workers.lock);
+}
+
+bool tb_workers_wait(vaddr pc, uint64_t cs_base,
+                     uint32_t flags, uint32_t cflags)
+{
+    TBWorkerReq *req;
+    bool waited = false;
+
+    /*
+     * Most misses find the workers idle: skip the lock then.  A request
+     * queued or started after the check only causes a duplicate
+     * translation, which tb_link_page() resolves.
+     */
+    if (!tb_n_workers ||
+        (!qatomic_read(&tb_workers.len) &&
+         !qatomic_read(&tb_workers.n_running))) {
+        return false;
+    }
+
+    qemu_mutex_lock(&tb_workers.lock);
+    /* The vCPU will not wait for a queued request, but translate it. */
+    req = tb_worker_queue_find(pc, cs_base, flags, cflags);
+    if (req) {
+        tb_worker_req_cancel(req);
+    }
+    while (tb_worker_running(pc, cs_base, flags, cflags)) {
+        qemu_cond_wait(&tb_workers.done_cond, &tb_workers.lock);
+        waited = true;
+    }
+    qemu_mutex_unlock(&tb_workers.lock);
+
+    if (waited) {
+        qatomic_inc(&tb_ctx.tb_spec_wait_count);
+    }
+    return waited;
+}
+
+/*
+ * Wait for the workers to finish what they are translating, and drop
+ * the pending requests.  Called with all vCPUs stopped, before the
+ * code buffer is flushed or partially reclaimed.  Nests.
+ */
+void tb_workers_pause(void)
+{
+    if (!tb_n_workers) {
+        return;
+    }
+
+    qemu_mutex_lock(&tb_workers.lock);
+    tb_workers.paused++;
+    for (unsigned i = 0; i < tb_workers.len; i++) {
+        tb_worker_req_cancel(&tb_workers.queue[(tb_workers.head + i) %
+                                               TB_WORKER_QUEUE_LEN]);
+    }
+    qatomic_set(&tb_workers.len, 0);
+    while (tb_workers.n_running) {
+        qemu_cond_wait(&tb_workers.done_cond, &tb_workers.lock);
+    }
+    qemu_mutex_unlock(&tb_workers.lock);
+}
+
+void tb_workers_resume(void)
+{
+    if (!tb_n_workers) {
+        return;
+    }
+
+    qemu_mutex_lock(&tb_workers.lock);
+    assert(tb_workers.paused);
+    if (--tb_workers.paused == 0 && tb_workers.len) {
+        qemu_cond_broadcast(&tb_workers.work_cond);
+    }
+    qemu_mutex_unlock(&tb_workers.lock);
+}
+
+/* Called when @cpu is unrealized; no request may use it afterwards. */
+void tb_workers_forget_cpu(CPUState *cpu)
+{
+    bool busy;
+
+    if (!tb_n_workers) {
+        return;
+    }
+
+    qemu_mutex_lock(&tb_workers.lock);
+    for (unsigned i = 0; i < tb_workers.len; i++) {
+        TBWorkerReq *req =
+            &tb_workers.queue[(tb_workers.head + i) % TB_WORKER_QUEUE_LEN];
+
+        if (req->cpu == cpu) {
+            tb_worker_req_cancel(req);
+        }
+    }
+    do {
+        busy = false;
+        for (unsigned i = 0; i < tb_n_workers; i++) {
+            busy |= tb_workers.running[i].cpu == cpu;
+        }
+        if (busy) {
+            qemu_cond_wait(&tb_workers.done_cond, &tb_workers.lock);
+        }
+    } while (busy);
+    qemu_mutex_unlock(&tb_workers.lock);
+}
+
+static void tb_worker_translate(TBWorkerReq *req)
+{
+    TranslationBlock *tb;
+
+    if (tb_htable_lookup_phys(req->phys_pc, req->pc, req->cs_base,
+                              req->flags, req->cflags)) {
+        return;
+    }
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        /* The RAM block may have been unplugged since the request. */
+        if (qemu_ram_addr_from_host(req->host_pc) != req->phys_pc) {
+            return;
+        }
+
+        tb_worker_req = req;
+        qemu_thread_jit_write();
+        tb = tb_gen_code_host(env_cpu(&req->snap->env), req->pc,
+                              req->cs_base, req->flags, req->cflags,
+                              req->phys_pc, req->host_pc);
+        qemu_thread_jit_execute();
+        tb_worker_req = NULL;
+    }
+
+    if (tb) {
+        qatomic_inc(&tb_ctx.tb_spec_count);
+    } else {
+        qatomic_inc(&tb_ctx.tb_spec_abort_count);
+    }
+}
+
+static void *tb_worker_thread(void *arg)
+{
+    TBWorkerReq *slot = arg;
+
+    rcu_register_thread();
+    tcg_register_thread();
+    tcg_ctx->speculative = true;
+
+    qemu_mutex_lock(&tb_workers.lock);
+    while (true) {
+        while (tb_workers.paused || !tb_workers.len) {
+            qemu_cond_wait(&tb_workers.work_cond, &tb_workers.lock);
+        }
+
+        *slot = tb_workers.queue[tb_workers.head];
+        tb_workers.head = (tb_workers.head + 1) % TB_WORKER_QUEUE_LEN;
+        qatomic_set(&tb_workers.len, tb_workers.len - 1);
+        if (!slot->cpu) {
+            continue;
+        }
+        qatomic_set(&tb_workers.n_running, tb_workers.n_running + 1);
+        qemu_mutex_unlock(&tb_workers.lock);
+
+        tb_worker_translate(slot);
+
+        qemu_mutex_lock(&tb_workers.lock);
+        tb_worker_req_cancel(slot);
+        qatomic_set(&tb_workers.n_running, tb_workers.n_running - 1);
+        qemu_cond_broadcast(&tb_workers.done_cond);
+    }
+
+    return NULL;
+}
+
+void tb_workers_init(unsigned n)
+{
+    if (!n) {
+        return;
+    }
+
+    qemu_mutex_init(&tb_workers.lock);
+    qemu_cond_init(&tb_workers.work_cond);
+    qemu_cond_init(&tb_workers.done_cond);
+    tb_workers.running = g_new0(TBWorkerReq, n);
+
+    for (unsigned i = 0; i < n; i++) {
+        QemuThread thread;
+        char name[VCPU_THREAD_NAME_SIZE];
+
+        snprintf(name, sizeof(name), "TCG translate %u", i);
+        qemu_thread_create(&thread, name, tb_worker_thread,
+                           &tb_workers.running[i], QEMU_THREAD_DETACHED);
+    }
+}
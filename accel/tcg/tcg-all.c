@@ -33,12 +33,14 @@
 #include "qemu/error-report.h"
 #include "qemu/accel.h"
 #include "qemu/atomic.h"
+#include "qemu/atomic128.h"
 #include "qapi/qapi-builtin-visit.h"
 #include "qemu/units.h"
 #if !defined(CONFIG_USER_ONLY)
 #include "hw/boards.h"
 #endif
 #include "internal-common.h"
+#include "internal-target.h"
 
 struct TCGState {
     AccelState parent_obj;
@@ -47,6 +49,11 @@ struct TCGState {
     bool one_insn_per_tb;
     int splitwx_enabled;
     unsigned long tb_size;
+    uint32_t tier2_threshold;
+    uint32_t tb_workers;
+    bool return_stack;
+    bool atomic_locks;
+    bool cold_code;
 };
 typedef struct TCGState TCGState;
 
@@ -99,6 +106,9 @@ static void tcg_accel_instance_init(Object *obj)
 
 bool mttcg_enabled;
 bool one_insn_per_tb;
+uint32_t tb_tier2_threshold;
+unsigned tb_n_workers;
+bool tb_ras_enabled;
 
 static int tcg_init_machine(MachineState *ms)
 {
@@ -111,10 +121,20 @@ static int tcg_init_machine(MachineState *ms)
 
     tcg_allowed = true;
     mttcg_enabled = s->mttcg_enabled;
+    tb_tier2_threshold = s->tier2_threshold;
+    tb_ras_enabled = s->return_stack;
+    if (s->atomic_locks) {
+        atomic_locks_init();
+    }
+#ifndef CONFIG_USER_ONLY
+    /* Translation workers feed the vCPU threads of MTTCG. */
+    tb_n_workers = mttcg_enabled ? s->tb_workers : 0;
+#endif
 
     page_init();
     tb_htable_init();
-    tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_cpus);
+    tcg_set_cold_code(s->cold_code);
+    tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_cpus + tb_n_workers);
 
 #if defined(CONFIG_SOFTMMU)
     /*
@@ -122,6 +142,7 @@ static int tcg_init_machine(MachineState *ms)
      * initialize the prologue now.
      */
     tcg_prologue_init();
+    tb_workers_init(tb_n_workers);
 #endif
 
     return 0;
@@ -181,6 +202,107 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_tier2_threshold(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->tier2_threshold;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_tier2_threshold(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+
+    s->tier2_threshold = value;
+}
+
+static void tcg_get_tb_workers(Object *obj, Visitor *v,
+                               const char *name, void *opaque,
+                               Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->tb_workers;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_tb_workers(Object *obj, Visitor *v,
+                               const char *name, void *opaque,
+                               Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    /* Each worker is a thread with its own TCG context and region. */
+    if (value > g_get_num_processors()) {
+        error_setg(errp, "Parameter '%s' must not exceed the number of "
+                   "host CPUs (%u)", name, g_get_num_processors());
+        return;
+    }
+
+    s->tb_workers = value;
+}
+
+static bool tcg_get_return_stack(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->return_stack;
+}
+
+static void tcg_set_return_stack(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->return_stack = value;
+}
+
+static bool tcg_get_atomic_locks(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->atomic_locks;
+}
+
+static void tcg_set_atomic_locks(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    /*
+     * The locks only order the accesses that take them.  With native
+     * 16-byte loads and stores, which may also be inlined by the TCG
+     * backend, a locked compare-and-swap would not be atomic.
+     */
+    if (value && !HAVE_CMPXCHG128 &&
+        (HAVE_ATOMIC128_RO || HAVE_ATOMIC128_RW)) {
+        error_setg(errp, "atomic-locks is not supported on this host");
+        return;
+    }
+    s->atomic_locks = value;
+}
+
+static bool tcg_get_cold_code(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->cold_code;
+}
+
+static void tcg_set_cold_code_prop(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->cold_code = value;
+}
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -242,6 +364,36 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add(oc, "tier2-threshold", "int",
+        tcg_get_tier2_threshold, tcg_set_tier2_threshold,
+        NULL, NULL);
+    object_class_property_set_description(oc, "tier2-threshold",
+        "Executions after which a TB is retranslated as a superblock "
+        "(0 disables)");
+
+    object_class_property_add(oc, "tb-workers", "int",
+        tcg_get_tb_workers, tcg_set_tb_workers,
+        NULL, NULL);
+    object_class_property_set_description(oc, "tb-workers",
+        "Number of background translation threads (multi-threaded TCG "
+        "only, 0 disables)");
+
+    object_class_property_add_bool(oc, "return-stack",
+        tcg_get_return_stack, tcg_set_return_stack);
+    object_class_property_set_description(oc, "return-stack",
+        "Predict the destination of guest returns with a shadow stack");
+
+    object_class_property_add_bool(oc, "atomic-locks",
+        tcg_get_atomic_locks, tcg_set_atomic_locks);
+    object_class_property_set_description(oc, "atomic-locks",
+        "Emulate 16-byte atomics the host lacks with address-hashed locks "
+        "instead of stopping all vCPUs");
+
+    object_class_property_add_bool(oc, "cold-code",
+        tcg_get_cold_code, tcg_set_cold_code_prop);
+    object_class_property_set_description(oc, "cold-code",
+        "Move memory access slow paths out of the translated blocks");
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
@@ -289,11 +289,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                               uint32_t flags, int cflags)
 {
     CPUArchState *env = cpu_env(cpu);
-    TranslationBlock *tb, *existing_tb;
-    tb_page_addr_t phys_pc, phys_p2;
-    tcg_insn_unit *gen_code_buf;
-    int gen_code_size, search_size, max_insns;
-    int64_t ti;
+    TranslationBlock *tb;
+    tb_page_addr_t phys_pc;
     void *host_pc;
 
     assert_memory_lock();
@@ -306,6 +303,45 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         cflags = (cflags & ~CF_COUNT_MASK) | 1;
     }
 
+#ifdef CONFIG_USER_ONLY
+    /* Reuse a block from the persistent cache, if there is one. */
+    if (phys_pc != -1) {
+        tb = tb_pcache_lookup(phys_pc, cs_base, flags, cflags);
+        if (tb) {
+            return tb;
+        }
+    }
+#endif
+
+    tb = tb_gen_code_host(cpu, pc, cs_base, flags, cflags, phys_pc, host_pc);
+    if (unlikely(!tb)) {
+        /* eviction or flush must be done */
+        tb_evict(cpu);
+        mmap_unlock();
+        /* Make the execution loop process the flush as soon as possible.  */
+        cpu->exception_index = EXCP_INTERRUPT;
+        cpu_loop_exit(cpu);
+    }
+    return tb;
+}
+
+/*
+ * Translate the block at @pc, whose code is at @phys_pc and mapped
+ * at @host_pc.  Return NULL if there is no room left in the code
+ * buffer, or if a translation worker had to give up on the block.
+ */
+TranslationBlock *tb_gen_code_host(CPUState *cpu, vaddr pc,
+                                   uint64_t cs_base, uint32_t flags,
+                                   int cflags, tb_page_addr_t phys_pc,
+                                   void *host_pc)
+{
+    CPUArchState *env = cpu_env(cpu);
+    TranslationBlock *tb, *existing_tb;
+    tb_page_addr_t phys_p2;
+    tcg_insn_unit *gen_code_buf;
+    int gen_code_size, search_size, max_insns;
+    int64_t ti;
+
     max_insns = cflags & CF_COUNT_MASK;
     if (max_insns == 0) {
         max_insns = TCG_MAX_INSNS;
@@ -316,12 +352,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     assert_no_pages_locked();
     tb = tcg_tb_alloc(tcg_ctx);
     if (unlikely(!tb)) {
-        /* flush must be done */
-        tb_flush(cpu);
-        mmap_unlock();
-        /* Make the execution loop process the flush as soon as possible.  */
-        cpu->exception_index = EXCP_INTERRUPT;
-        cpu_loop_exit(cpu);
+        return NULL;
     }
 
     gen_code_buf = tcg_ctx->code_gen_ptr;
@@ -332,6 +363,11 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->cs_base = cs_base;
     tb->flags = flags;
     tb->cflags = cflags;
+    tb->exec_counter = NULL;
+    if (tb_tier2_threshold && phys_pc != -1 &&
+        !(cflags & (CF_COUNT_MASK | CF_NO_GOTO_TB | CF_NOIRQ | CF_MEMI_ONLY))) {
+        tb->exec_counter = tb_exec_counter_new();
+    }
     tb_set_page_addr0(tb, phys_pc);
     tb_set_page_addr1(tb, -1);
     if (phys_pc != -1) {
@@ -415,6 +451,20 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                           "Restarting code generation with re-locked pages");
             goto restart_translate;
 
+        case -4:
+            /*
+             * A translation worker needed a code page other than the
+             * first one, see tb_worker_check_fetch().  Give the block
+             * up; the vCPU will translate it if it gets there.
+             */
+            tb_unlock_pages(tb);
+            tcg_ctx->gen_tb = NULL;
+            if (tb->exec_counter) {
+                tb_exec_counter_release(tb->exec_counter);
+            }
+            qatomic_set(&tcg_ctx->code_gen_ptr, (void *)tb);
+            return NULL;
+
         default:
             g_assert_not_reached();
         }
@@ -427,6 +477,10 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         goto buffer_overflow;
     }
     tb->tc.size = gen_code_size;
+    if (tb->exec_counter) {
+        tb->exec_counter->icount = tb->icount;
+        tb->exec_counter->tier2 = cflags & CF_TIER2;
+    }
 
     /*
      * For CF_PCREL, attribute all executions of the generated code
@@ -558,11 +612,46 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         orig_aligned -= ROUND_UP(sizeof(*tb), qemu_icache_linesize);
         qatomic_set(&tcg_ctx->code_gen_ptr, (void *)orig_aligned);
         tcg_tb_remove(tb);
+        if (tb->exec_counter) {
+            tb_exec_counter_release(tb->exec_counter);
+        }
         return existing_tb;
     }
+
+    tb_workers_queue_successors(cpu, tb, pc, phys_pc, host_pc);
     return tb;
 }
 
+/*
+ * Called by the main loop when @tb has exited with TB_EXIT_PROMOTE,
+ * before executing any of its insns: replace it by a tier-2 translation.
+ */
+void tb_promote(CPUState *cpu, TranslationBlock *tb)
+{
+    vaddr pc;
+    uint64_t cs_base;
+    uint32_t flags, cflags;
+
+    cpu_get_tb_cpu_state(cpu_env(cpu), &pc, &cs_base, &flags);
+    cflags = tb_cflags(tb);
+    if ((cflags & CF_INVALID) || cs_base != tb->cs_base || flags != tb->flags) {
+        return;
+    }
+
+    mmap_lock();
+    tb_phys_invalidate(tb, -1);
+    tb = tb_gen_code(cpu, pc, cs_base, flags, cflags | CF_TIER2);
+    mmap_unlock();
+
+    /*
+     * Another vCPU may have retranslated the block at tier 1 in the
+     * meantime, in which case tb_gen_code returned that one instead.
+     */
+    if (tb_cflags(tb) & CF_TIER2) {
+        qatomic_inc(&tb_ctx.tb_promote_count);
+    }
+}
+
 /* user-mode: call with mmap_lock held */
 void tb_check_watchpoint(CPUState *cpu, uintptr_t retaddr)
 {
@@ -662,4 +751,18 @@ void tcg_flush_jmp_cache(CPUState *cpu)
     for (int i = 0; i < TB_JMP_CACHE_SIZE; i++) {
         qatomic_set(&jc->array[i].tb, NULL);
     }
+    tb_ras_clear(cpu);
+}
+
+/*
+ * The predictions of the return-address stack come from the jump
+ * cache, and must be dropped whenever it is flushed.  This may race
+ * with the vCPU itself only when @cpu's TBs are being invalidated, and
+ * translator_ras_return() checks CF_INVALID for that case.
+ */
+void tb_ras_clear(CPUState *cpu)
+{
+    for (int i = 0; i < TB_RAS_SIZE; i++) {
+        qatomic_set(&cpu->tb_ras.ent[i].tb, NULL);
+    }
 }
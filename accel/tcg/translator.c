@@ -16,6 +16,7 @@
 #include "exec/plugin-gen.h"
 #include "exec/cpu_ldst.h"
 #include "tcg/tcg-op-common.h"
+#include "internal-common.h"
 #include "internal-target.h"
 #include "disas/disas.h"
 
@@ -39,7 +40,39 @@ bool translator_io_start(DisasContextBase *db)
     return true;
 }
 
-static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags)
+static void gen_tb_exec_count(DisasContextBase *db, uint32_t cflags,
+                              TCGLabel **promote_label)
+{
+    TBExecCounter *counter = db->tb->exec_counter;
+    TCGv_ptr ptr;
+    TCGv_i64 count;
+
+    *promote_label = NULL;
+    if (!counter) {
+        return;
+    }
+
+    ptr = tcg_constant_ptr(&counter->count);
+    count = tcg_temp_new_i64();
+    tcg_gen_ld_i64(count, ptr, 0);
+    tcg_gen_addi_i64(count, count, 1);
+    tcg_gen_st_i64(count, ptr, 0);
+
+    /*
+     * Leave a tier-1 TB, before executing anything, exactly once when
+     * it becomes hot.  Racing increments from other vCPUs may lose a
+     * count or skip the threshold, which only delays or suppresses the
+     * promotion.
+     */
+    if (!(cflags & CF_TIER2)) {
+        *promote_label = gen_new_label();
+        tcg_gen_brcondi_i64(TCG_COND_EQ, count, tb_tier2_threshold,
+                            *promote_label);
+    }
+}
+
+static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags,
+                           TCGLabel **promote_label)
 {
     TCGv_i32 count = NULL;
     TCGOp *icount_start_insn = NULL;
@@ -75,6 +108,9 @@ static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags)
         tcg_gen_brcondi_i32(TCG_COND_LT, count, 0, tcg_ctx->exitreq_label);
     }
 
+    /* Count the execution only once we know that the TB will run. */
+    gen_tb_exec_count(db, cflags, promote_label);
+
     if (cflags & CF_USE_ICOUNT) {
         tcg_gen_st16_i32(count, tcg_env,
                          offsetof(ArchCPU, parent_obj.neg.icount_decr.u16.low)
@@ -85,7 +121,8 @@ static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags)
 }
 
 static void gen_tb_end(const TranslationBlock *tb, uint32_t cflags,
-                       TCGOp *icount_start_insn, int num_insns)
+                       TCGOp *icount_start_insn, TCGLabel *promote_label,
+                       int num_insns)
 {
     if (cflags & CF_USE_ICOUNT) {
         /*
@@ -100,6 +137,11 @@ static void gen_tb_end(const TranslationBlock *tb, uint32_t cflags,
         gen_set_label(tcg_ctx->exitreq_label);
         tcg_gen_exit_tb(tb, TB_EXIT_REQUESTED);
     }
+
+    if (promote_label) {
+        gen_set_label(promote_label);
+        tcg_gen_exit_tb(tb, TB_EXIT_PROMOTE);
+    }
 }
 
 bool translator_use_goto_tb(DisasContextBase *db, vaddr dest)
@@ -110,7 +152,236 @@ bool translator_use_goto_tb(DisasContextBase *db, vaddr dest)
     }
 
     /* Check for the dest on the same page as the start of the TB.  */
-    return ((db->pc_first ^ dest) & TARGET_PAGE_MASK) == 0;
+    if (((db->pc_first ^ dest) & TARGET_PAGE_MASK) != 0) {
+        return false;
+    }
+
+    /* Remember the destination for the translation workers. */
+    if (tcg_ctx->gen_tb_nb_succ < ARRAY_SIZE(tcg_ctx->gen_tb_succ) &&
+        (tcg_ctx->gen_tb_nb_succ == 0 || tcg_ctx->gen_tb_succ[0] != dest)) {
+        tcg_ctx->gen_tb_succ[tcg_ctx->gen_tb_nb_succ++] = dest;
+    }
+    return true;
+}
+
+#ifndef CONFIG_USER_ONLY
+/*
+ * Host page that the translating vCPU currently executes @dest from,
+ * or NULL if its TLB has no entry for it.  Translation must not fill
+ * the TLB for code that has not run yet, which could set accessed
+ * bits in the guest page tables.
+ */
+static void *translator_xpage_host(vaddr dest)
+{
+    CPUState *cpu = tcg_ctx->cpu;
+
+    return tlb_vaddr_to_host_nofill(cpu_env(cpu), dest & TARGET_PAGE_MASK,
+                                    MMU_INST_FETCH, cpu_mmu_index(cpu, true));
+}
+#endif
+
+bool translator_use_goto_tb_xpage(DisasContextBase *db, vaddr dest)
+{
+#ifdef CONFIG_USER_ONLY
+    return false;
+#else
+    if (tb_cflags(db->tb) & CF_NO_GOTO_TB) {
+        return false;
+    }
+
+    /* Translation workers may not look at the TLB of a vCPU. */
+    if (tcg_ctx->speculative) {
+        return false;
+    }
+
+    /* Only RAM can be tracked by the guard. */
+    return translator_xpage_host(dest) != NULL;
+#endif
+}
+
+TCGLabel *translator_goto_tb_xpage(DisasContextBase *db, int idx, vaddr dest,
+                                   TCGv_i64 dest_val)
+{
+#ifdef CONFIG_USER_ONLY
+    g_assert_not_reached();
+#else
+    CPUState *cpu = tcg_ctx->cpu;
+    int fast_ofs = offsetof(ArchCPU,
+                            parent_obj.neg.tlb.f[cpu_mmu_index(cpu, true)])
+                   - offsetof(ArchCPU, env);
+    int miss_ofs = offsetof(ArchCPU, parent_obj.tb_xpage_miss_count)
+                   - offsetof(ArchCPU, env);
+    int jmp_ofs = offsetof(ArchCPU, parent_obj.tb_xpage_jmp_count)
+                  - offsetof(ArchCPU, env);
+    uintptr_t host = (uintptr_t)translator_xpage_host(dest);
+    TCGLabel *miss = gen_new_label();
+    TCGv_i64 page = tcg_temp_new_i64();
+    TCGv_i64 ofs = tcg_temp_new_i64();
+    TCGv_i64 t64 = tcg_temp_new_i64();
+    TCGv_i64 count = tcg_temp_new_i64();
+    TCGv_ptr entry = tcg_temp_new_ptr();
+    TCGv_ptr tptr = tcg_temp_new_ptr();
+
+    /*
+     * The link is shared by all vCPUs, and survives changes to their
+     * page tables.  Only take it if the running vCPU has @dest mapped
+     * for execution to the same RAM page as when we translated, which
+     * is exactly the condition for tb_lookup() to find the TB that it
+     * was linked to.  Otherwise leave through @miss, whose exit must
+     * not be linkable: tb_add_jump() would link it to the TB for the
+     * other mapping, which the vCPUs that pass the guard would then
+     * jump to.
+     */
+    if (tb_cflags(db->tb) & CF_PCREL) {
+        tcg_debug_assert(dest_val);
+        tcg_gen_andi_i64(page, dest_val, TARGET_PAGE_MASK);
+    } else {
+        tcg_gen_movi_i64(page, dest & TARGET_PAGE_MASK);
+    }
+
+    /* entry = &table[tlb_index(page)] */
+    tcg_gen_ld_ptr(tptr, tcg_env, fast_ofs + offsetof(CPUTLBDescFast, mask));
+    tcg_gen_extu_ptr_i64(t64, tptr);
+    tcg_gen_shri_i64(ofs, page, TARGET_PAGE_BITS - CPU_TLB_ENTRY_BITS);
+    tcg_gen_and_i64(ofs, ofs, t64);
+    tcg_gen_trunc_i64_ptr(entry, ofs);
+    tcg_gen_ld_ptr(tptr, tcg_env, fast_ofs + offsetof(CPUTLBDescFast, table));
+    tcg_gen_add_ptr(entry, entry, tptr);
+
+    /* The entry must hit for execution, without any flags... */
+    tcg_gen_ld_i64(t64, entry, offsetof(CPUTLBEntry, addr_code));
+    tcg_gen_setcond_i64(TCG_COND_NE, ofs, t64, page);
+
+    /* ... and point to the same host page. */
+    tcg_gen_ld_ptr(entry, entry, offsetof(CPUTLBEntry, addend));
+    tcg_gen_trunc_i64_ptr(tptr, page);
+    tcg_gen_add_ptr(entry, entry, tptr);
+    tcg_gen_extu_ptr_i64(t64, entry);
+    tcg_gen_setcondi_i64(TCG_COND_NE, t64, t64, host);
+    tcg_gen_or_i64(ofs, ofs, t64);
+
+    /* Count the outcome without a branch, then take it. */
+    tcg_gen_ld_i64(count, tcg_env, miss_ofs);
+    tcg_gen_add_i64(count, count, ofs);
+    tcg_gen_st_i64(count, tcg_env, miss_ofs);
+    tcg_gen_brcondi_i64(TCG_COND_NE, ofs, 0, miss);
+
+    tcg_gen_ld_i64(count, tcg_env, jmp_ofs);
+    tcg_gen_addi_i64(count, count, 1);
+    tcg_gen_st_i64(count, tcg_env, jmp_ofs);
+
+    tcg_gen_goto_tb(idx);
+    return miss;
+#endif
+}
+
+static bool translator_use_ras(DisasContextBase *db)
+{
+    /* The lookup key of the next TB must be the one of this TB. */
+    return tb_ras_enabled &&
+           !(tb_cflags(db->tb) & (CF_COUNT_MASK | CF_NO_GOTO_PTR |
+                                  CF_SINGLE_STEP | CF_NOIRQ | CF_BP_PAGE));
+}
+
+void translator_ras_push(DisasContextBase *db, TCGv_i64 ret_pc)
+{
+    if (translator_use_ras(db)) {
+        gen_helper_ras_push(tcg_env, ret_pc);
+    }
+}
+
+void translator_ras_return(DisasContextBase *db, TCGv_i64 dest)
+{
+    TranslationBlock *tb = db->tb;
+    int ras_ofs = offsetof(ArchCPU, parent_obj.tb_ras) -
+                  offsetof(ArchCPU, env);
+    TCGLabel *miss;
+    TCGv_i32 t32;
+    TCGv_i64 t64;
+    TCGv_ptr entry, ptb;
+
+    if (!translator_use_ras(db)) {
+        tcg_gen_lookup_and_goto_ptr();
+        return;
+    }
+
+    miss = gen_new_label();
+    t32 = tcg_temp_new_i32();
+    t64 = tcg_temp_new_i64();
+    entry = tcg_temp_new_ptr();
+    ptb = tcg_temp_new_ptr();
+
+    /* Pop the prediction. */
+    tcg_gen_ld_i32(t32, tcg_env, ras_ofs + offsetof(CPUReturnStack, top));
+    tcg_gen_subi_i32(t32, t32, 1);
+    tcg_gen_st_i32(t32, tcg_env, ras_ofs + offsetof(CPUReturnStack, top));
+    tcg_gen_andi_i32(t32, t32, TB_RAS_SIZE - 1);
+    tcg_gen_muli_i32(t32, t32, sizeof(((CPUReturnStack *)0)->ent[0]));
+    tcg_gen_ext_i32_ptr(entry, t32);
+    tcg_gen_add_ptr(entry, entry, tcg_env);
+
+    tcg_gen_ld_i64(t64, entry,
+                   ras_ofs + offsetof(CPUReturnStack, ent[0].pc));
+    tcg_gen_brcond_i64(TCG_COND_NE, t64, dest, miss);
+    tcg_gen_ld_ptr(ptb, entry,
+                   ras_ofs + offsetof(CPUReturnStack, ent[0].tb));
+    tcg_gen_brcondi_ptr(TCG_COND_EQ, ptb, 0, miss);
+
+    /*
+     * The predicted TB came from the jump cache, so it was found for
+     * @dest by tb_lookup() with the CPU state of the time of the call.
+     * It is still good if it has the lookup key that tb_lookup() would
+     * use now, which the caller guarantees is the one of this TB, and
+     * has not been invalidated since.
+     */
+    tcg_gen_ld_i32(t32, ptb, offsetof(TranslationBlock, flags));
+    tcg_gen_brcondi_i32(TCG_COND_NE, t32, tb->flags, miss);
+    tcg_gen_ld_i64(t64, ptb, offsetof(TranslationBlock, cs_base));
+    tcg_gen_brcondi_i64(TCG_COND_NE, t64, tb->cs_base, miss);
+    tcg_gen_ld_i32(t32, ptb, offsetof(TranslationBlock, cflags));
+    tcg_gen_andi_i32(t32, t32, ~CF_TIER2);
+    tcg_gen_brcondi_i32(TCG_COND_NE, t32, tb_cflags(tb) & ~CF_TIER2, miss);
+
+    tcg_gen_ld_i64(t64, tcg_env,
+                   ras_ofs + offsetof(CPUReturnStack, hit_count));
+    tcg_gen_addi_i64(t64, t64, 1);
+    tcg_gen_st_i64(t64, tcg_env,
+                   ras_ofs + offsetof(CPUReturnStack, hit_count));
+    tcg_gen_ld_ptr(ptb, ptb, offsetof(TranslationBlock, tc.ptr));
+    tcg_gen_goto_ptr(ptb);
+
+    gen_set_label(miss);
+    tcg_gen_ld_i64(t64, tcg_env,
+                   ras_ofs + offsetof(CPUReturnStack, miss_count));
+    tcg_gen_addi_i64(t64, t64, 1);
+    tcg_gen_st_i64(t64, tcg_env,
+                   ras_ofs + offsetof(CPUReturnStack, miss_count));
+    tcg_gen_lookup_and_goto_ptr();
+}
+
+bool translator_follow_jump(DisasContextBase *db, vaddr dest)
+{
+    uint32_t cflags = tb_cflags(db->tb);
+
+    if (!(cflags & CF_TIER2) || (cflags & CF_NO_GOTO_TB)) {
+        return false;
+    }
+
+    /* Plugins expect each insn to be followed by the next in memory. */
+    if (db->plugin_enabled) {
+        return false;
+    }
+
+    /*
+     * Only follow forward branches within the first page, so that
+     * [pc_first, pc_next) continues to cover all guest code that has
+     * been read, and so the page tracking of the TB remains correct.
+     */
+    if (dest < db->pc_next || ((db->pc_first ^ dest) & TARGET_PAGE_MASK)) {
+        return false;
+    }
+
+    return db->num_insns < db->max_insns;
 }
 
 void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
@@ -120,6 +391,7 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
     uint32_t cflags = tb_cflags(tb);
     TCGOp *icount_start_insn;
     TCGOp *first_insn_start = NULL;
+    TCGLabel *promote_label;
     bool plugin_enabled;
 
     /* Initialize DisasContext */
@@ -140,7 +412,7 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
     /* Start translating.  */
-    icount_start_insn = gen_tb_start(db, cflags);
+    icount_start_insn = gen_tb_start(db, cflags, &promote_label);
     ops->tb_start(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
@@ -196,7 +468,7 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
 
     /* Emit code to exit the TB, as indicated by db->is_jmp.  */
     ops->tb_stop(db, cpu);
-    gen_tb_end(tb, cflags, icount_start_insn, db->num_insns);
+    gen_tb_end(tb, cflags, icount_start_insn, promote_label, db->num_insns);
 
     /*
      * Manage can_do_io for the translation block: set to false before
@@ -250,6 +522,8 @@ static bool translator_ld(CPUArchState *env, DisasContextBase *db,
     if (unlikely(tb_page_addr0(tb) == -1)) {
         /* We capped translation with first page MMIO in tb_gen_code. */
         tcg_debug_assert(db->max_insns == 1);
+        /* The caller falls back to cpu_ld*_code(). */
+        tb_worker_check_fetch();
         return false;
     }
 
@@ -289,6 +563,7 @@ static bool translator_ld(CPUArchState *env, DisasContextBase *db,
     if (host == NULL) {
         tb_page_addr_t page0, old_page1, new_page1;
 
+        tb_worker_check_fetch();
         new_page1 = get_page_addr_code_hostp(env, base, &db->host_addr[1]);
 
         /*
@@ -23,6 +23,7 @@
 #include "tcg/tcg.h"
 #include "qemu/bitops.h"
 #include "qemu/rcu.h"
+#include "qemu/seqlock.h"
 #include "exec/cpu_ldst.h"
 #include "qemu/main-loop.h"
 #include "exec/translate-all.h"
@@ -154,6 +155,14 @@ typedef struct PageFlagsNode {
 
 static IntervalTreeRoot pageflags_root;
 
+/*
+ * Modifications of pageflags_root are serialized by mmap_lock, and
+ * each complete update is bracketed by pageflags_seq.  A lookup that
+ * sees no concurrent update is exact, for misses as well as hits, so
+ * readers never need to fall back to mmap_lock.
+ */
+static QemuSeqLock pageflags_seq;
+
 static PageFlagsNode *pageflags_find(target_ulong start, target_ulong last)
 {
     IntervalTreeNode *n;
@@ -215,25 +224,41 @@ void page_dump(FILE *f)
     walk_memory_regions(f, dump_region);
 }
 
-int page_get_flags(target_ulong address)
+/*
+ * Find the first node overlapping [start,last] and return a copy of it
+ * in @copy, or NULL.  Without mmap_lock, retry until the lookup did not
+ * race with an update of the tree.
+ */
+static PageFlagsNode *pageflags_find_copy(target_ulong start,
+                                          target_ulong last,
+                                          PageFlagsNode *copy)
 {
-    PageFlagsNode *p = pageflags_find(address, address);
+    PageFlagsNode *p;
+    unsigned seq;
 
-    /*
-     * See util/interval-tree.c re lockless lookups: no false positives but
-     * there are false negatives.  If we find nothing, retry with the mmap
-     * lock acquired.
-     */
-    if (p) {
-        return p->flags;
-    }
     if (have_mmap_lock()) {
-        return 0;
+        return pageflags_find(start, last);
     }
 
-    mmap_lock();
-    p = pageflags_find(address, address);
-    mmap_unlock();
+    RCU_READ_LOCK_GUARD();
+    do {
+        seq = seqlock_read_begin(&pageflags_seq);
+        p = pageflags_find(start, last);
+        if (p) {
+            copy->itree.start = p->itree.start;
+            copy->itree.last = p->itree.last;
+            copy->flags = p->flags;
+        }
+    } while (seqlock_read_retry(&pageflags_seq, seq));
+
+    return p ? copy : NULL;
+}
+
+int page_get_flags(target_ulong address)
+{
+    PageFlagsNode copy;
+    PageFlagsNode *p = pageflags_find_copy(address, address, &copy);
+
     return p ? p->flags : 0;
 }
 
@@ -512,6 +537,7 @@ void page_set_flags(target_ulong start, target_ulong last, int flags)
         }
     }
 
+    seqlock_write_begin(&pageflags_seq);
     if (!flags || reset) {
         page_reset_target_data(start, last);
         inval_tb |= pageflags_unset(start, last);
@@ -520,6 +546,7 @@ void page_set_flags(target_ulong start, target_ulong last, int flags)
         inval_tb |= pageflags_set_clear(start, last, flags,
                                         ~(reset ? 0 : PAGE_STICKY));
     }
+    seqlock_write_end(&pageflags_seq);
     if (inval_tb) {
         tb_invalidate_phys_range(start, last);
     }
@@ -528,7 +555,6 @@ void page_set_flags(target_ulong start, target_ulong last, int flags)
 bool page_check_range(target_ulong start, target_ulong len, int flags)
 {
     target_ulong last;
-    int locked;  /* tri-state: =0: unlocked, +1: global, -1: local */
     bool ret;
 
     if (len == 0) {
@@ -540,25 +566,14 @@ bool page_check_range(target_ulong start, target_ulong len, int flags)
         return false; /* wrap around */
     }
 
-    locked = have_mmap_lock();
     while (true) {
-        PageFlagsNode *p = pageflags_find(start, last);
+        PageFlagsNode copy;
+        PageFlagsNode *p = pageflags_find_copy(start, last, &copy);
         int missing;
 
         if (!p) {
-            if (!locked) {
-                /*
-                 * Lockless lookups have false negatives.
-                 * Retry with the lock held.
-                 */
-                mmap_lock();
-                locked = -1;
-                p = pageflags_find(start, last);
-            }
-            if (!p) {
-                ret = false; /* entire region invalid */
-                break;
-            }
+            ret = false; /* entire region invalid */
+            break;
         }
         if (start < p->itree.start) {
             ret = false; /* initial bytes invalid */
@@ -596,10 +611,6 @@ bool page_check_range(target_ulong start, target_ulong len, int flags)
         start = p->itree.last + 1;
     }
 
-    /* Release the lock if acquired locally. */
-    if (locked < 0) {
-        mmap_unlock();
-    }
     return ret;
 }
 
@@ -683,7 +694,9 @@ void page_protect(tb_page_addr_t address)
     }
 
     if (prot & PAGE_WRITE) {
+        seqlock_write_begin(&pageflags_seq);
         pageflags_set_clear(start, last, 0, PAGE_WRITE);
+        seqlock_write_end(&pageflags_seq);
         mprotect(g2h_untagged(start), last - start + 1,
                  prot & (PAGE_READ | PAGE_EXEC) ? PROT_READ : PROT_NONE);
     }
@@ -698,9 +711,16 @@ void page_protect(tb_page_addr_t address)
  */
 int page_unprotect(target_ulong address, uintptr_t pc)
 {
+    PageFlagsNode copy;
     PageFlagsNode *p;
     bool current_tb_invalidated;
 
+    /* Genuine faults on read-only pages do not need the lock. */
+    p = pageflags_find_copy(address, address, &copy);
+    if (!p || !(p->flags & PAGE_WRITE_ORG)) {
+        return 0;
+    }
+
     /*
      * Technically this isn't safe inside a signal handler.  However we
      * know this only ever happens in a synchronous SEGV handler, so in
@@ -738,7 +758,9 @@ int page_unprotect(target_ulong address, uintptr_t pc)
             start = address & TARGET_PAGE_MASK;
             len = TARGET_PAGE_SIZE;
             prot = p->flags | PAGE_WRITE;
+            seqlock_write_begin(&pageflags_seq);
             pageflags_set_clear(start, start + len - 1, PAGE_WRITE, 0);
+            seqlock_write_end(&pageflags_seq);
             current_tb_invalidated = tb_invalidate_phys_page_unwind(start, pc);
         } else {
             start = address & -host_page_size;
@@ -753,8 +775,10 @@ int page_unprotect(target_ulong address, uintptr_t pc)
                     prot |= p->flags;
                     if (p->flags & PAGE_WRITE_ORG) {
                         prot |= PAGE_WRITE;
+                        seqlock_write_begin(&pageflags_seq);
                         pageflags_set_clear(addr, addr + TARGET_PAGE_SIZE - 1,
                                             PAGE_WRITE, 0);
+                        seqlock_write_end(&pageflags_seq);
                     }
                 }
                 /*
@@ -1279,7 +1303,5 @@ static void *atomic_mmu_lookup(CPUState *cpu, vaddr addr, MemOpIdx oi,
 #include "atomic_template.h"
 #endif
 
-#if defined(CONFIG_ATOMIC128) || HAVE_CMPXCHG128
 #define DATA_SIZE 16
 #include "atomic_template.h"
-#endif
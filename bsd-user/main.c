@@ -214,6 +214,12 @@ void qemu_cpu_kick(CPUState *cpu)
     cpu_exit(cpu);
 }
 
+bool cpu_vdso_syscall(CPUState *cpu)
+{
+    /* There is no vDSO for BSD guests. */
+    return false;
+}
+
 /* Assumes contents are already zeroed.  */
 static void init_task_state(TaskState *ts)
 {
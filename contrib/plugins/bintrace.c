@@ -0,0 +1,161 @@
+/*
+ * Write a compact binary trace of executed instructions and memory
+ * accesses. Records are appended to per-vCPU trace buffers by the
+ * generated code and written out in batches, so the plugin is not
+ * called back for each instruction or access.
+ *
+ * The file starts with a header:
+ *
+ *   char     magic[8];       "QEMUBTRC"
+ *   uint32_t version;        1
+ *   uint32_t record_size;    sizeof(qemu_plugin_trace_record)
+ *
+ * followed by chunks, each a header and the records of one vCPU in
+ * execution order:
+ *
+ *   uint32_t vcpu_index;
+ *   uint32_t n;
+ *   qemu_plugin_trace_record records[n];
+ *
+ * All fields are in host byte order. The flags of each record hold the
+ * size of the instruction in bytes. The info of an instruction record
+ * is 0, for a memory access it is the meminfo of the access.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define BINTRACE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} BinTraceHeader;
+
+typedef struct {
+    uint32_t vcpu_index;
+    uint32_t n;
+} BinTraceChunk;
+
+static const char *file_name = "bintrace.bin";
+static FILE *fp;
+static GMutex lock;
+
+static struct qemu_plugin_trace_buffer *trace;
+static size_t buffer_records = 64 * 1024;
+static bool trace_insns = true;
+static enum qemu_plugin_mem_rw rw = QEMU_PLUGIN_MEM_RW;
+
+static void write_or_die(const void *data, size_t size)
+{
+    if (fwrite(data, size, 1, fp) != 1) {
+        fprintf(stderr, "bintrace: failed to write %s\n", file_name);
+        abort();
+    }
+}
+
+static void drain(unsigned int vcpu_index,
+                  const qemu_plugin_trace_record *records,
+                  size_t n, void *userdata)
+{
+    BinTraceChunk chunk = { .vcpu_index = vcpu_index, .n = n };
+
+    g_mutex_lock(&lock);
+    write_or_die(&chunk, sizeof(chunk));
+    write_or_die(records, n * sizeof(*records));
+    g_mutex_unlock(&lock);
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb);
+
+    for (size_t i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        uint32_t size = qemu_plugin_insn_size(insn);
+
+        if (trace_insns) {
+            qemu_plugin_register_vcpu_insn_exec_trace(insn, trace, size);
+        }
+        if (rw) {
+            qemu_plugin_register_vcpu_mem_trace(insn, rw, trace, size);
+        }
+    }
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    qemu_plugin_trace_buffer_flush(trace);
+    qemu_plugin_trace_buffer_free(trace);
+
+    g_mutex_lock(&lock);
+    fclose(fp);
+    g_mutex_unlock(&lock);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    BinTraceHeader header = {
+        .version = BINTRACE_VERSION,
+        .record_size = sizeof(qemu_plugin_trace_record),
+    };
+
+    for (int i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_auto(GStrv) tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "outfile") == 0) {
+            file_name = g_strdup(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "insn") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &trace_insns)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "mem") == 0) {
+            if (g_strcmp0(tokens[1], "none") == 0) {
+                rw = 0;
+            } else if (g_strcmp0(tokens[1], "r") == 0) {
+                rw = QEMU_PLUGIN_MEM_R;
+            } else if (g_strcmp0(tokens[1], "w") == 0) {
+                rw = QEMU_PLUGIN_MEM_W;
+            } else if (g_strcmp0(tokens[1], "rw") == 0) {
+                rw = QEMU_PLUGIN_MEM_RW;
+            } else {
+                fprintf(stderr, "invalid value for mem: %s\n", tokens[1]);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "buffer") == 0) {
+            buffer_records = g_ascii_strtoull(tokens[1], NULL, 0);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    fp = fopen(file_name, "wb");
+    if (!fp) {
+        fprintf(stderr, "bintrace: failed to open %s\n", file_name);
+        return -1;
+    }
+    memcpy(header.magic, "QEMUBTRC", sizeof(header.magic));
+    write_or_die(&header, sizeof(header));
+
+    trace = qemu_plugin_trace_buffer_new(buffer_records, drain, NULL);
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+
+    return 0;
+}
@@ -20,10 +20,11 @@ static enum qemu_plugin_mem_rw rw = QEMU_PLUGIN_MEM_RW;
 static GHashTable *miss_ht;
 
 static GMutex hashtable_lock;
-static GRand *rng;
 
 static int limit;
 static bool sys;
+static int sample = 1;
+static int64_t start_time;
 
 enum EvictionPolicy {
     LRU,
@@ -54,6 +55,9 @@ enum EvictionPolicy policy;
  * match is found, then the access is a hit.
  *
  * The CacheSet also contains bookkeaping information about eviction details.
+ *
+ * Sets are independent of each other, which is what allows a cache shared
+ * by several vCPUs to be locked by set rather than as a whole.
  */
 
 typedef struct {
@@ -66,6 +70,7 @@ typedef struct {
     uint64_t *lru_priorities;
     uint64_t lru_gen_counter;
     GQueue *fifo_queue;
+    uint32_t rand_state;
 } CacheSet;
 
 typedef struct {
@@ -76,10 +81,21 @@ typedef struct {
     int blksize_shift;
     uint64_t set_mask;
     uint64_t tag_mask;
-    uint64_t accesses;
-    uint64_t misses;
 } Cache;
 
+/*
+ * Accesses and misses are counted per vCPU, so that vCPUs sharing a cache
+ * model do not also share counters.
+ */
+typedef struct {
+    uint64_t l1_daccesses;
+    uint64_t l1_dmisses;
+    uint64_t l1_iaccesses;
+    uint64_t l1_imisses;
+    uint64_t l2_accesses;
+    uint64_t l2_misses;
+} CacheStats;
+
 typedef struct {
     char *disas_str;
     const char *symbol;
@@ -99,19 +115,17 @@ static int cores;
 static Cache **l1_dcaches, **l1_icaches;
 
 static bool use_l2;
+static bool l2_shared;
+static int l2_count;
 static Cache **l2_ucaches;
 
+#define L2_LOCK_SHARDS 64
+
 static GMutex *l1_dcache_locks;
 static GMutex *l1_icache_locks;
 static GMutex *l2_ucache_locks;
 
-static uint64_t l1_dmem_accesses;
-static uint64_t l1_imem_accesses;
-static uint64_t l1_imisses;
-static uint64_t l1_dmisses;
-
-static uint64_t l2_mem_accesses;
-static uint64_t l2_misses;
+static struct qemu_plugin_scoreboard *stats;
 
 static int pow_of_two(int num)
 {
@@ -179,6 +193,31 @@ static void lru_priorities_destroy(Cache *cache)
     }
 }
 
+/*
+ * Random eviction policy: each set has its own xorshift generator, so that
+ * picking a victim only touches the set, like the other policies.
+ */
+
+static void rand_init(Cache *cache)
+{
+    int i;
+
+    for (i = 0; i < cache->num_sets; i++) {
+        cache->sets[i].rand_state = g_random_int() | 1;
+    }
+}
+
+static int rand_get_block(Cache *cache, int set)
+{
+    uint32_t x = cache->sets[set].rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cache->sets[set].rand_state = x;
+    return x % cache->assoc;
+}
+
 /*
  * FIFO eviction policy: a FIFO queue is maintained for each CacheSet that
  * stores accesses to the cache.
@@ -264,8 +303,6 @@ static Cache *cache_init(int blksize, int assoc, int cachesize)
     cache->num_sets = cachesize / (blksize * assoc);
     cache->sets = g_new(CacheSet, cache->num_sets);
     cache->blksize_shift = pow_of_two(blksize);
-    cache->accesses = 0;
-    cache->misses = 0;
 
     for (i = 0; i < cache->num_sets; i++) {
         cache->sets[i].blocks = g_new0(CacheBlock, assoc);
@@ -282,7 +319,7 @@ static Cache *cache_init(int blksize, int assoc, int cachesize)
     return cache;
 }
 
-static Cache **caches_init(int blksize, int assoc, int cachesize)
+static Cache **caches_init(int blksize, int assoc, int cachesize, int n)
 {
     Cache **caches;
     int i;
@@ -291,9 +328,9 @@ static Cache **caches_init(int blksize, int assoc, int cachesize)
         return NULL;
     }
 
-    caches = g_new(Cache *, cores);
+    caches = g_new(Cache *, n);
 
-    for (i = 0; i < cores; i++) {
+    for (i = 0; i < n; i++) {
         caches[i] = cache_init(blksize, assoc, cachesize);
     }
 
@@ -317,7 +354,7 @@ static int get_replaced_block(Cache *cache, int set)
 {
     switch (policy) {
     case RAND:
-        return g_rand_int_range(rng, 0, cache->assoc);
+        return rand_get_block(cache, set);
     case LRU:
         return lru_get_lru_block(cache, set);
     case FIFO:
@@ -385,13 +422,55 @@ static bool access_cache(Cache *cache, uint64_t addr)
     return false;
 }
 
+/*
+ * With sampling, only the accesses that map to one in every "sample" sets
+ * of the L1 cache are simulated.  If the L2 cache has the same block size,
+ * they also map to one in every "sample" sets of the L2 cache.
+ */
+static inline bool is_sampled(Cache *cache, uint64_t addr)
+{
+    return extract_set(cache, addr) % sample == 0;
+}
+
+static Cache *l2_cache(int cache_idx)
+{
+    return l2_ucaches[l2_shared ? 0 : cache_idx];
+}
+
+static GMutex *l2_lock(int cache_idx, uint64_t addr)
+{
+    if (l2_shared) {
+        return &l2_ucache_locks[extract_set(l2_ucaches[0], addr) %
+                                L2_LOCK_SHARDS];
+    }
+    return &l2_ucache_locks[cache_idx];
+}
+
+static void access_l2(int cache_idx, uint64_t addr, CacheStats *st,
+                      InsnData *insn)
+{
+    GMutex *lock = l2_lock(cache_idx, addr);
+    bool hit;
+
+    g_mutex_lock(lock);
+    hit = access_cache(l2_cache(cache_idx), addr);
+    g_mutex_unlock(lock);
+
+    st->l2_accesses++;
+    if (!hit) {
+        __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_RELAXED);
+        st->l2_misses++;
+    }
+}
+
 static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
                             uint64_t vaddr, void *userdata)
 {
     uint64_t effective_addr;
     struct qemu_plugin_hwaddr *hwaddr;
+    CacheStats *st;
     int cache_idx;
-    InsnData *insn;
+    InsnData *insn = userdata;
     bool hit_in_l1;
 
     hwaddr = qemu_plugin_get_hwaddr(info, vaddr);
@@ -401,65 +480,61 @@ static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
 
     effective_addr = hwaddr ? qemu_plugin_hwaddr_phys_addr(hwaddr) : vaddr;
     cache_idx = vcpu_index % cores;
+    if (!is_sampled(l1_dcaches[cache_idx], effective_addr)) {
+        return;
+    }
 
     g_mutex_lock(&l1_dcache_locks[cache_idx]);
     hit_in_l1 = access_cache(l1_dcaches[cache_idx], effective_addr);
+    g_mutex_unlock(&l1_dcache_locks[cache_idx]);
+
+    st = qemu_plugin_scoreboard_find(stats, vcpu_index);
+    st->l1_daccesses++;
     if (!hit_in_l1) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l1_dmisses, 1, __ATOMIC_SEQ_CST);
-        l1_dcaches[cache_idx]->misses++;
+        __atomic_fetch_add(&insn->l1_dmisses, 1, __ATOMIC_RELAXED);
+        st->l1_dmisses++;
     }
-    l1_dcaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l1_dcache_locks[cache_idx]);
 
     if (hit_in_l1 || !use_l2) {
         /* No need to access L2 */
         return;
     }
 
-    g_mutex_lock(&l2_ucache_locks[cache_idx]);
-    if (!access_cache(l2_ucaches[cache_idx], effective_addr)) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_SEQ_CST);
-        l2_ucaches[cache_idx]->misses++;
-    }
-    l2_ucaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
+    access_l2(cache_idx, effective_addr, st, insn);
 }
 
 static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
 {
     uint64_t insn_addr;
-    InsnData *insn;
+    InsnData *insn = userdata;
+    CacheStats *st;
     int cache_idx;
     bool hit_in_l1;
 
-    insn_addr = ((InsnData *) userdata)->addr;
+    insn_addr = insn->addr;
 
     cache_idx = vcpu_index % cores;
+    if (!is_sampled(l1_icaches[cache_idx], insn_addr)) {
+        return;
+    }
+
     g_mutex_lock(&l1_icache_locks[cache_idx]);
     hit_in_l1 = access_cache(l1_icaches[cache_idx], insn_addr);
+    g_mutex_unlock(&l1_icache_locks[cache_idx]);
+
+    st = qemu_plugin_scoreboard_find(stats, vcpu_index);
+    st->l1_iaccesses++;
     if (!hit_in_l1) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l1_imisses, 1, __ATOMIC_SEQ_CST);
-        l1_icaches[cache_idx]->misses++;
+        __atomic_fetch_add(&insn->l1_imisses, 1, __ATOMIC_RELAXED);
+        st->l1_imisses++;
     }
-    l1_icaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l1_icache_locks[cache_idx]);
 
     if (hit_in_l1 || !use_l2) {
         /* No need to access L2 */
         return;
     }
 
-    g_mutex_lock(&l2_ucache_locks[cache_idx]);
-    if (!access_cache(l2_ucaches[cache_idx], insn_addr)) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_SEQ_CST);
-        l2_ucaches[cache_idx]->misses++;
-    }
-    l2_ucaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
+    access_l2(cache_idx, insn_addr, st, insn);
 }
 
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
@@ -526,11 +601,11 @@ static void cache_free(Cache *cache)
     g_free(cache);
 }
 
-static void caches_free(Cache **caches)
+static void caches_free(Cache **caches, int n)
 {
     int i;
 
-    for (i = 0; i < cores; i++) {
+    for (i = 0; i < n; i++) {
         cache_free(caches[i]);
     }
 }
@@ -564,22 +639,14 @@ static void append_stats_line(GString *line,
     g_string_append(line, "\n");
 }
 
-static void sum_stats(void)
+static void sum_stats(CacheStats *sum, const CacheStats *st)
 {
-    int i;
-
-    g_assert(cores > 1);
-    for (i = 0; i < cores; i++) {
-        l1_imisses += l1_icaches[i]->misses;
-        l1_dmisses += l1_dcaches[i]->misses;
-        l1_imem_accesses += l1_icaches[i]->accesses;
-        l1_dmem_accesses += l1_dcaches[i]->accesses;
-
-        if (use_l2) {
-            l2_misses += l2_ucaches[i]->misses;
-            l2_mem_accesses += l2_ucaches[i]->accesses;
-        }
-    }
+    sum->l1_daccesses += st->l1_daccesses;
+    sum->l1_dmisses += st->l1_dmisses;
+    sum->l1_iaccesses += st->l1_iaccesses;
+    sum->l1_imisses += st->l1_imisses;
+    sum->l2_accesses += st->l2_accesses;
+    sum->l2_misses += st->l2_misses;
 }
 
 static int dcmp(gconstpointer a, gconstpointer b)
@@ -609,7 +676,9 @@ static int l2_cmp(gconstpointer a, gconstpointer b)
 static void log_stats(void)
 {
     int i;
-    Cache *icache, *dcache, *l2_cache;
+    CacheStats *core_stats = g_new0(CacheStats, cores);
+    CacheStats total = {};
+    double elapsed;
 
     g_autoptr(GString) rep = g_string_new("core #, data accesses, data misses,"
                                           " dmiss rate, insn accesses,"
@@ -621,27 +690,43 @@ static void log_stats(void)
 
     g_string_append(rep, "\n");
 
+    for (i = 0; i < qemu_plugin_num_vcpus(); i++) {
+        sum_stats(&core_stats[i % cores],
+                  qemu_plugin_scoreboard_find(stats, i));
+    }
+
     for (i = 0; i < cores; i++) {
+        CacheStats *st = &core_stats[i];
+
         g_string_append_printf(rep, "%-8d", i);
-        dcache = l1_dcaches[i];
-        icache = l1_icaches[i];
-        l2_cache = use_l2 ? l2_ucaches[i] : NULL;
-        append_stats_line(rep, dcache->accesses, dcache->misses,
-                icache->accesses, icache->misses,
-                l2_cache ? l2_cache->accesses : 0,
-                l2_cache ? l2_cache->misses : 0);
+        append_stats_line(rep, st->l1_daccesses, st->l1_dmisses,
+                st->l1_iaccesses, st->l1_imisses,
+                st->l2_accesses, st->l2_misses);
+        sum_stats(&total, st);
     }
 
     if (cores > 1) {
-        sum_stats();
         g_string_append_printf(rep, "%-8s", "sum");
-        append_stats_line(rep, l1_dmem_accesses, l1_dmisses,
-                l1_imem_accesses, l1_imisses,
-                l2_cache ? l2_mem_accesses : 0, l2_cache ? l2_misses : 0);
+        append_stats_line(rep, total.l1_daccesses, total.l1_dmisses,
+                total.l1_iaccesses, total.l1_imisses,
+                total.l2_accesses, total.l2_misses);
     }
 
-    g_string_append(rep, "\n");
+    elapsed = (g_get_monotonic_time() - start_time) / (double)G_USEC_PER_SEC;
+    g_string_append_printf(rep, "\nsimulated %" PRIu64 " accesses"
+                           " in %.2fs (%.0f accesses/s)",
+                           total.l1_daccesses + total.l1_iaccesses,
+                           elapsed,
+                           elapsed > 0 ?
+                           (total.l1_daccesses + total.l1_iaccesses) /
+                           elapsed : 0.0);
+    if (sample > 1) {
+        g_string_append_printf(rep, ", 1 in %d sets sampled", sample);
+    }
+
+    g_string_append(rep, "\n\n");
     qemu_plugin_outs(rep->str);
+    g_free(core_stats);
 }
 
 static void log_top_insns(void)
@@ -705,17 +790,18 @@ static void plugin_exit(qemu_plugin_id_t id, void *p)
     log_stats();
     log_top_insns();
 
-    caches_free(l1_dcaches);
-    caches_free(l1_icaches);
+    caches_free(l1_dcaches, cores);
+    caches_free(l1_icaches, cores);
 
     g_free(l1_dcache_locks);
     g_free(l1_icache_locks);
 
     if (use_l2) {
-        caches_free(l2_ucaches);
+        caches_free(l2_ucaches, l2_count);
         g_free(l2_ucache_locks);
     }
 
+    qemu_plugin_scoreboard_free(stats);
     g_hash_table_destroy(miss_ht);
 }
 
@@ -734,7 +820,7 @@ static void policy_init(void)
         metadata_destroy = fifo_destroy;
         break;
     case RAND:
-        rng = g_rand_new();
+        metadata_init = rand_init;
         break;
     default:
         g_assert_not_reached();
@@ -798,6 +884,18 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         } else if (g_strcmp0(tokens[0], "l2assoc") == 0) {
             use_l2 = true;
             l2_assoc = STRTOLL(tokens[1]);
+        } else if (g_strcmp0(tokens[0], "l2shared") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &l2_shared)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+            use_l2 |= l2_shared;
+        } else if (g_strcmp0(tokens[0], "sample") == 0) {
+            sample = STRTOLL(tokens[1]);
+            if (sample < 1) {
+                fprintf(stderr, "invalid sampling rate: %s\n", opt);
+                return -1;
+            }
         } else if (g_strcmp0(tokens[0], "l2") == 0) {
             if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &use_l2)) {
                 fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
@@ -822,7 +920,7 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
 
     policy_init();
 
-    l1_dcaches = caches_init(l1_dblksize, l1_dassoc, l1_dcachesize);
+    l1_dcaches = caches_init(l1_dblksize, l1_dassoc, l1_dcachesize, cores);
     if (!l1_dcaches) {
         const char *err = cache_config_error(l1_dblksize, l1_dassoc, l1_dcachesize);
         fprintf(stderr, "dcache cannot be constructed from given parameters\n");
@@ -830,7 +928,7 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         return -1;
     }
 
-    l1_icaches = caches_init(l1_iblksize, l1_iassoc, l1_icachesize);
+    l1_icaches = caches_init(l1_iblksize, l1_iassoc, l1_icachesize, cores);
     if (!l1_icaches) {
         const char *err = cache_config_error(l1_iblksize, l1_iassoc, l1_icachesize);
         fprintf(stderr, "icache cannot be constructed from given parameters\n");
@@ -838,7 +936,9 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         return -1;
     }
 
-    l2_ucaches = use_l2 ? caches_init(l2_blksize, l2_assoc, l2_cachesize) : NULL;
+    l2_count = l2_shared ? 1 : cores;
+    l2_ucaches = use_l2 ?
+        caches_init(l2_blksize, l2_assoc, l2_cachesize, l2_count) : NULL;
     if (!l2_ucaches && use_l2) {
         const char *err = cache_config_error(l2_blksize, l2_assoc, l2_cachesize);
         fprintf(stderr, "L2 cache cannot be constructed from given parameters\n");
@@ -848,7 +948,11 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
 
     l1_dcache_locks = g_new0(GMutex, cores);
     l1_icache_locks = g_new0(GMutex, cores);
-    l2_ucache_locks = use_l2 ? g_new0(GMutex, cores) : NULL;
+    l2_ucache_locks = use_l2 ?
+        g_new0(GMutex, l2_shared ? L2_LOCK_SHARDS : cores) : NULL;
+
+    stats = qemu_plugin_scoreboard_new(sizeof(CacheStats));
+    start_time = g_get_monotonic_time();
 
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
     qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
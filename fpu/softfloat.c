@@ -401,6 +401,268 @@ float64_gen2(float64 xa, float64 xb, float_status *s,
     return soft(ua.s, ub.s, s);
 }
 
+/*
+ * float16 and bfloat16 operations are computed with the host's float.
+ * Its 24-bit significand is wide enough for the correctly rounded sum,
+ * difference, product or quotient of two narrower numbers to round
+ * again to the same result as the exact value would (p' >= 2p + 2).
+ * Only that second rounding, to nearest even, is done by hand.
+ */
+typedef bool (*f16_check_fn)(float16 a, float16 b);
+typedef bool (*bf16_check_fn)(bfloat16 a, bfloat16 b);
+
+typedef float16 (*soft_f16_op2_fn)(float16 a, float16 b, float_status *s);
+typedef bfloat16 (*soft_bf16_op2_fn)(bfloat16 a, bfloat16 b, float_status *s);
+
+static inline bool f16_is_zon(float16 a)
+{
+    return float16_is_zero(a) || float16_is_normal(a);
+}
+
+static inline bool bf16_is_zon(bfloat16 a)
+{
+    return bfloat16_is_zero(a) || bfloat16_is_normal(a);
+}
+
+/* @a must be zero or normal. */
+static inline float f16_to_host(float16 a)
+{
+    union_float32 u;
+    uint32_t sign = (uint32_t)float16_val(a) << 16 & 0x80000000;
+    uint32_t mag = float16_val(a) & 0x7fff;
+
+    u.s = make_float32(mag ? sign | ((mag << 13) + ((127 - 15) << 23)) : sign);
+    return u.h;
+}
+
+static inline float bf16_to_host(bfloat16 a)
+{
+    union_float32 u;
+
+    u.s = make_float32((uint32_t)a << 16);
+    return u.h;
+}
+
+/*
+ * Round @h to float16.  Return false if the result might not be
+ * normal, in which case the caller must take the slow path.
+ */
+static inline bool f16_from_host(float h, float16 *r)
+{
+    union_float32 u = { .h = h };
+    uint32_t sign = float32_val(u.s) >> 16 & 0x8000;
+    uint32_t mag = float32_val(u.s) & 0x7fffffff;
+
+    /* Smaller than or equal to the smallest normal float16. */
+    if (mag <= (127 - 14) << 23) {
+        return false;
+    }
+    mag -= (127 - 15) << 23;
+    mag += 0xfff + (mag >> 13 & 1);
+    mag >>= 13;
+    /* Overflow, or h was infinity or NaN. */
+    if (mag >= 0x7c00) {
+        return false;
+    }
+    *r = make_float16(sign | mag);
+    return true;
+}
+
+static inline bool bf16_from_host(float h, bfloat16 *r)
+{
+    union_float32 u = { .h = h };
+    uint32_t sign = float32_val(u.s) & 0x80000000;
+    uint32_t mag = float32_val(u.s) & 0x7fffffff;
+
+    if (mag <= 0x00800000) {
+        return false;
+    }
+    mag += 0x7fff + (mag >> 16 & 1);
+    if (mag >= 0x7f800000) {
+        return false;
+    }
+    *r = (sign | mag) >> 16;
+    return true;
+}
+
+static inline float16
+float16_gen2(float16 a, float16 b, float_status *s,
+             hard_f32_op2_fn hard, soft_f16_op2_fn soft,
+             f16_check_fn pre, f16_check_fn post)
+{
+    union_float32 ur;
+    float16 r;
+
+    if (unlikely(!can_use_fpu(s)) || unlikely(!pre(a, b))) {
+        goto soft;
+    }
+
+    ur.h = hard(f16_to_host(a), f16_to_host(b));
+    if (likely(f16_from_host(ur.h, &r))) {
+        return r;
+    }
+    if (float32_is_zero(ur.s) && !post(a, b)) {
+        return make_float16(float32_val(ur.s) >> 16);
+    }
+
+ soft:
+    return soft(a, b, s);
+}
+
+static inline bfloat16
+bfloat16_gen2(bfloat16 a, bfloat16 b, float_status *s,
+              hard_f32_op2_fn hard, soft_bf16_op2_fn soft,
+              bf16_check_fn pre, bf16_check_fn post)
+{
+    union_float32 ur;
+    bfloat16 r;
+
+    if (unlikely(!can_use_fpu(s)) || unlikely(!pre(a, b))) {
+        goto soft;
+    }
+
+    ur.h = hard(bf16_to_host(a), bf16_to_host(b));
+    if (likely(bf16_from_host(ur.h, &r))) {
+        return r;
+    }
+    if (float32_is_zero(ur.s) && !post(a, b)) {
+        return float32_val(ur.s) >> 16;
+    }
+
+ soft:
+    return soft(a, b, s);
+}
+
+/*
+ * floatx80 operations are computed with the host's long double when it
+ * has the same x87 format.  The host control word is never changed from
+ * its default, which rounds to nearest even with a 64-bit significand,
+ * so this only applies to floatx80_precision_x.  Results that overflow
+ * or may be denormal take the soft path, as do inputs that are not zero
+ * or normal, including the x87 unnormals and pseudo-denormals.
+ *
+ * Unlike the other hardfloat paths, these do not need inexact to be
+ * set beforehand: the x87 helpers of target/i386 clear the flags before
+ * each operation, so that would never hold.  Instead, the precision
+ * exception of the host x87 is cleared before the operation and read
+ * back after it.  The checks above leave no other exception possible.
+ */
+#if defined(__x86_64__) && LDBL_MANT_DIG == 64 && !defined(_WIN32)
+# define QEMU_HARDFLOAT_FX80 1
+#else
+# define QEMU_HARDFLOAT_FX80 0
+#endif
+
+typedef union {
+    floatx80 s;
+    long double h;
+} union_floatx80;
+
+typedef bool (*fx80_check_fn)(floatx80 a, floatx80 b);
+typedef floatx80 (*soft_fx80_op2_fn)(floatx80 a, floatx80 b, float_status *s);
+typedef long double (*hard_fx80_op2_fn)(long double a, long double b);
+
+static inline bool can_use_fpu_fx80(const float_status *s)
+{
+    return QEMU_HARDFLOAT_FX80 && !QEMU_NO_HARDFLOAT &&
+           s->float_rounding_mode == float_round_nearest_even &&
+           s->floatx80_rounding_precision == floatx80_precision_x;
+}
+
+#if QEMU_HARDFLOAT_FX80
+/* The operands are outputs, so that they are read after the clear. */
+static inline void fx80_host_clear_flags(union_floatx80 *a,
+                                         union_floatx80 *b)
+{
+    asm volatile("fnclex" : "+m"(a->h), "+m"(b->h));
+}
+
+/* The result is an input, so that it is computed before the read. */
+static inline bool fx80_host_inexact(long double r)
+{
+    uint16_t sw;
+
+    asm volatile("fnstsw %0" : "=a"(sw) : "t"(r));
+    return sw & 0x20;
+}
+#else
+static inline void fx80_host_clear_flags(union_floatx80 *a,
+                                         union_floatx80 *b)
+{
+}
+
+static inline bool fx80_host_inexact(long double r)
+{
+    return true;
+}
+#endif
+
+static inline bool fx80_is_zon(floatx80 a)
+{
+    int exp = extractFloatx80Exp(a);
+
+    if (exp == 0) {
+        return a.low == 0;
+    }
+    return exp != 0x7fff && (a.low >> 63);
+}
+
+static inline floatx80
+floatx80_gen2(floatx80 a, floatx80 b, float_status *s,
+              hard_fx80_op2_fn hard, soft_fx80_op2_fn soft,
+              fx80_check_fn pre, fx80_check_fn post)
+{
+    union_floatx80 ua = { .s = a }, ub = { .s = b }, ur;
+
+    if (unlikely(!can_use_fpu_fx80(s)) || unlikely(!pre(a, b))) {
+        goto soft;
+    }
+
+    fx80_host_clear_flags(&ua, &ub);
+    ur.h = hard(ua.h, ub.h);
+    if (unlikely(isinf(ur.h)) ||
+        (unlikely(fabsl(ur.h) <= LDBL_MIN) && post(a, b))) {
+        goto soft;
+    }
+    if (fx80_host_inexact(ur.h)) {
+        float_raise(float_flag_inexact, s);
+    }
+    return ur.s;
+
+ soft:
+    return soft(a, b, s);
+}
+
+static bool fx80_is_zon2(floatx80 a, floatx80 b)
+{
+    return fx80_is_zon(a) && fx80_is_zon(b);
+}
+
+static bool fx80_addsubmul_post(floatx80 a, floatx80 b)
+{
+    return !(floatx80_is_zero(a) && floatx80_is_zero(b));
+}
+
+static bool f16_is_zon2(float16 a, float16 b)
+{
+    return f16_is_zon(a) && f16_is_zon(b);
+}
+
+static bool bf16_is_zon2(bfloat16 a, bfloat16 b)
+{
+    return bf16_is_zon(a) && bf16_is_zon(b);
+}
+
+static bool f16_addsubmul_post(float16 a, float16 b)
+{
+    return !(float16_is_zero(a) && float16_is_zero(b));
+}
+
+static bool bf16_addsubmul_post(bfloat16 a, bfloat16 b)
+{
+    return !(bfloat16_is_zero(a) && bfloat16_is_zero(b));
+}
+
 /*
  * Classify a floating point number. Everything above float_class_qnan
  * is a NaN so cls >= float_class_qnan is any NaN.
@@ -1865,8 +2127,8 @@ static floatx80 floatx80_round_pack_canonical(FloatParts128 *p,
  * Addition and subtraction
  */
 
-static float16 QEMU_FLATTEN
-float16_addsub(float16 a, float16 b, float_status *status, bool subtract)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_addsub(float16 a, float16 b, float_status *status, bool subtract)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -1877,14 +2139,14 @@ float16_addsub(float16 a, float16 b, float_status *status, bool subtract)
     return float16_round_pack_canonical(pr, status);
 }
 
-float16 float16_add(float16 a, float16 b, float_status *status)
+static float16 soft_f16_add(float16 a, float16 b, float_status *status)
 {
-    return float16_addsub(a, b, status, false);
+    return soft_f16_addsub(a, b, status, false);
 }
 
-float16 float16_sub(float16 a, float16 b, float_status *status)
+static float16 soft_f16_sub(float16 a, float16 b, float_status *status)
 {
-    return float16_addsub(a, b, status, true);
+    return soft_f16_addsub(a, b, status, true);
 }
 
 static float32 QEMU_SOFTFLOAT_ATTR
@@ -1982,6 +2244,20 @@ static float64 float64_addsub(float64 a, float64 b, float_status *s,
                         f64_is_zon2, f64_addsubmul_post);
 }
 
+float16 QEMU_FLATTEN
+float16_add(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_add, soft_f16_add,
+                        f16_is_zon2, f16_addsubmul_post);
+}
+
+float16 QEMU_FLATTEN
+float16_sub(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_sub, soft_f16_sub,
+                        f16_is_zon2, f16_addsubmul_post);
+}
+
 float32 QEMU_FLATTEN
 float32_add(float32 a, float32 b, float_status *s)
 {
@@ -2028,8 +2304,8 @@ float64 float64r32_sub(float64 a, float64 b, float_status *status)
     return float64r32_addsub(a, b, status, true);
 }
 
-static bfloat16 QEMU_FLATTEN
-bfloat16_addsub(bfloat16 a, bfloat16 b, float_status *status, bool subtract)
+static bfloat16 QEMU_SOFTFLOAT_ATTR
+soft_bf16_addsub(bfloat16 a, bfloat16 b, float_status *status, bool subtract)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -2040,14 +2316,28 @@ bfloat16_addsub(bfloat16 a, bfloat16 b, float_status *status, bool subtract)
     return bfloat16_round_pack_canonical(pr, status);
 }
 
-bfloat16 bfloat16_add(bfloat16 a, bfloat16 b, float_status *status)
+static bfloat16 soft_bf16_add(bfloat16 a, bfloat16 b, float_status *status)
+{
+    return soft_bf16_addsub(a, b, status, false);
+}
+
+static bfloat16 soft_bf16_sub(bfloat16 a, bfloat16 b, float_status *status)
 {
-    return bfloat16_addsub(a, b, status, false);
+    return soft_bf16_addsub(a, b, status, true);
 }
 
-bfloat16 bfloat16_sub(bfloat16 a, bfloat16 b, float_status *status)
+bfloat16 QEMU_FLATTEN
+bfloat16_add(bfloat16 a, bfloat16 b, float_status *s)
+{
+    return bfloat16_gen2(a, b, s, hard_f32_add, soft_bf16_add,
+                         bf16_is_zon2, bf16_addsubmul_post);
+}
+
+bfloat16 QEMU_FLATTEN
+bfloat16_sub(bfloat16 a, bfloat16 b, float_status *s)
 {
-    return bfloat16_addsub(a, b, status, true);
+    return bfloat16_gen2(a, b, s, hard_f32_sub, soft_bf16_sub,
+                         bf16_is_zon2, bf16_addsubmul_post);
 }
 
 static float128 QEMU_FLATTEN
@@ -2072,8 +2362,8 @@ float128 float128_sub(float128 a, float128 b, float_status *status)
     return float128_addsub(a, b, status, true);
 }
 
-static floatx80 QEMU_FLATTEN
-floatx80_addsub(floatx80 a, floatx80 b, float_status *status, bool subtract)
+static floatx80 QEMU_SOFTFLOAT_ATTR
+soft_fx80_addsub(floatx80 a, floatx80 b, float_status *status, bool subtract)
 {
     FloatParts128 pa, pb, *pr;
 
@@ -2086,21 +2376,46 @@ floatx80_addsub(floatx80 a, floatx80 b, float_status *status, bool subtract)
     return floatx80_round_pack_canonical(pr, status);
 }
 
-floatx80 floatx80_add(floatx80 a, floatx80 b, float_status *status)
+static floatx80 soft_fx80_add(floatx80 a, floatx80 b, float_status *status)
 {
-    return floatx80_addsub(a, b, status, false);
+    return soft_fx80_addsub(a, b, status, false);
 }
 
-floatx80 floatx80_sub(floatx80 a, floatx80 b, float_status *status)
+static floatx80 soft_fx80_sub(floatx80 a, floatx80 b, float_status *status)
 {
-    return floatx80_addsub(a, b, status, true);
+    return soft_fx80_addsub(a, b, status, true);
+}
+
+static long double hard_fx80_add(long double a, long double b)
+{
+    return a + b;
+}
+
+static long double hard_fx80_sub(long double a, long double b)
+{
+    return a - b;
+}
+
+floatx80 QEMU_FLATTEN
+floatx80_add(floatx80 a, floatx80 b, float_status *s)
+{
+    return floatx80_gen2(a, b, s, hard_fx80_add, soft_fx80_add,
+                         fx80_is_zon2, fx80_addsubmul_post);
+}
+
+floatx80 QEMU_FLATTEN
+floatx80_sub(floatx80 a, floatx80 b, float_status *s)
+{
+    return floatx80_gen2(a, b, s, hard_fx80_sub, soft_fx80_sub,
+                         fx80_is_zon2, fx80_addsubmul_post);
 }
 
 /*
  * Multiplication
  */
 
-float16 QEMU_FLATTEN float16_mul(float16 a, float16 b, float_status *status)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_mul(float16 a, float16 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -2159,6 +2474,13 @@ float64_mul(float64 a, float64 b, float_status *s)
                         f64_is_zon2, f64_addsubmul_post);
 }
 
+float16 QEMU_FLATTEN
+float16_mul(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_mul, soft_f16_mul,
+                        f16_is_zon2, f16_addsubmul_post);
+}
+
 float64 float64r32_mul(float64 a, float64 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
@@ -2170,8 +2492,8 @@ float64 float64r32_mul(float64 a, float64 b, float_status *status)
     return float64r32_round_pack_canonical(pr, status);
 }
 
-bfloat16 QEMU_FLATTEN
-bfloat16_mul(bfloat16 a, bfloat16 b, float_status *status)
+static bfloat16 QEMU_SOFTFLOAT_ATTR
+soft_bf16_mul(bfloat16 a, bfloat16 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -2182,6 +2504,13 @@ bfloat16_mul(bfloat16 a, bfloat16 b, float_status *status)
     return bfloat16_round_pack_canonical(pr, status);
 }
 
+bfloat16 QEMU_FLATTEN
+bfloat16_mul(bfloat16 a, bfloat16 b, float_status *s)
+{
+    return bfloat16_gen2(a, b, s, hard_f32_mul, soft_bf16_mul,
+                         bf16_is_zon2, bf16_addsubmul_post);
+}
+
 float128 QEMU_FLATTEN
 float128_mul(float128 a, float128 b, float_status *status)
 {
@@ -2194,8 +2523,8 @@ float128_mul(float128 a, float128 b, float_status *status)
     return float128_round_pack_canonical(pr, status);
 }
 
-floatx80 QEMU_FLATTEN
-floatx80_mul(floatx80 a, floatx80 b, float_status *status)
+static floatx80 QEMU_SOFTFLOAT_ATTR
+soft_fx80_mul(floatx80 a, floatx80 b, float_status *status)
 {
     FloatParts128 pa, pb, *pr;
 
@@ -2208,6 +2537,18 @@ floatx80_mul(floatx80 a, floatx80 b, float_status *status)
     return floatx80_round_pack_canonical(pr, status);
 }
 
+static long double hard_fx80_mul(long double a, long double b)
+{
+    return a * b;
+}
+
+floatx80 QEMU_FLATTEN
+floatx80_mul(floatx80 a, floatx80 b, float_status *s)
+{
+    return floatx80_gen2(a, b, s, hard_fx80_mul, soft_fx80_mul,
+                         fx80_is_zon2, fx80_addsubmul_post);
+}
+
 /*
  * Fused multiply-add
  */
@@ -2440,7 +2781,8 @@ float128 QEMU_FLATTEN float128_muladd(float128 a, float128 b, float128 c,
  * Division
  */
 
-float16 float16_div(float16 a, float16 b, float_status *status)
+static float16 QEMU_SOFTFLOAT_ATTR
+soft_f16_div(float16 a, float16 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -2533,6 +2875,40 @@ float64_div(float64 a, float64 b, float_status *s)
                         f64_div_pre, f64_div_post);
 }
 
+static bool f16_div_pre(float16 a, float16 b)
+{
+    return f16_is_zon(a) && float16_is_normal(b);
+}
+
+static bool bf16_div_pre(bfloat16 a, bfloat16 b)
+{
+    return bf16_is_zon(a) && bfloat16_is_normal(b);
+}
+
+static bool f16_div_post(float16 a, float16 b)
+{
+    return !float16_is_zero(a);
+}
+
+static bool bf16_div_post(bfloat16 a, bfloat16 b)
+{
+    return !bfloat16_is_zero(a);
+}
+
+float16 QEMU_FLATTEN
+float16_div(float16 a, float16 b, float_status *s)
+{
+    return float16_gen2(a, b, s, hard_f32_div, soft_f16_div,
+                        f16_div_pre, f16_div_post);
+}
+
+bfloat16 QEMU_FLATTEN
+bfloat16_div(bfloat16 a, bfloat16 b, float_status *s)
+{
+    return bfloat16_gen2(a, b, s, hard_f32_div, soft_bf16_div,
+                         bf16_div_pre, bf16_div_post);
+}
+
 float64 float64r32_div(float64 a, float64 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
@@ -2544,8 +2920,8 @@ float64 float64r32_div(float64 a, float64 b, float_status *status)
     return float64r32_round_pack_canonical(pr, status);
 }
 
-bfloat16 QEMU_FLATTEN
-bfloat16_div(bfloat16 a, bfloat16 b, float_status *status)
+static bfloat16 QEMU_SOFTFLOAT_ATTR
+soft_bf16_div(bfloat16 a, bfloat16 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -2568,7 +2944,8 @@ float128_div(float128 a, float128 b, float_status *status)
     return float128_round_pack_canonical(pr, status);
 }
 
-floatx80 floatx80_div(floatx80 a, floatx80 b, float_status *status)
+static floatx80 QEMU_SOFTFLOAT_ATTR
+soft_fx80_div(floatx80 a, floatx80 b, float_status *status)
 {
     FloatParts128 pa, pb, *pr;
 
@@ -2581,6 +2958,28 @@ floatx80 floatx80_div(floatx80 a, floatx80 b, float_status *status)
     return floatx80_round_pack_canonical(pr, status);
 }
 
+static long double hard_fx80_div(long double a, long double b)
+{
+    return a / b;
+}
+
+static bool fx80_div_pre(floatx80 a, floatx80 b)
+{
+    return fx80_is_zon(a) && fx80_is_zon(b) && !floatx80_is_zero(b);
+}
+
+static bool fx80_div_post(floatx80 a, floatx80 b)
+{
+    return !floatx80_is_zero(a);
+}
+
+floatx80 QEMU_FLATTEN
+floatx80_div(floatx80 a, floatx80 b, float_status *s)
+{
+    return floatx80_gen2(a, b, s, hard_fx80_div, soft_fx80_div,
+                         fx80_div_pre, fx80_div_post);
+}
+
 /*
  * Remainder
  */
@@ -2825,7 +3224,8 @@ float16 float64_to_float16(float64 a, bool ieee, float_status *s)
     return float16a_round_pack_canonical(&p, s, fmt);
 }
 
-float32 float64_to_float32(float64 a, float_status *s)
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_float64_to_float32(float64 a, float_status *s)
 {
     FloatParts64 p;
 
@@ -2834,6 +3234,32 @@ float32 float64_to_float32(float64 a, float_status *s)
     return float32_round_pack_canonical(&p, s);
 }
 
+float32 float64_to_float32(float64 a, float_status *s)
+{
+    union_float64 ua;
+    union_float32 ur;
+
+    ua.s = a;
+    if (unlikely(!can_use_fpu(s))) {
+        goto soft;
+    }
+    float64_input_flush1(&ua.s, s);
+    if (unlikely(!float64_is_zero_or_normal(ua.s))) {
+        goto soft;
+    }
+
+    ur.h = ua.h;
+    if (unlikely(f32_is_inf(ur))) {
+        float_raise(float_flag_overflow, s);
+    } else if (unlikely(fabsf(ur.h) <= FLT_MIN) && !float64_is_zero(ua.s)) {
+        goto soft;
+    }
+    return ur.s;
+
+ soft:
+    return soft_float64_to_float32(ua.s, s);
+}
+
 float32 bfloat16_to_float32(bfloat16 a, float_status *s)
 {
     FloatParts64 p;
@@ -2910,7 +3336,8 @@ float128 float64_to_float128(float64 a, float_status *s)
     return float128_round_pack_canonical(&p128, s);
 }
 
-float32 floatx80_to_float32(floatx80 a, float_status *s)
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_floatx80_to_float32(floatx80 a, float_status *s)
 {
     FloatParts64 p64;
     FloatParts128 p128;
@@ -2923,7 +3350,34 @@ float32 floatx80_to_float32(floatx80 a, float_status *s)
     return float32_round_pack_canonical(&p64, s);
 }
 
-float64 floatx80_to_float64(floatx80 a, float_status *s)
+float32 floatx80_to_float32(floatx80 a, float_status *s)
+{
+    union_floatx80 ua = { .s = a };
+    union_float32 ur;
+
+    /* The rounding precision does not apply to these conversions. */
+    if (!QEMU_HARDFLOAT_FX80 || QEMU_NO_HARDFLOAT ||
+        s->float_rounding_mode != float_round_nearest_even ||
+        unlikely(!fx80_is_zon(a))) {
+        goto soft;
+    }
+
+    ur.h = ua.h;
+    if (unlikely(f32_is_inf(ur))) {
+        float_raise(float_flag_overflow | float_flag_inexact, s);
+    } else if (unlikely(fabsf(ur.h) <= FLT_MIN) && !floatx80_is_zero(a)) {
+        goto soft;
+    } else if (ur.h != ua.h) {
+        float_raise(float_flag_inexact, s);
+    }
+    return ur.s;
+
+ soft:
+    return soft_floatx80_to_float32(a, s);
+}
+
+static float64 QEMU_SOFTFLOAT_ATTR
+soft_floatx80_to_float64(floatx80 a, float_status *s)
 {
     FloatParts64 p64;
     FloatParts128 p128;
@@ -2936,6 +3390,32 @@ float64 floatx80_to_float64(floatx80 a, float_status *s)
     return float64_round_pack_canonical(&p64, s);
 }
 
+float64 floatx80_to_float64(floatx80 a, float_status *s)
+{
+    union_floatx80 ua = { .s = a };
+    union_float64 ur;
+
+    /* The rounding precision does not apply to these conversions. */
+    if (!QEMU_HARDFLOAT_FX80 || QEMU_NO_HARDFLOAT ||
+        s->float_rounding_mode != float_round_nearest_even ||
+        unlikely(!fx80_is_zon(a))) {
+        goto soft;
+    }
+
+    ur.h = ua.h;
+    if (unlikely(f64_is_inf(ur))) {
+        float_raise(float_flag_overflow | float_flag_inexact, s);
+    } else if (unlikely(fabs(ur.h) <= DBL_MIN) && !floatx80_is_zero(a)) {
+        goto soft;
+    } else if (ur.h != ua.h) {
+        float_raise(float_flag_inexact, s);
+    }
+    return ur.s;
+
+ soft:
+    return soft_floatx80_to_float64(a, s);
+}
+
 float128 floatx80_to_float128(floatx80 a, float_status *s)
 {
     FloatParts128 p;
@@ -2990,7 +3470,8 @@ float16 float16_round_to_int(float16 a, float_status *s)
     return float16_round_pack_canonical(&p, s);
 }
 
-float32 float32_round_to_int(float32 a, float_status *s)
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_f32_round_to_int(float32 a, float_status *s)
 {
     FloatParts64 p;
 
@@ -2999,7 +3480,27 @@ float32 float32_round_to_int(float32 a, float_status *s)
     return float32_round_pack_canonical(&p, s);
 }
 
-float64 float64_round_to_int(float64 a, float_status *s)
+float32 float32_round_to_int(float32 a, float_status *s)
+{
+    union_float32 ua, ur;
+
+    ua.s = a;
+    if (unlikely(!can_use_fpu(s))) {
+        goto soft;
+    }
+    float32_input_flush1(&ua.s, s);
+    if (unlikely(!float32_is_zero_or_normal(ua.s))) {
+        goto soft;
+    }
+    ur.h = rintf(ua.h);
+    return ur.s;
+
+ soft:
+    return soft_f32_round_to_int(ua.s, s);
+}
+
+static float64 QEMU_SOFTFLOAT_ATTR
+soft_f64_round_to_int(float64 a, float_status *s)
 {
     FloatParts64 p;
 
@@ -3008,6 +3509,25 @@ float64 float64_round_to_int(float64 a, float_status *s)
     return float64_round_pack_canonical(&p, s);
 }
 
+float64 float64_round_to_int(float64 a, float_status *s)
+{
+    union_float64 ua, ur;
+
+    ua.s = a;
+    if (unlikely(!can_use_fpu(s))) {
+        goto soft;
+    }
+    float64_input_flush1(&ua.s, s);
+    if (unlikely(!float64_is_zero_or_normal(ua.s))) {
+        goto soft;
+    }
+    ur.h = rint(ua.h);
+    return ur.s;
+
+ soft:
+    return soft_f64_round_to_int(ua.s, s);
+}
+
 bfloat16 bfloat16_round_to_int(bfloat16 a, float_status *s)
 {
     FloatParts64 p;
@@ -3263,6 +3783,64 @@ static int64_t floatx80_to_int64_scalbn(floatx80 a, FloatRoundMode rmode,
     return parts_float_to_sint(&p, rmode, scale, INT64_MIN, INT64_MAX, s);
 }
 
+/*
+ * Hardfloat conversions to integer.  Operands that convert exactly raise
+ * no flag; the others are only handled if inexact is already set.  The
+ * rounded value is range-checked before the host conversion, which is
+ * then exact.
+ */
+static inline bool hard_f32_to_int(float32 a, bool rtz, float lo, float hi,
+                                   int64_t *ret, float_status *s)
+{
+    union_float32 ua;
+    float r;
+
+    if (QEMU_NO_HARDFLOAT ||
+        (!rtz && s->float_rounding_mode != float_round_nearest_even)) {
+        return false;
+    }
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (unlikely(!float32_is_zero_or_normal(ua.s))) {
+        return false;
+    }
+    r = rtz ? truncf(ua.h) : rintf(ua.h);
+    if (unlikely(r < lo || r >= hi)) {
+        return false;
+    }
+    if (r != ua.h && !(s->float_exception_flags & float_flag_inexact)) {
+        return false;
+    }
+    *ret = r;
+    return true;
+}
+
+static inline bool hard_f64_to_int(float64 a, bool rtz, double lo, double hi,
+                                   int64_t *ret, float_status *s)
+{
+    union_float64 ua;
+    double r;
+
+    if (QEMU_NO_HARDFLOAT ||
+        (!rtz && s->float_rounding_mode != float_round_nearest_even)) {
+        return false;
+    }
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (unlikely(!float64_is_zero_or_normal(ua.s))) {
+        return false;
+    }
+    r = rtz ? trunc(ua.h) : rint(ua.h);
+    if (unlikely(r < lo || r >= hi)) {
+        return false;
+    }
+    if (r != ua.h && !(s->float_exception_flags & float_flag_inexact)) {
+        return false;
+    }
+    *ret = r;
+    return true;
+}
+
 int8_t float16_to_int8(float16 a, float_status *s)
 {
     return float16_to_int8_scalbn(a, s->float_rounding_mode, 0, s);
@@ -3290,11 +3868,21 @@ int16_t float32_to_int16(float32 a, float_status *s)
 
 int32_t float32_to_int32(float32 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f32_to_int(a, false, -0x1p31f, 0x1p31f, &r, s)) {
+        return r;
+    }
     return float32_to_int32_scalbn(a, s->float_rounding_mode, 0, s);
 }
 
 int64_t float32_to_int64(float32 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f32_to_int(a, false, -0x1p63f, 0x1p63f, &r, s)) {
+        return r;
+    }
     return float32_to_int64_scalbn(a, s->float_rounding_mode, 0, s);
 }
 
@@ -3305,11 +3893,21 @@ int16_t float64_to_int16(float64 a, float_status *s)
 
 int32_t float64_to_int32(float64 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f64_to_int(a, false, -0x1p31, 0x1p31, &r, s)) {
+        return r;
+    }
     return float64_to_int32_scalbn(a, s->float_rounding_mode, 0, s);
 }
 
 int64_t float64_to_int64(float64 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f64_to_int(a, false, -0x1p63, 0x1p63, &r, s)) {
+        return r;
+    }
     return float64_to_int64_scalbn(a, s->float_rounding_mode, 0, s);
 }
 
@@ -3360,11 +3958,21 @@ int16_t float32_to_int16_round_to_zero(float32 a, float_status *s)
 
 int32_t float32_to_int32_round_to_zero(float32 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f32_to_int(a, true, -0x1p31f, 0x1p31f, &r, s)) {
+        return r;
+    }
     return float32_to_int32_scalbn(a, float_round_to_zero, 0, s);
 }
 
 int64_t float32_to_int64_round_to_zero(float32 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f32_to_int(a, true, -0x1p63f, 0x1p63f, &r, s)) {
+        return r;
+    }
     return float32_to_int64_scalbn(a, float_round_to_zero, 0, s);
 }
 
@@ -3375,11 +3983,21 @@ int16_t float64_to_int16_round_to_zero(float64 a, float_status *s)
 
 int32_t float64_to_int32_round_to_zero(float64 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f64_to_int(a, true, -0x1p31, 0x1p31, &r, s)) {
+        return r;
+    }
     return float64_to_int32_scalbn(a, float_round_to_zero, 0, s);
 }
 
 int64_t float64_to_int64_round_to_zero(float64 a, float_status *s)
 {
+    int64_t r;
+
+    if (hard_f64_to_int(a, true, -0x1p63, 0x1p63, &r, s)) {
+        return r;
+    }
     return float64_to_int64_scalbn(a, float_round_to_zero, 0, s);
 }
 
@@ -3880,8 +4498,13 @@ float32 int64_to_float32_scalbn(int64_t a, int scale, float_status *status)
 {
     FloatParts64 p;
 
-    /* Without scaling, there are no overflow concerns. */
-    if (likely(scale == 0) && can_use_fpu(status)) {
+    /*
+     * Without scaling, there are no overflow concerns.  Small integers
+     * convert exactly, whatever the rounding mode and flags.
+     */
+    if (likely(scale == 0) &&
+        ((a >= -(INT64_C(1) << 24) && a <= INT64_C(1) << 24) ||
+         can_use_fpu(status))) {
         union_float32 ur;
         ur.h = a;
         return ur.s;
@@ -3920,8 +4543,13 @@ float64 int64_to_float64_scalbn(int64_t a, int scale, float_status *status)
 {
     FloatParts64 p;
 
-    /* Without scaling, there are no overflow concerns. */
-    if (likely(scale == 0) && can_use_fpu(status)) {
+    /*
+     * Without scaling, there are no overflow concerns.  Small integers
+     * convert exactly, whatever the rounding mode and flags.
+     */
+    if (likely(scale == 0) &&
+        ((a >= -(INT64_C(1) << 53) && a <= INT64_C(1) << 53) ||
+         can_use_fpu(status))) {
         union_float64 ur;
         ur.h = a;
         return ur.s;
@@ -4045,6 +4673,13 @@ floatx80 int64_to_floatx80(int64_t a, float_status *status)
 {
     FloatParts128 p;
 
+    /* Exact with a 64-bit significand, so no flag can be raised. */
+    if (QEMU_HARDFLOAT_FX80 &&
+        status->floatx80_rounding_precision == floatx80_precision_x) {
+        union_floatx80 ur = { .h = a };
+        return ur.s;
+    }
+
     parts_sint_to_float(&p, a, 0, status);
     return floatx80_round_pack_canonical(&p, status);
 }
@@ -4279,10 +4914,45 @@ static bfloat16 bfloat16_minmax(bfloat16 a, bfloat16 b,
     return bfloat16_round_pack_canonical(pr, s);
 }
 
+/*
+ * Fast path for minmax on operands that are neither NaN nor denormal:
+ * no flag is raised and the result is one of the operands, picked by
+ * comparing the encodings as sign-magnitude integers.  Returns true if
+ * @b is the result.  @sbit is the position of the sign bit.
+ */
+static inline bool minmax_pick_b(uint64_t a, uint64_t b, int sbit, int flags)
+{
+    uint64_t ma = extract64(a, 0, sbit);
+    uint64_t mb = extract64(b, 0, sbit);
+    bool sa = extract64(a, sbit, 1);
+    bool sb = extract64(b, sbit, 1);
+    int cmp = (ma > mb) - (ma < mb);
+
+    /* As in parts_minmax(). */
+    if (!(flags & minmax_ismag) || cmp == 0) {
+        if (sa != sb) {
+            cmp = sa ? -1 : 1;
+        } else if (sa) {
+            cmp = -cmp;
+        }
+    }
+    if (flags & minmax_ismin) {
+        cmp = -cmp;
+    }
+    return cmp < 0;
+}
+
 static float32 float32_minmax(float32 a, float32 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
+    float32_input_flush2(&a, &b, s);
+    if (likely(!float32_is_any_nan(a) && !float32_is_any_nan(b) &&
+               !float32_is_denormal(a) && !float32_is_denormal(b))) {
+        return minmax_pick_b(float32_val(a), float32_val(b), 31, flags)
+               ? b : a;
+    }
+
     float32_unpack_canonical(&pa, a, s);
     float32_unpack_canonical(&pb, b, s);
     pr = parts_minmax(&pa, &pb, s, flags);
@@ -4294,6 +4964,13 @@ static float64 float64_minmax(float64 a, float64 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
+    float64_input_flush2(&a, &b, s);
+    if (likely(!float64_is_any_nan(a) && !float64_is_any_nan(b) &&
+               !float64_is_denormal(a) && !float64_is_denormal(b))) {
+        return minmax_pick_b(float64_val(a), float64_val(b), 63, flags)
+               ? b : a;
+    }
+
     float64_unpack_canonical(&pa, a, s);
     float64_unpack_canonical(&pb, b, s);
     pr = parts_minmax(&pa, &pb, s, flags);
@@ -4696,7 +5373,8 @@ float128 QEMU_FLATTEN float128_sqrt(float128 a, float_status *status)
     return float128_round_pack_canonical(&p, status);
 }
 
-floatx80 floatx80_sqrt(floatx80 a, float_status *s)
+static floatx80 QEMU_SOFTFLOAT_ATTR
+soft_fx80_sqrt(floatx80 a, float_status *s)
 {
     FloatParts128 p;
 
@@ -4707,6 +5385,22 @@ floatx80 floatx80_sqrt(floatx80 a, float_status *s)
     return floatx80_round_pack_canonical(&p, s);
 }
 
+floatx80 QEMU_FLATTEN floatx80_sqrt(floatx80 a, float_status *s)
+{
+    union_floatx80 ua = { .s = a }, ub = { }, ur;
+
+    if (unlikely(!can_use_fpu_fx80(s)) ||
+        unlikely(!fx80_is_zon(a) || extractFloatx80Sign(a))) {
+        return soft_fx80_sqrt(a, s);
+    }
+    fx80_host_clear_flags(&ua, &ub);
+    ur.h = sqrtl(ua.h);
+    if (fx80_host_inexact(ur.h)) {
+        float_raise(float_flag_inexact, s);
+    }
+    return ur.s;
+}
+
 /*
  * log2
  */
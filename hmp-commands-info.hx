@@ -270,6 +270,21 @@ SRST
     Show dynamic compiler opcode counters
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "profile",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show guest code samples as folded stacks",
+    },
+#endif
+
+SRST
+  ``info profile``
+    Show the guest code samples taken since ``x-profile-start``, as
+    folded stacks.
+ERST
+
     {
         .name       = "sync-profile",
         .args_type  = "mean:-m,no_coalesce:-n,max:i?",
@@ -12,6 +12,9 @@
 #define CPUINFO_AES             (1u << 3)
 #define CPUINFO_PMULL           (1u << 4)
 #define CPUINFO_BTI             (1u << 5)
+#define CPUINFO_CRC32           (1u << 6)
+#define CPUINFO_SHA256          (1u << 7)
+#define CPUINFO_SHA512          (1u << 8)
 
 /* Initialized with a constructor. */
 extern unsigned cpuinfo;
@@ -0,0 +1,65 @@
+/*
+ * AArch64 specific CRC-32 acceleration.
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef AARCH64_HOST_CRYPTO_CRC32_H
+#define AARCH64_HOST_CRYPTO_CRC32_H
+
+#include "host/cpuinfo.h"
+
+#ifdef __ARM_FEATURE_CRC32
+# define HAVE_CRC32_ACCEL   true
+#else
+# define HAVE_CRC32_ACCEL   likely(cpuinfo & CPUINFO_CRC32)
+#endif
+#define HAVE_CRC32C_ACCEL   HAVE_CRC32_ACCEL
+#define ATTR_CRC32_ACCEL
+
+#define CRC32_ACCEL_INSN(INSN, W, CRC, VAL)                     \
+    asm(".arch_extension crc\n\t"                               \
+        INSN " %w0, %w0, %" W "1" : "+r"(CRC) : "r"(VAL))
+
+static inline uint32_t crc32_accel(uint32_t crc, uint64_t val, unsigned bytes)
+{
+    switch (bytes) {
+    case 1:
+        CRC32_ACCEL_INSN("crc32b", "w", crc, val);
+        break;
+    case 2:
+        CRC32_ACCEL_INSN("crc32h", "w", crc, val);
+        break;
+    case 4:
+        CRC32_ACCEL_INSN("crc32w", "w", crc, val);
+        break;
+    case 8:
+        CRC32_ACCEL_INSN("crc32x", "x", crc, val);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+    return crc;
+}
+
+static inline uint32_t crc32c_accel(uint32_t crc, uint64_t val, unsigned bytes)
+{
+    switch (bytes) {
+    case 1:
+        CRC32_ACCEL_INSN("crc32cb", "w", crc, val);
+        break;
+    case 2:
+        CRC32_ACCEL_INSN("crc32ch", "w", crc, val);
+        break;
+    case 4:
+        CRC32_ACCEL_INSN("crc32cw", "w", crc, val);
+        break;
+    case 8:
+        CRC32_ACCEL_INSN("crc32cx", "x", crc, val);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+    return crc;
+}
+
+#endif /* AARCH64_HOST_CRYPTO_CRC32_H */
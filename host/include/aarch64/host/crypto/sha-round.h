@@ -0,0 +1,111 @@
+/*
+ * AArch64 specific SHA acceleration.
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef AARCH64_HOST_CRYPTO_SHA_ROUND_H
+#define AARCH64_HOST_CRYPTO_SHA_ROUND_H
+
+#include "host/cpuinfo.h"
+#include <arm_neon.h>
+
+#ifdef __ARM_FEATURE_SHA2
+# define HAVE_SHA256_ACCEL  true
+#else
+# define HAVE_SHA256_ACCEL  likely(cpuinfo & CPUINFO_SHA256)
+#endif
+#ifdef __ARM_FEATURE_SHA512
+# define HAVE_SHA512_ACCEL  true
+#else
+# define HAVE_SHA512_ACCEL  likely(cpuinfo & CPUINFO_SHA512)
+#endif
+#define HAVE_SHA256_RNDS2_ACCEL  false
+#define ATTR_SHA_ACCEL
+
+/*
+ * Use inline assembly throughout, as with .arch_extension the
+ * instructions are available without the compiler knowing about
+ * FEAT_SHA512.
+ */
+
+static inline void
+sha256_rnds4_accel(SHAState *abcd, SHAState *efgh, const SHAState *wk)
+{
+    uint32x4_t x = (uint32x4_t)abcd->v;
+    uint32x4_t y = (uint32x4_t)efgh->v;
+    uint32x4_t t = x;
+
+    asm(".arch_extension sha2\n\t"
+        "sha256h %q0, %q1, %2.4s"
+        : "+w"(x) : "w"(y), "w"((uint32x4_t)wk->v));
+    asm(".arch_extension sha2\n\t"
+        "sha256h2 %q0, %q1, %2.4s"
+        : "+w"(y) : "w"(t), "w"((uint32x4_t)wk->v));
+
+    abcd->v = (SHAStateVec)x;
+    efgh->v = (SHAStateVec)y;
+}
+
+static inline void
+sha256_msg1_accel(SHAState *ret, const SHAState *x, const SHAState *y)
+{
+    uint32x4_t d = (uint32x4_t)x->v;
+
+    asm(".arch_extension sha2\n\t"
+        "sha256su0 %0.4s, %1.4s" : "+w"(d) : "w"((uint32x4_t)y->v));
+    ret->v = (SHAStateVec)d;
+}
+
+void sha256_rnds2_accel(SHAState *, const SHAState *, const SHAState *,
+                        uint32_t, uint32_t)
+    QEMU_ERROR("unsupported accel");
+void sha256_msg2_accel(SHAState *, const SHAState *, const SHAState *)
+    QEMU_ERROR("unsupported accel");
+
+static inline void
+sha512h_accel(SHAState *ret, const SHAState *d, const SHAState *n,
+              const SHAState *m)
+{
+    uint64x2_t r = (uint64x2_t)d->v;
+
+    asm(".arch_extension sha3\n\t"
+        "sha512h %q0, %q1, %2.2d"
+        : "+w"(r) : "w"((uint64x2_t)n->v), "w"((uint64x2_t)m->v));
+    ret->v = (SHAStateVec)r;
+}
+
+static inline void
+sha512h2_accel(SHAState *ret, const SHAState *d, const SHAState *n,
+               const SHAState *m)
+{
+    uint64x2_t r = (uint64x2_t)d->v;
+
+    asm(".arch_extension sha3\n\t"
+        "sha512h2 %q0, %q1, %2.2d"
+        : "+w"(r) : "w"((uint64x2_t)n->v), "w"((uint64x2_t)m->v));
+    ret->v = (SHAStateVec)r;
+}
+
+static inline void
+sha512su0_accel(SHAState *ret, const SHAState *d, const SHAState *n)
+{
+    uint64x2_t r = (uint64x2_t)d->v;
+
+    asm(".arch_extension sha3\n\t"
+        "sha512su0 %0.2d, %1.2d" : "+w"(r) : "w"((uint64x2_t)n->v));
+    ret->v = (SHAStateVec)r;
+}
+
+static inline void
+sha512su1_accel(SHAState *ret, const SHAState *d, const SHAState *n,
+                const SHAState *m)
+{
+    uint64x2_t r = (uint64x2_t)d->v;
+
+    asm(".arch_extension sha3\n\t"
+        "sha512su1 %0.2d, %1.2d, %2.2d"
+        : "+w"(r) : "w"((uint64x2_t)n->v), "w"((uint64x2_t)m->v));
+    ret->v = (SHAStateVec)r;
+}
+
+#endif /* AARCH64_HOST_CRYPTO_SHA_ROUND_H */
@@ -0,0 +1,18 @@
+/*
+ * No host specific CRC-32 acceleration.
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef GENERIC_HOST_CRYPTO_CRC32_H
+#define GENERIC_HOST_CRYPTO_CRC32_H
+
+#define HAVE_CRC32_ACCEL   false
+#define HAVE_CRC32C_ACCEL  false
+#define ATTR_CRC32_ACCEL
+
+uint32_t crc32_accel(uint32_t, uint64_t, unsigned)
+    QEMU_ERROR("unsupported accel");
+uint32_t crc32c_accel(uint32_t, uint64_t, unsigned)
+    QEMU_ERROR("unsupported accel");
+
+#endif /* GENERIC_HOST_CRYPTO_CRC32_H */
@@ -0,0 +1,36 @@
+/*
+ * No host specific SHA acceleration.
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef GENERIC_HOST_CRYPTO_SHA_ROUND_H
+#define GENERIC_HOST_CRYPTO_SHA_ROUND_H
+
+#define HAVE_SHA256_ACCEL        false
+#define HAVE_SHA256_RNDS2_ACCEL  false
+#define HAVE_SHA512_ACCEL        false
+#define ATTR_SHA_ACCEL
+
+void sha256_rnds4_accel(SHAState *, SHAState *, const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha256_msg1_accel(SHAState *, const SHAState *, const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha256_rnds2_accel(SHAState *, const SHAState *, const SHAState *,
+                        uint32_t, uint32_t)
+    QEMU_ERROR("unsupported accel");
+void sha256_msg2_accel(SHAState *, const SHAState *, const SHAState *)
+    QEMU_ERROR("unsupported accel");
+
+void sha512h_accel(SHAState *, const SHAState *, const SHAState *,
+                   const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha512h2_accel(SHAState *, const SHAState *, const SHAState *,
+                    const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha512su0_accel(SHAState *, const SHAState *, const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha512su1_accel(SHAState *, const SHAState *, const SHAState *,
+                     const SHAState *)
+    QEMU_ERROR("unsupported accel");
+
+#endif /* GENERIC_HOST_CRYPTO_SHA_ROUND_H */
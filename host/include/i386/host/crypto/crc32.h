@@ -0,0 +1,46 @@
+/*
+ * x86 specific CRC-32 acceleration.
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef X86_HOST_CRYPTO_CRC32_H
+#define X86_HOST_CRYPTO_CRC32_H
+
+#include "host/cpuinfo.h"
+#include <immintrin.h>
+
+/* The SSE4.2 CRC32 instruction only implements the Castagnoli polynomial. */
+#define HAVE_CRC32_ACCEL   false
+#if defined(__SSE4_2__)
+# define HAVE_CRC32C_ACCEL  true
+# define ATTR_CRC32_ACCEL
+#else
+# define HAVE_CRC32C_ACCEL  likely(cpuinfo & CPUINFO_SSE4_2)
+# define ATTR_CRC32_ACCEL   __attribute__((target("sse4.2")))
+#endif
+
+uint32_t crc32_accel(uint32_t, uint64_t, unsigned)
+    QEMU_ERROR("unsupported accel");
+
+static inline uint32_t ATTR_CRC32_ACCEL
+crc32c_accel(uint32_t crc, uint64_t val, unsigned bytes)
+{
+    switch (bytes) {
+    case 1:
+        return _mm_crc32_u8(crc, val);
+    case 2:
+        return _mm_crc32_u16(crc, val);
+    case 4:
+        return _mm_crc32_u32(crc, val);
+    case 8:
+#ifdef __x86_64__
+        return _mm_crc32_u64(crc, val);
+#else
+        return _mm_crc32_u32(_mm_crc32_u32(crc, val), val >> 32);
+#endif
+    default:
+        g_assert_not_reached();
+    }
+}
+
+#endif /* X86_HOST_CRYPTO_CRC32_H */
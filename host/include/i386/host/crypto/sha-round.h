@@ -0,0 +1,79 @@
+/*
+ * x86 specific SHA acceleration.
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef X86_HOST_CRYPTO_SHA_ROUND_H
+#define X86_HOST_CRYPTO_SHA_ROUND_H
+
+#include "host/cpuinfo.h"
+#include <immintrin.h>
+
+#if defined(__SHA__)
+# define HAVE_SHA256_ACCEL        true
+# define ATTR_SHA_ACCEL
+#else
+# define HAVE_SHA256_ACCEL        likely(cpuinfo & CPUINFO_SHA)
+# define ATTR_SHA_ACCEL           __attribute__((target("sha")))
+#endif
+#define HAVE_SHA256_RNDS2_ACCEL   HAVE_SHA256_ACCEL
+#define HAVE_SHA512_ACCEL         false
+
+static inline void ATTR_SHA_ACCEL
+sha256_rnds4_accel(SHAState *abcd, SHAState *efgh, const SHAState *wk)
+{
+    __m128i x = (__m128i)abcd->v;
+    __m128i y = (__m128i)efgh->v;
+    __m128i k = (__m128i)wk->v;
+    __m128i abef, cdgh, abef2;
+
+    /* From { a, b, c, d } and { e, f, g, h } to { f, e, b, a }, etc. */
+    abef = _mm_shuffle_epi32(_mm_unpacklo_epi64(y, x), 0xb1);
+    cdgh = _mm_shuffle_epi32(_mm_unpackhi_epi64(y, x), 0xb1);
+
+    /* After two rounds, the old a, b, e, f become c, d, g, h. */
+    abef2 = _mm_sha256rnds2_epu32(cdgh, abef, k);
+    abef = _mm_sha256rnds2_epu32(abef, abef2, _mm_srli_si128(k, 8));
+
+    abcd->v = (SHAStateVec)_mm_shuffle_epi32(
+        _mm_unpackhi_epi64(abef2, abef), 0x1b);
+    efgh->v = (SHAStateVec)_mm_shuffle_epi32(
+        _mm_unpacklo_epi64(abef2, abef), 0x1b);
+}
+
+static inline void ATTR_SHA_ACCEL
+sha256_msg1_accel(SHAState *ret, const SHAState *x, const SHAState *y)
+{
+    ret->v = (SHAStateVec)_mm_sha256msg1_epu32((__m128i)x->v,
+                                               (__m128i)y->v);
+}
+
+static inline void ATTR_SHA_ACCEL
+sha256_rnds2_accel(SHAState *ret, const SHAState *cdgh,
+                   const SHAState *abef, uint32_t wk0, uint32_t wk1)
+{
+    ret->v = (SHAStateVec)_mm_sha256rnds2_epu32((__m128i)cdgh->v,
+                                                (__m128i)abef->v,
+                                                _mm_set_epi32(0, 0, wk1, wk0));
+}
+
+static inline void ATTR_SHA_ACCEL
+sha256_msg2_accel(SHAState *ret, const SHAState *x, const SHAState *y)
+{
+    ret->v = (SHAStateVec)_mm_sha256msg2_epu32((__m128i)x->v,
+                                               (__m128i)y->v);
+}
+
+void sha512h_accel(SHAState *, const SHAState *, const SHAState *,
+                   const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha512h2_accel(SHAState *, const SHAState *, const SHAState *,
+                    const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha512su0_accel(SHAState *, const SHAState *, const SHAState *)
+    QEMU_ERROR("unsupported accel");
+void sha512su1_accel(SHAState *, const SHAState *, const SHAState *,
+                     const SHAState *)
+    QEMU_ERROR("unsupported accel");
+
+#endif /* X86_HOST_CRYPTO_SHA_ROUND_H */
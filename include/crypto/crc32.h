@@ -0,0 +1,24 @@
+/*
+ * CRC-32 update primitives, generic version
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef CRYPTO_CRC32_H
+#define CRYPTO_CRC32_H
+
+/*
+ * crc32_accel(crc, val, bytes), with HAVE_CRC32_ACCEL:
+ * crc32c_accel(crc, val, bytes), with HAVE_CRC32C_ACCEL:
+ *   Update @crc with the low @bytes bytes of @val, taken in little-endian
+ *   order, for the bit-reflected CRC-32 (0x04c11db7) and CRC-32C
+ *   (0x1edc6f41) polynomials respectively.  @bytes is 1, 2, 4 or 8.
+ *   No inversion is applied to either the input or the result, as for
+ *   the Arm CRC32* and x86 CRC32 instructions.
+ *
+ * There is no generic version: targets keep their own portable code
+ * for hosts without the instructions.
+ */
+
+#include "host/crypto/crc32.h"
+
+#endif /* CRYPTO_CRC32_H */
@@ -0,0 +1,54 @@
+/*
+ * SHA round fragments, generic version
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef CRYPTO_SHA_ROUND_H
+#define CRYPTO_SHA_ROUND_H
+
+/* Hosts with acceleration will usually need a 16-byte vector type. */
+typedef uint32_t SHAStateVec __attribute__((vector_size(16)));
+
+typedef union {
+    uint32_t w[4];
+    uint64_t d[2];
+    SHAStateVec v;
+} SHAState;
+
+/*
+ * There is no generic version of the primitives below: they exist only
+ * when the host provides the matching HAVE_*_ACCEL, and targets keep
+ * their own portable code for the other hosts.  Words are numbered in
+ * host order, w[0] being the least significant one of the vector.
+ *
+ * With HAVE_SHA256_ACCEL:
+ *
+ * sha256_rnds4_accel(abcd, efgh, wk):
+ *   Perform four SHA-256 rounds on the state held as a in abcd->w[0]
+ *   up to d in abcd->w[3], and e up to h in efgh likewise, with
+ *   wk->w[i] holding W[t + i] + K[t + i].  Both halves are updated.
+ *
+ * sha256_msg1_accel(ret, x, y):
+ *   ret->w[i] = x->w[i] + sigma0(x->w[i + 1]), with x->w[4] = y->w[0].
+ *
+ * With HAVE_SHA256_RNDS2_ACCEL, which follows the layout of SHA-NI:
+ *
+ * sha256_rnds2_accel(ret, cdgh, abef, wk0, wk1):
+ *   Perform two SHA-256 rounds on the state held as a in abef->w[3],
+ *   b in w[2], e in w[1], f in w[0], and c, d, g, h likewise in cdgh.
+ *   The new abef is stored in ret.
+ *
+ * sha256_msg2_accel(ret, x, y):
+ *   ret->w[i] = x->w[i] + sigma1(W[i - 2]), with W[-2] and W[-1] in
+ *   y->w[2] and y->w[3], and W[0] and W[1] taken from ret.
+ *
+ * With HAVE_SHA512_ACCEL, the Arm SHA512H, SHA512H2, SHA512SU0 and
+ * SHA512SU1 operations, on 128-bit states:
+ *
+ * sha512h_accel(ret, d, n, m), sha512h2_accel(ret, d, n, m),
+ * sha512su0_accel(ret, d, n), sha512su1_accel(ret, d, n, m).
+ */
+
+#include "host/crypto/sha-round.h"
+
+#endif /* CRYPTO_SHA_ROUND_H */
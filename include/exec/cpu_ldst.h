@@ -377,6 +377,16 @@ static inline void *tlb_vaddr_to_host(CPUArchState *env, abi_ptr addr,
 #else
 void *tlb_vaddr_to_host(CPUArchState *env, abi_ptr addr,
                         MMUAccessType access_type, int mmu_idx);
+
+/**
+ * tlb_vaddr_to_host_nofill:
+ *
+ * Like tlb_vaddr_to_host(), but only look at the TLB entry that is in
+ * place for @addr.  The TLB is never filled, so the guest page tables
+ * are not walked and their accessed bits are left alone.
+ */
+void *tlb_vaddr_to_host_nofill(CPUArchState *env, abi_ptr addr,
+                               MMUAccessType access_type, int mmu_idx);
 #endif
 
 /*
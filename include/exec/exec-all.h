@@ -241,6 +241,58 @@ void tlb_set_page_with_attrs(CPUState *cpu, vaddr addr,
 void tlb_set_page(CPUState *cpu, vaddr addr,
                   hwaddr paddr, int prot,
                   int mmu_idx, vaddr size);
+
+/**
+ * tlb_walk_cache_lookup:
+ * @cpu: CPU context
+ * @mmu_idx: mmu index used by the page table walker to load @addr
+ * @addr: address of the page table descriptor
+ * @pval: returns the cached descriptor
+ *
+ * Look up a page table descriptor cached by tlb_walk_cache_insert().
+ * Like the softmmu tlb itself, the cache is only accessed by the
+ * thread of @cpu.  Guest stores to the pages holding cached descriptors
+ * empty it, as do full tlb flushes of @cpu; page flushes drop only the
+ * descriptors that were loaded from the flushed range or have changed.
+ */
+bool tlb_walk_cache_lookup(CPUState *cpu, int mmu_idx, hwaddr addr,
+                           uint64_t *pval);
+
+/**
+ * tlb_walk_cache_insert:
+ * @cpu: CPU context
+ * @mmu_idx: mmu index used by the page table walker to load @addr
+ * @addr: address of the page table descriptor
+ * @val: value of the descriptor
+ * @host: host address of the descriptor
+ * @memop: size and byte order of the descriptor
+ *
+ * Cache a valid descriptor pointing to the next level of page table,
+ * once any update that the walker makes to it has been done, and write
+ * protect the page holding it.  Nothing is cached unless @host is in
+ * guest RAM.  Leaf descriptors must not be cached, nor looked up.
+ */
+void tlb_walk_cache_insert(CPUState *cpu, int mmu_idx, hwaddr addr,
+                           uint64_t val, void *host, MemOp memop);
+
+/**
+ * tlb_walk_cache_discard:
+ * @cpu: CPU context
+ * @mmu_idx: mmu index used by the page table walker to store to @addr
+ * @addr: address of the page table descriptor
+ *
+ * Drop any cached copy of the descriptor at @addr, which the page
+ * table walker of @cpu is about to update.
+ */
+void tlb_walk_cache_discard(CPUState *cpu, int mmu_idx, hwaddr addr);
+
+/**
+ * tlb_walk_cache_flush:
+ * @cpu: CPU context
+ *
+ * Empty the page table walk cache of @cpu.
+ */
+void tlb_walk_cache_flush(CPUState *cpu);
 #else
 static inline void tlb_init(CPUState *cpu)
 {
@@ -300,6 +352,23 @@ static inline void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
                                                              unsigned bits)
 {
 }
+static inline bool tlb_walk_cache_lookup(CPUState *cpu, int mmu_idx,
+                                         hwaddr addr, uint64_t *pval)
+{
+    return false;
+}
+static inline void tlb_walk_cache_insert(CPUState *cpu, int mmu_idx,
+                                         hwaddr addr, uint64_t val,
+                                         void *host, MemOp memop)
+{
+}
+static inline void tlb_walk_cache_discard(CPUState *cpu, int mmu_idx,
+                                          hwaddr addr)
+{
+}
+static inline void tlb_walk_cache_flush(CPUState *cpu)
+{
+}
 #endif
 
 #if defined(CONFIG_TCG)
@@ -524,6 +593,16 @@ void TSA_NO_TSA mmap_lock(void);
 void TSA_NO_TSA mmap_unlock(void);
 bool have_mmap_lock(void);
 
+/**
+ * cpu_vdso_syscall:
+ * @cpu: the vCPU with a pending exception
+ *
+ * Emulate a system call made from the guest vDSO without leaving
+ * cpu_exec(), if it is one of the calls the vDSO exists to speed up.
+ * Return true if the exception has been consumed.
+ */
+bool cpu_vdso_syscall(CPUState *cpu);
+
 static inline void mmap_unlock_guard(void *unused)
 {
     mmap_unlock();
@@ -0,0 +1,40 @@
+/*
+ * Persistent translation block cache for user-mode emulation.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#ifndef EXEC_TB_PCACHE_H
+#define EXEC_TB_PCACHE_H
+
+/**
+ * tb_pcache_init() - select the persistent cache file for this process
+ * @dir: directory holding cache files
+ * @execfd: file descriptor of the guest main executable
+ * @cpu_type: QOM type of the emulated cpu
+ *
+ * The cache file is keyed by the identity (device, inode, size, mtime)
+ * of the guest executable and by @cpu_type.  If a usable cache file
+ * exists, ask TCG to place code_gen_buffer at the address recorded in
+ * it.  Must be called before the TCG accelerator is initialized.
+ */
+void tb_pcache_init(const char *dir, int execfd, const char *cpu_type);
+
+/**
+ * tb_pcache_load() - map the persistent cache into code_gen_buffer
+ *
+ * Called once the prologue has been generated.  The cached code is
+ * only used if the prologue, buffer placement and emulator binary are
+ * identical to those of the run that wrote the cache; individual
+ * translation blocks are adopted lazily by tb_gen_code() after their
+ * guest bytes have been compared with the currently mapped guest code.
+ */
+void tb_pcache_load(void);
+
+/**
+ * tb_pcache_save() - write the live translation blocks to the cache file
+ *
+ * Called at process exit.
+ */
+void tb_pcache_save(void);
+
+#endif /* EXEC_TB_PCACHE_H */
@@ -78,6 +78,7 @@ struct TranslationBlock {
 #define CF_NOIRQ         0x00010000 /* Generate an uninterruptible TB */
 #define CF_PCREL         0x00020000 /* Opcodes in TB are PC-relative */
 #define CF_BP_PAGE       0x00040000 /* Breakpoint present in code page */
+#define CF_TIER2         0x00080000 /* Hot TB retranslation; not a lookup key */
 #define CF_CLUSTER_MASK  0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 
@@ -91,6 +92,12 @@ struct TranslationBlock {
 
     struct tb_tc tc;
 
+    /*
+     * Execution counter, incremented by the generated code on entry.
+     * Only allocated when hot TB promotion is enabled, see tb_promote().
+     */
+    struct TBExecCounter *exec_counter;
+
     /*
      * Track tb_page_addr_t intervals that intersect this TB.
      * For user-only, the virtual addresses are always contiguous,
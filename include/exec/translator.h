@@ -172,6 +172,77 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
  */
 bool translator_use_goto_tb(DisasContextBase *db, vaddr dest);
 
+/**
+ * translator_use_goto_tb_xpage
+ * @db: Disassembly context
+ * @dest: target pc of the goto, outside the first page of the TB
+ *
+ * Return true if goto_tb to @dest may still be used, provided that
+ * it is emitted with translator_goto_tb_xpage().  Only system mode
+ * supports this, for destinations in RAM.
+ */
+bool translator_use_goto_tb_xpage(DisasContextBase *db, vaddr dest);
+
+/**
+ * translator_goto_tb_xpage
+ * @db: Disassembly context
+ * @idx: jump slot, as for tcg_gen_goto_tb()
+ * @dest: target pc of the goto
+ * @dest_val: runtime value of @dest, or NULL if not CF_PCREL
+ *
+ * Emit goto_tb @idx, guarded by a check that the running vCPU still
+ * maps @dest to the page it was mapped to during translation.  The
+ * caller emits the same code after this as after tcg_gen_goto_tb().
+ * If the check fails, execution goes to the returned label instead,
+ * where the caller must set the pc and leave without a linkable exit,
+ * e.g. with tcg_gen_lookup_and_goto_ptr().
+ * With CF_PCREL, @dest_val must hold the virtual address of @dest.
+ */
+struct TCGLabel *translator_goto_tb_xpage(DisasContextBase *db, int idx,
+                                          vaddr dest,
+                                          struct TCGv_i64_d *dest_val);
+
+/**
+ * translator_ras_push
+ * @db: Disassembly context
+ * @ret_pc: runtime value of the return address of a guest call
+ *
+ * Push @ret_pc to the vCPU's shadow return-address stack, to be
+ * popped by translator_ras_return().  @ret_pc is the pc of the TB
+ * the return is expected to land in, as computed by
+ * cpu_get_tb_cpu_state().  Does nothing unless the stack is enabled.
+ */
+void translator_ras_push(DisasContextBase *db, struct TCGv_i64_d *ret_pc);
+
+/**
+ * translator_ras_return
+ * @db: Disassembly context
+ * @dest: runtime value of the pc being returned to
+ *
+ * Emit a replacement for tcg_gen_lookup_and_goto_ptr() at the end of
+ * a guest return.  The prediction popped from the return-address
+ * stack is used if its pc is @dest, and its TB has the same cs_base,
+ * flags and cflags as the current TB.  The caller must ensure that
+ * the return itself changes none of the state that goes into the TB
+ * flags.  Otherwise, or if the stack is disabled, this is the same as
+ * tcg_gen_lookup_and_goto_ptr().
+ */
+void translator_ras_return(DisasContextBase *db, struct TCGv_i64_d *dest);
+
+/**
+ * translator_follow_jump
+ * @db: Disassembly context
+ * @dest: target pc of an unconditional direct branch
+ *
+ * Return true if translation may continue at @dest rather than ending
+ * the TB with a jump to it.  This is only done when retranslating a hot
+ * TB (CF_TIER2), and only for forward branches within the first page
+ * of the TB.  @dest must not precede the end of the branch insn.
+ * On success, the caller updates its notion of the next pc to @dest
+ * and leaves db->is_jmp as DISAS_NEXT.
+ */
+bool translator_follow_jump(DisasContextBase *db, vaddr dest);
+
 /**
  * translator_io_start
  * @db: Disassembly context
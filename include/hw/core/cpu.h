@@ -203,6 +203,12 @@ struct CPUClass {
 /* Use a fully associative victim tlb of 8 entries. */
 #define CPU_VTLB_SIZE 8
 
+/* Track up to 8 regions of large pages per mmu mode. */
+#define CPU_TLB_LARGE_PAGES 8
+
+/* Cache up to 64 page table descriptors, see tlb_walk_cache_lookup(). */
+#define CPU_TLB_WALK_BITS 6
+
 /*
  * The full TLB entry, which is not accessed by generated TCG code,
  * so the layout is not as critical as that of CPUTLBEntry. This is
@@ -270,15 +276,23 @@ struct CPUTLBEntryFull {
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
  */
+/*
+ * A naturally aligned region of virtual addresses: a virtual address
+ * va is within the region if (va & mask) == addr.
+ */
+typedef struct CPUTLBLargePage {
+    vaddr addr;
+    vaddr mask;
+} CPUTLBLargePage;
+
 typedef struct CPUTLBDesc {
     /*
-     * Describe a region covering all of the large pages allocated
-     * into the tlb.  When any page within this region is flushed,
-     * we must flush the entire tlb.  The region is matched if
-     * (addr & large_page_mask) == large_page_addr.
+     * Describe regions covering all of the large pages allocated
+     * into the tlb.  When any page within a region is flushed, we
+     * must flush every entry within that region.
      */
-    vaddr large_page_addr;
-    vaddr large_page_mask;
+    CPUTLBLargePage large_pages[CPU_TLB_LARGE_PAGES];
+    unsigned n_large_pages;
     /* host time (in ns) at the beginning of the time window */
     int64_t window_begin_ns;
     /* maximum number of entries observed in the window */
@@ -292,6 +306,19 @@ typedef struct CPUTLBDesc {
     CPUTLBEntryFull *fulltlb;
 } CPUTLBDesc;
 
+/*
+ * A page table descriptor, loaded through mmu_idx from addr, which is
+ * -1 if the entry is unused.  host points to the descriptor in RAM and
+ * memop, a MemOp, gives its size and byte order.
+ */
+typedef struct CPUTLBWalkEntry {
+    hwaddr addr;
+    uint64_t val;
+    void *host;
+    int mmu_idx;
+    uint8_t memop;
+} CPUTLBWalkEntry;
+
 /*
  * Data elements that are shared between all MMU modes.
  */
@@ -312,6 +339,15 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    /* Page flushes that had to flush a whole region of large pages */
+    size_t large_flush_count;
+    /* Lookups in the page table walk cache */
+    size_t walk_hit_count;
+    size_t walk_miss_count;
+    /* Page table walk cache, only accessed by the cpu's thread */
+    CPUTLBWalkEntry walk[1 << CPU_TLB_WALK_BITS];
+    /* Value of tlb_walk_gen when walk was last emptied */
+    unsigned walk_gen;
 } CPUTLBCommon;
 
 /*
@@ -370,6 +406,22 @@ typedef struct CPUNegativeOffsetState {
     bool can_do_io;
 } CPUNegativeOffsetState;
 
+#define TB_RAS_SIZE 16
+
+/*
+ * Shadow return-address stack: a call pushes its return address, and
+ * the TB it mapped to when the call was made.  See translator_ras_push().
+ */
+typedef struct CPUReturnStack {
+    struct {
+        vaddr pc;
+        TranslationBlock *tb;
+    } ent[TB_RAS_SIZE];
+    uint32_t top;               /* free running, index modulo TB_RAS_SIZE */
+    uint64_t hit_count;
+    uint64_t miss_count;
+} CPUReturnStack;
+
 struct KVMState;
 struct kvm_run;
 
@@ -509,6 +561,12 @@ struct CPUState {
     MemoryRegion *memory;
 
     struct CPUJumpCache *tb_jmp_cache;
+    /* Cross-page direct jumps taken, see translator_goto_tb_xpage() */
+    uint64_t tb_xpage_jmp_count;
+    uint64_t tb_xpage_miss_count;
+    CPUReturnStack tb_ras;
+    /* A profiler sample is queued, see accel/tcg/profile.c */
+    bool tb_profile_pending;
 
     GArray *gdb_regs;
     int gdb_num_regs;
@@ -31,6 +31,9 @@
 #ifndef bit_SSE4_1
 #define bit_SSE4_1      (1 << 19)
 #endif
+#ifndef bit_SSE4_2
+#define bit_SSE4_2      (1 << 20)
+#endif
 #ifndef bit_MOVBE
 #define bit_MOVBE       (1 << 22)
 #endif
@@ -57,6 +60,9 @@
 #ifndef bit_AVX512DQ
 #define bit_AVX512DQ    (1 << 17)
 #endif
+#ifndef bit_SHA
+#define bit_SHA         (1 << 29)
+#endif
 #ifndef bit_AVX512BW
 #define bit_AVX512BW    (1 << 30)
 #endif
@@ -72,6 +72,10 @@ enum plugin_dyn_cb_type {
     PLUGIN_CB_MEM_REGULAR,
     PLUGIN_CB_INLINE_ADD_U64,
     PLUGIN_CB_INLINE_STORE_U64,
+    PLUGIN_CB_INLINE_MIN_U64,
+    PLUGIN_CB_INLINE_MAX_U64,
+    PLUGIN_CB_INLINE_SET_BIT,
+    PLUGIN_CB_TRACE,
 };
 
 struct qemu_plugin_regular_cb {
@@ -85,6 +89,10 @@ struct qemu_plugin_inline_cb {
     qemu_plugin_u64 entry;
     uint64_t imm;
     enum qemu_plugin_mem_rw rw;
+    /* if set, the element of @entry is selected by the access address */
+    bool indexed;
+    unsigned int shift;
+    uint64_t mask;
 };
 
 struct qemu_plugin_conditional_cb {
@@ -96,6 +104,15 @@ struct qemu_plugin_conditional_cb {
     uint64_t imm;
 };
 
+struct qemu_plugin_trace_cb {
+    struct qemu_plugin_trace_buffer *buf;
+    qemu_plugin_vcpu_udata_cb_t drain;
+    TCGHelperInfo *info;
+    uint64_t pc;
+    uint32_t flags;
+    enum qemu_plugin_mem_rw rw;
+};
+
 /*
  * A dynamic callback has an insertion point that is determined at run-time.
  * Usually the insertion point is somewhere in the code cache; think for
@@ -107,6 +124,7 @@ struct qemu_plugin_dyn_cb {
         struct qemu_plugin_regular_cb regular;
         struct qemu_plugin_conditional_cb cond;
         struct qemu_plugin_inline_cb inline_insn;
+        struct qemu_plugin_trace_cb trace;
     };
 };
 
@@ -128,6 +146,29 @@ struct qemu_plugin_scoreboard {
     QLIST_ENTRY(qemu_plugin_scoreboard) entry;
 };
 
+/*
+ * Most records an instruction may append to a trace buffer from
+ * generated code. Room for them is checked once, before the
+ * instruction, so that the appends next to its memory accesses
+ * do not need to branch.
+ */
+#define PLUGIN_TRACE_INSN_MAX 256
+
+/* Per-vCPU state of a trace buffer, the elements of its scoreboard */
+struct qemu_plugin_trace_vcpu {
+    qemu_plugin_trace_record *next;
+    uint64_t left;              /* records that fit after @next */
+    qemu_plugin_trace_record *records;
+};
+
+/* A trace buffer is a scoreboard of record arrays, drained when full */
+struct qemu_plugin_trace_buffer {
+    struct qemu_plugin_scoreboard *score;
+    size_t n_records;
+    qemu_plugin_trace_drain_cb_t drain;
+    void *userp;
+};
+
 /* Internal context for this TranslationBlock */
 struct qemu_plugin_tb {
     GPtrArray *insns;
@@ -65,11 +65,18 @@ typedef uint64_t qemu_plugin_id_t;
  *
  * version 4:
  * - added qemu_plugin_read_memory_vaddr
+ *
+ * version 5:
+ * - added trace buffers: qemu_plugin_trace_buffer_{new,flush,free},
+ *   qemu_plugin_register_vcpu_insn_exec_trace and
+ *   qemu_plugin_register_vcpu_mem_trace
+ * - added inline ops QEMU_PLUGIN_INLINE_{MIN_U64,MAX_U64,SET_BIT} and
+ *   qemu_plugin_register_vcpu_{tb_exec,insn_exec,mem}_inline_indexed_per_vcpu
  */
 
 extern QEMU_PLUGIN_EXPORT int qemu_plugin_version;
 
-#define QEMU_PLUGIN_VERSION 4
+#define QEMU_PLUGIN_VERSION 5
 
 /**
  * struct qemu_info_t - system information for plugins
@@ -386,11 +393,23 @@ void qemu_plugin_register_vcpu_tb_exec_cond_cb(struct qemu_plugin_tb *tb,
  *
  * @QEMU_PLUGIN_INLINE_ADD_U64: add an immediate value uint64_t
  * @QEMU_PLUGIN_INLINE_STORE_U64: store an immediate value uint64_t
+ * @QEMU_PLUGIN_INLINE_MIN_U64: store an immediate value uint64_t if it is
+ *                              lower (unsigned) than the current one
+ * @QEMU_PLUGIN_INLINE_MAX_U64: store an immediate value uint64_t if it is
+ *                              higher (unsigned) than the current one
+ * @QEMU_PLUGIN_INLINE_SET_BIT: set bit number imm of a bitmap of uint64_t,
+ *                              bit 0 being the lowest bit of the entry
+ *
+ * Scoreboard entries start at 0, use a vCPU init callback to start a
+ * QEMU_PLUGIN_INLINE_MIN_U64 entry at UINT64_MAX.
  */
 
 enum qemu_plugin_op {
     QEMU_PLUGIN_INLINE_ADD_U64,
     QEMU_PLUGIN_INLINE_STORE_U64,
+    QEMU_PLUGIN_INLINE_MIN_U64,
+    QEMU_PLUGIN_INLINE_MAX_U64,
+    QEMU_PLUGIN_INLINE_SET_BIT,
 };
 
 /**
@@ -409,6 +428,30 @@ void qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
     qemu_plugin_u64 entry,
     uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_tb_exec_inline_indexed_per_vcpu() - indexed op
+ * @tb: the opaque qemu_plugin_tb handle for the translation
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @entry: first element of an array of uint64_t
+ * @shift: right shift applied to the address of the block
+ * @n: number of elements of the array, a power of 2
+ * @imm: the op data (e.g. 1)
+ *
+ * Insert an inline op on element ((vaddr >> @shift) & (@n - 1)) of an
+ * array starting at @entry, where vaddr is the address of the block. For
+ * QEMU_PLUGIN_INLINE_SET_BIT, the array is a bitmap of @n bits, the
+ * element is the bit to set and @imm is ignored. The array must fit in
+ * the scoreboard element, which is checked at registration.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_tb_exec_inline_indexed_per_vcpu(
+    struct qemu_plugin_tb *tb,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    unsigned int shift,
+    uint64_t n,
+    uint64_t imm);
+
 /**
  * qemu_plugin_register_vcpu_insn_exec_cb() - register insn execution cb
  * @insn: the opaque qemu_plugin_insn handle for an instruction
@@ -467,6 +510,27 @@ void qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(
     qemu_plugin_u64 entry,
     uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_insn_exec_inline_indexed_per_vcpu() - indexed op
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @entry: first element of an array of uint64_t
+ * @shift: right shift applied to the address of the instruction
+ * @n: number of elements of the array, a power of 2
+ * @imm: the op data (e.g. 1)
+ *
+ * Same as qemu_plugin_register_vcpu_tb_exec_inline_indexed_per_vcpu(),
+ * with the element selected by the address of the instruction.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_insn_exec_inline_indexed_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    unsigned int shift,
+    uint64_t n,
+    uint64_t imm);
+
 /**
  * qemu_plugin_tb_n_insns() - query helper for number of insns in TB
  * @tb: opaque handle to TB passed to callback
@@ -701,6 +765,31 @@ void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
     qemu_plugin_u64 entry,
     uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_mem_inline_indexed_per_vcpu() - indexed op
+ * @insn: handle for instruction to instrument
+ * @rw: apply to reads, writes or both
+ * @op: the op, of type qemu_plugin_op
+ * @entry: first element of an array of uint64_t
+ * @shift: right shift applied to the address of the access
+ * @n: number of elements of the array, a power of 2
+ * @imm: immediate data for @op
+ *
+ * Same as qemu_plugin_register_vcpu_tb_exec_inline_indexed_per_vcpu(),
+ * with the element selected by the virtual address of each memory
+ * access of the instruction. For instance, a @shift of 12 counts the
+ * accesses to each 4K page in @n buckets.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_mem_inline_indexed_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_mem_rw rw,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    unsigned int shift,
+    uint64_t n,
+    uint64_t imm);
+
 /**
  * qemu_plugin_request_time_control() - request the ability to control time
  *
@@ -1001,4 +1090,109 @@ void qemu_plugin_u64_set(qemu_plugin_u64 entry, unsigned int vcpu_index,
 QEMU_PLUGIN_API
 uint64_t qemu_plugin_u64_sum(qemu_plugin_u64 entry);
 
+/**
+ * struct qemu_plugin_trace_buffer - Opaque handle for a trace buffer
+ *
+ * A trace buffer holds one array of records per vCPU. Records are
+ * appended by the generated code, without calling back into the
+ * plugin, and handed to the plugin in batches.
+ */
+struct qemu_plugin_trace_buffer;
+
+/**
+ * typedef qemu_plugin_trace_record - a record of a trace buffer
+ * @pc: virtual address of the instruction
+ * @vaddr: virtual address of the memory access, 0 for an instruction
+ * @info: meminfo of the memory access, 0 for an instruction. Query it
+ *        with the qemu_plugin_mem_* functions.
+ * @flags: value given when the record was registered
+ */
+typedef struct {
+    uint64_t pc;
+    uint64_t vaddr;
+    qemu_plugin_meminfo_t info;
+    uint32_t flags;
+} qemu_plugin_trace_record;
+
+/**
+ * typedef qemu_plugin_trace_drain_cb_t - trace buffer drain callback
+ * @vcpu_index: the vCPU the records were appended by
+ * @records: the records, oldest first
+ * @n: number of records
+ * @userdata: pointer given to qemu_plugin_trace_buffer_new()
+ *
+ * Called from the vCPU thread when its buffer is full. @records
+ * belongs to the buffer and is only valid until the callback returns.
+ */
+typedef void (*qemu_plugin_trace_drain_cb_t)(
+    unsigned int vcpu_index, const qemu_plugin_trace_record *records,
+    size_t n, void *userdata);
+
+/**
+ * qemu_plugin_trace_buffer_new() - alloc a new trace buffer
+ * @n_records: number of records per vCPU
+ * @cb: callback to drain the records of a vCPU
+ * @userdata: any plugin data to pass to @cb
+ *
+ * @n_records is rounded up to a minimum size, and a vCPU may drain its
+ * buffer before it is completely full. Returns a pointer to a new
+ * trace buffer. It must be freed using qemu_plugin_trace_buffer_free.
+ */
+QEMU_PLUGIN_API
+struct qemu_plugin_trace_buffer *
+qemu_plugin_trace_buffer_new(size_t n_records,
+                             qemu_plugin_trace_drain_cb_t cb,
+                             void *userdata);
+
+/**
+ * qemu_plugin_trace_buffer_flush() - drain the records of all vCPUs
+ * @buf: trace buffer to flush
+ *
+ * Calls the drain callback for every vCPU with pending records. The
+ * vCPUs must not be running, e.g. call it from the atexit callback.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_trace_buffer_flush(struct qemu_plugin_trace_buffer *buf);
+
+/**
+ * qemu_plugin_trace_buffer_free() - free a trace buffer
+ * @buf: trace buffer to free
+ *
+ * Pending records are discarded, flush the buffer first to keep them.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_trace_buffer_free(struct qemu_plugin_trace_buffer *buf);
+
+/**
+ * qemu_plugin_register_vcpu_insn_exec_trace() - trace insn execution
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @buf: trace buffer to append to
+ * @flags: value to store in the flags field of the record
+ *
+ * Append a record to @buf of the running vCPU each time @insn is
+ * executed.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_insn_exec_trace(
+    struct qemu_plugin_insn *insn,
+    struct qemu_plugin_trace_buffer *buf,
+    uint32_t flags);
+
+/**
+ * qemu_plugin_register_vcpu_mem_trace() - trace memory accesses
+ * @insn: handle for instruction to instrument
+ * @rw: apply to reads, writes or both
+ * @buf: trace buffer to append to
+ * @flags: value to store in the flags field of the record
+ *
+ * Append a record to @buf of the running vCPU for each memory access
+ * of @insn.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_mem_trace(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_mem_rw rw,
+    struct qemu_plugin_trace_buffer *buf,
+    uint32_t flags);
+
 #endif /* QEMU_QEMU_PLUGIN_H */
@@ -29,13 +29,34 @@
  * tcg_init: Initialize the TCG runtime
  * @tb_size: translation buffer size
  * @splitwx: use separate rw and rx mappings
- * @max_cpus: number of vcpus in system mode
+ * @max_cpus: number of TCG threads (vcpus and translation workers)
+ *            in system mode
  *
  * Allocate and initialize TCG resources, especially the JIT buffer.
  * In user-only mode, @max_cpus is unused.
  */
 void tcg_init(size_t tb_size, int splitwx, unsigned max_cpus);
 
+/**
+ * tcg_set_code_gen_buffer_hint: Suggest a host address for the JIT buffer
+ * @addr: preferred start address, or NULL to let the host choose
+ *
+ * Must be called before tcg_init().  The address is only a hint passed
+ * to mmap; the caller must check where the buffer was actually placed.
+ */
+void tcg_set_code_gen_buffer_hint(void *addr);
+
+/**
+ * tcg_set_cold_code: Keep slow paths out of the translated blocks
+ * @enable: true to place slow paths in a separate area
+ *
+ * Must be called before tcg_init().  If @enable, the end of each region
+ * of the JIT buffer is set aside for the qemu_ld/st slow paths of the
+ * TBs in the region, so that the TBs themselves contain only code that
+ * is expected to run.  Ignored unless the backend supports it.
+ */
+void tcg_set_cold_code(bool enable);
+
 /**
  * tcg_register_thread: Register this thread with the TCG runtime
  *
@@ -74,6 +74,17 @@ void tcg_gen_goto_tb(unsigned idx);
  */
 void tcg_gen_lookup_and_goto_ptr(void);
 
+/**
+ * tcg_gen_goto_ptr() - jump to host code
+ * @ptr: tc.ptr of a TB that is valid for the current CPU state,
+ *       or tcg_code_gen_epilogue
+ *
+ * Like the second half of tcg_gen_lookup_and_goto_ptr(), for callers
+ * that found the destination TB by other means.  The TB must not have
+ * CF_NO_GOTO_PTR.
+ */
+void tcg_gen_goto_ptr(TCGv_ptr ptr);
+
 void tcg_gen_plugin_cb(unsigned from);
 void tcg_gen_plugin_mem_cb(TCGv_i64 addr, unsigned meminfo);
 
@@ -134,7 +134,8 @@ typedef uint64_t TCGRegSet;
 
 #if !defined(TCG_TARGET_HAS_v64) \
     && !defined(TCG_TARGET_HAS_v128) \
-    && !defined(TCG_TARGET_HAS_v256)
+    && !defined(TCG_TARGET_HAS_v256) \
+    && !defined(TCG_TARGET_HAS_v512)
 #define TCG_TARGET_MAYBE_vec            0
 #define TCG_TARGET_HAS_abs_vec          0
 #define TCG_TARGET_HAS_neg_vec          0
@@ -168,6 +169,9 @@ typedef uint64_t TCGRegSet;
 #ifndef TCG_TARGET_HAS_v256
 #define TCG_TARGET_HAS_v256             0
 #endif
+#ifndef TCG_TARGET_HAS_v512
+#define TCG_TARGET_HAS_v512             0
+#endif
 
 typedef enum TCGOpcode {
 #define DEF(name, oargs, iargs, cargs, flags) INDEX_op_ ## name,
@@ -246,9 +250,10 @@ typedef enum TCGType {
     TCG_TYPE_V64,
     TCG_TYPE_V128,
     TCG_TYPE_V256,
+    TCG_TYPE_V512,
 
     /* Number of different types (integer not enum) */
-#define TCG_TYPE_COUNT  (TCG_TYPE_V256 + 1)
+#define TCG_TYPE_COUNT  (TCG_TYPE_V512 + 1)
 
     /* An alias for the size of the host register.  */
 #if TCG_TARGET_REG_BITS == 32
@@ -450,6 +455,20 @@ static inline TCGRegSet output_pref(const TCGOp *op, unsigned i)
     return i < ARRAY_SIZE(op->output_pref) ? op->output_pref[i] : 0;
 }
 
+/*
+ * Per-context counters for "info jit", written only by the thread that
+ * owns the context; see tcg_opt_stats().
+ */
+typedef struct TCGOptStats {
+    size_t ops_in;          /* ops emitted by the front end */
+    size_t ops_opt;         /* ops left after tcg_optimize() */
+    size_t ops_live;        /* ops left after liveness analysis */
+    size_t ld_forward;      /* env loads replaced by a known value */
+    size_t st_dup;          /* env stores of a value already there */
+    size_t st_dead;         /* env stores overwritten before any use */
+    size_t ext_elim;        /* extensions found to be no-ops */
+} TCGOptStats;
+
 struct TCGContext {
     uint8_t *pool_cur, *pool_end;
     TCGPool *pool_first, *pool_current, *pool_first_large;
@@ -493,9 +512,27 @@ struct TCGContext {
     /* Threshold to flush the translated code buffer.  */
     void *code_gen_highwater;
 
+    /*
+     * Cold area at the end of the current region, for the slow paths
+     * of all TBs in the region, or NULL.  cold_code_ptr is the end of
+     * the slow paths of the TB being generated.
+     */
+    void *code_gen_cold_ptr;
+    void *code_gen_cold_highwater;
+    tcg_insn_unit *cold_code_ptr;
+
     /* Track which vCPU triggers events */
     CPUState *cpu;                      /* *_trans */
 
+    /* Same-page goto_tb destinations of the TB being translated */
+    uint64_t gen_tb_succ[2];
+    int gen_tb_nb_succ;
+
+    /* Context of a speculative translation worker thread */
+    bool speculative;
+
+    TCGOptStats opt_stats;
+
     /* These structures are private to tcg-target.c.inc.  */
 #ifdef TCG_TARGET_NEED_LDST_LABELS
     QSIMPLEQ_HEAD(, TCGLabelQemuLdst) ldst_labels;
@@ -742,9 +779,12 @@ void tcg_pool_reset(TCGContext *s);
 TranslationBlock *tcg_tb_alloc(TCGContext *s);
 
 void tcg_region_reset_all(void);
+bool tcg_region_evict(GTraverseFunc func, gpointer user_data,
+                      size_t *n_evicted);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
+void tcg_opt_stats(TCGOptStats *stats);
 
 void tcg_tb_insert(TranslationBlock *tb);
 void tcg_tb_remove(TranslationBlock *tb);
@@ -978,11 +1018,10 @@ static inline size_t tcg_current_code_size(TCGContext *s)
  *        TB index (0 or 1). That is, we left the TB via (the equivalent
  *        of) "goto_tb <index>". The main loop uses this to determine
  *        how to link the TB just executed to the next.
- *  2:    we are using instruction counting code generation, and we
- *        did not start executing this TB because the instruction counter
- *        would hit zero midway through it. In this case the pointer
- *        returned is the TB we were about to execute, and the caller must
- *        arrange to execute the remaining count of instructions.
+ *  2:    we did not start executing this TB because its execution
+ *        counter reached the hot TB threshold.  The pointer returned is
+ *        the TB we were about to execute, which the caller should
+ *        retranslate as a tier-2 TB.
  *  3:    we stopped because the CPU's exit_request flag was set
  *        (usually meaning that there is an interrupt that needs to be
  *        handled). The pointer returned is the TB we were about to execute
@@ -1005,6 +1044,7 @@ static inline size_t tcg_current_code_size(TCGContext *s)
 #define TB_EXIT_IDX0      0
 #define TB_EXIT_IDX1      1
 #define TB_EXIT_IDXMAX    1
+#define TB_EXIT_PROMOTE   2
 #define TB_EXIT_REQUESTED 3
 
 #ifdef CONFIG_TCG_INTERPRETER
@@ -47,4 +47,24 @@ static inline abi_ulong get_sp_from_cpustate(CPUARMState *state)
 {
    return state->xregs[31];
 }
+
+/* For cpu_vdso_syscall(); the pc is already past the SVC. */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPUARMState *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+    /* Leave the clearing of PSTATE.SM to cpu_loop(). */
+    if (excp != EXCP_SWI || (env->svcr & R_SVCR_SM_MASK)) {
+        return -1;
+    }
+    *arg1 = env->xregs[0];
+    *arg2 = env->xregs[1];
+    return env->xregs[8];
+}
+
+static inline void cpu_vdso_syscall_return(CPUARMState *env, abi_long ret)
+{
+    env->xregs[0] = ret;
+}
 #endif
@@ -76,4 +76,29 @@ static inline abi_ulong get_sp_from_cpustate(CPUARMState *state)
 {
    return state->regs[13];
 }
+
+/*
+ * For cpu_vdso_syscall(); the pc is already past the SVC.  The vDSO
+ * always uses the EABI convention, with the syscall number in r7.
+ * Record that as cpu_loop() does, before the call: do_syscall1()
+ * reads env->eabi to lay out the arguments.
+ */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPUARMState *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+    if (excp != EXCP_SWI) {
+        return -1;
+    }
+    env->eabi = true;
+    *arg1 = env->regs[0];
+    *arg2 = env->regs[1];
+    return env->regs[7];
+}
+
+static inline void cpu_vdso_syscall_return(CPUARMState *env, abi_long ret)
+{
+    env->regs[0] = ret;
+}
 #endif
@@ -3537,6 +3537,10 @@ static void load_elf_vdso(struct image_info *info, const VdsoImageInfo *vdso)
         *addr = tswapal(tswapal(*addr) + load_bias);
     }
 
+    /* Let cpu_vdso_syscall() recognize system calls from the vDSO. */
+    vdso_code_start = info->start_code;
+    vdso_code_end = info->end_code;
+
     /* Install signal trampolines, if present. */
     if (vdso->sigreturn_ofs) {
         default_sigreturn = load_addr + vdso->sigreturn_ofs;
@@ -54,4 +54,34 @@ static inline abi_ulong get_sp_from_cpustate(CPUX86State *state)
 {
     return state->regs[R_ESP];
 }
+
+/*
+ * For cpu_vdso_syscall().  The exception has already been delivered
+ * by x86_cpu_do_interrupt(), which moved eip past the instruction.
+ */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPUX86State *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+#if defined(TARGET_ABI32)
+    if (excp != 0x80 && excp != EXCP_SYSCALL) {
+        return -1;
+    }
+    *arg1 = env->regs[R_EBX];
+    *arg2 = env->regs[R_ECX];
+#else
+    if (excp != EXCP_SYSCALL) {
+        return -1;
+    }
+    *arg1 = env->regs[R_EDI];
+    *arg2 = env->regs[R_ESI];
+#endif
+    return env->regs[R_EAX];
+}
+
+static inline void cpu_vdso_syscall_return(CPUX86State *env, abi_long ret)
+{
+    env->regs[R_EAX] = ret;
+}
 #endif /* I386_TARGET_CPU_H */
@@ -31,4 +31,25 @@ static inline abi_ulong get_sp_from_cpustate(CPULoongArchState *state)
 {
     return state->gpr[3];
 }
+
+/* For cpu_vdso_syscall(); the pc is still on the SYSCALL. */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPULoongArchState *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+    if (excp != EXCCODE_SYS) {
+        return -1;
+    }
+    *arg1 = env->gpr[4];
+    *arg2 = env->gpr[5];
+    return env->gpr[11];
+}
+
+static inline void cpu_vdso_syscall_return(CPULoongArchState *env,
+                                           abi_long ret)
+{
+    env->pc += 4;
+    env->gpr[4] = ret;
+}
 #endif
@@ -56,6 +56,7 @@
 #include "loader.h"
 #include "user-mmap.h"
 #include "tcg/perf.h"
+#include "exec/tb-pcache.h"
 #include "exec/page-vary.h"
 
 #ifdef CONFIG_SEMIHOSTING
@@ -71,12 +72,14 @@ char *exec_path;
 char real_exec_path[PATH_MAX];
 
 static bool opt_one_insn_per_tb;
+static bool opt_atomic_locks;
 static const char *argv0;
 static const char *gdbstub;
 static envlist_t *envlist;
 static const char *cpu_model;
 static const char *cpu_type;
 static const char *seed_optarg;
+static const char *tb_cache_dir;
 unsigned long mmap_min_addr;
 uintptr_t guest_base;
 bool have_guest_base;
@@ -424,6 +427,11 @@ static void handle_arg_one_insn_per_tb(const char *arg)
     opt_one_insn_per_tb = true;
 }
 
+static void handle_arg_atomic_locks(const char *arg)
+{
+    opt_atomic_locks = true;
+}
+
 static void handle_arg_strace(const char *arg)
 {
     enable_strace = true;
@@ -458,6 +466,11 @@ static void handle_arg_jitdump(const char *arg)
     perf_enable_jitdump();
 }
 
+static void handle_arg_tb_cache(const char *arg)
+{
+    tb_cache_dir = arg;
+}
+
 static QemuPluginList plugins = QTAILQ_HEAD_INITIALIZER(plugins);
 
 #ifdef CONFIG_PLUGIN
@@ -516,6 +529,9 @@ static const struct qemu_argument arg_table[] = {
     {"one-insn-per-tb",
                    "QEMU_ONE_INSN_PER_TB",  false, handle_arg_one_insn_per_tb,
      "",           "run with one guest instruction per emulated TB"},
+    {"atomic-locks",
+                   "QEMU_ATOMIC_LOCKS",  false, handle_arg_atomic_locks,
+     "",           "emulate wide atomics with locks, not by stopping threads"},
     {"strace",     "QEMU_STRACE",      false, handle_arg_strace,
      "",           "log system calls"},
     {"seed",       "QEMU_RAND_SEED",   true,  handle_arg_seed,
@@ -536,6 +552,8 @@ static const struct qemu_argument arg_table[] = {
      "",           "Generate a /tmp/perf-${pid}.map file for perf"},
     {"jitdump",    "QEMU_JITDUMP",     false, handle_arg_jitdump,
      "",           "Generate a jit-${pid}.dump file for perf"},
+    {"tb-cache",   "QEMU_TB_CACHE",    true,  handle_arg_tb_cache,
+     "dir",        "reuse translated code across runs, cached in 'dir'"},
     {NULL, NULL, false, NULL, NULL, NULL}
 };
 
@@ -799,6 +817,19 @@ int main(int argc, char **argv, char **envp)
     }
     cpu_type = parse_cpu_option(cpu_model);
 
+    /*
+     * The persistent translation cache must be selected before TCG
+     * allocates its buffer.  Plugin instrumentation embeds pointers
+     * to plugin data that do not survive across runs.
+     */
+    if (tb_cache_dir) {
+        if (QTAILQ_EMPTY(&plugins)) {
+            tb_pcache_init(tb_cache_dir, execfd, cpu_type);
+        } else {
+            warn_report("-tb-cache is ignored when plugins are loaded");
+        }
+    }
+
     /* init tcg before creating CPUs */
     {
         AccelState *accel = current_accel();
@@ -807,6 +838,8 @@ int main(int argc, char **argv, char **envp)
         accel_init_interfaces(ac);
         object_property_set_bool(OBJECT(accel), "one-insn-per-tb",
                                  opt_one_insn_per_tb, &error_abort);
+        object_property_set_bool(OBJECT(accel), "atomic-locks",
+                                 opt_atomic_locks, &error_fatal);
         ac->init_machine(NULL);
     }
 
@@ -1018,6 +1051,7 @@ int main(int argc, char **argv, char **envp)
        generating the prologue until now so that the prologue can take
        the real value of GUEST_BASE into account.  */
     tcg_prologue_init();
+    tb_pcache_load();
 
     target_cpu_copy_regs(env, regs);
 
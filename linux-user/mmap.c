@@ -54,11 +54,97 @@ bool have_mmap_lock(void)
     return mmap_lock_count > 0 ? true : false;
 }
 
+/*
+ * Range locks let mapping changes of disjoint guest ranges proceed in
+ * parallel.  A range is locked before mmap_lock is taken, and covers
+ * whole host pages.  While it is held, the host system call can be
+ * made without mmap_lock, once the page flags of the range have been
+ * cleared: neither lookups nor translation use the range then, and no
+ * other mapping change can touch it.  Changes that may pick their
+ * address from the page flags lock the whole address space.
+ *
+ * Each request takes a ticket and is granted when no request with an
+ * earlier ticket overlaps it, so that small ranges cannot starve a
+ * lock of the whole address space.
+ */
+typedef struct MmapRange {
+    IntervalTreeNode itree;
+    uint64_t ticket;
+    bool locked;
+} MmapRange;
+
+static pthread_mutex_t mmap_range_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mmap_range_cond = PTHREAD_COND_INITIALIZER;
+/* Protected by mmap_range_mutex. */
+static IntervalTreeRoot mmap_ranges;
+static uint64_t mmap_range_ticket;
+
+static bool mmap_range_blocked(MmapRange *r)
+{
+    IntervalTreeNode *n;
+
+    for (n = interval_tree_iter_first(&mmap_ranges, r->itree.start,
+                                      r->itree.last);
+         n; n = interval_tree_iter_next(n, r->itree.start, r->itree.last)) {
+        if (container_of(n, MmapRange, itree)->ticket < r->ticket) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void mmap_range_lock(MmapRange *r, abi_ulong start, abi_ulong last)
+{
+    /*
+     * The range lock must not be waited for with mmap_lock held.  Only
+     * the image loaders change mappings with mmap_lock held, before
+     * any other thread exists, and they do not need the range lock.
+     */
+    r->locked = !have_mmap_lock();
+    if (!r->locked) {
+        return;
+    }
+
+    r->itree.start = start;
+    r->itree.last = last;
+    pthread_mutex_lock(&mmap_range_mutex);
+    r->ticket = mmap_range_ticket++;
+    interval_tree_insert(&r->itree, &mmap_ranges);
+    while (mmap_range_blocked(r)) {
+        pthread_cond_wait(&mmap_range_cond, &mmap_range_mutex);
+    }
+    pthread_mutex_unlock(&mmap_range_mutex);
+}
+
+static void mmap_range_unlock(MmapRange *r)
+{
+    if (r->locked) {
+        pthread_mutex_lock(&mmap_range_mutex);
+        interval_tree_remove(&r->itree, &mmap_ranges);
+        pthread_cond_broadcast(&mmap_range_cond);
+        pthread_mutex_unlock(&mmap_range_mutex);
+    }
+}
+
+/* Lock the host pages containing the guest range [@start, @last]. */
+static void mmap_range_lock_host(MmapRange *r, abi_ulong start,
+                                 abi_ulong last)
+{
+    int host_page_size = qemu_real_host_page_size();
+
+    mmap_range_lock(r, start & -host_page_size,
+                    ROUND_UP(last, host_page_size) - 1);
+}
+
+static MmapRange mmap_fork_range;
+
 /* Grab lock to make sure things are in a consistent state after fork().  */
 void mmap_fork_start(void)
 {
     if (mmap_lock_count)
         abort();
+    /* Wait for the system calls made without mmap_lock. */
+    mmap_range_lock(&mmap_fork_range, 0, -1);
     pthread_mutex_lock(&mmap_mutex);
 }
 
@@ -66,8 +152,12 @@ void mmap_fork_end(int child)
 {
     if (child) {
         pthread_mutex_init(&mmap_mutex, NULL);
+        pthread_mutex_init(&mmap_range_mutex, NULL);
+        pthread_cond_init(&mmap_range_cond, NULL);
+        mmap_ranges = (IntervalTreeRoot){ };
     } else {
         pthread_mutex_unlock(&mmap_mutex);
+        mmap_range_unlock(&mmap_fork_range);
     }
 }
 
@@ -172,6 +262,7 @@ int target_mprotect(abi_ulong start, abi_ulong len, int target_prot)
     int prots[3];
     abi_ulong host_start, host_last, last;
     int prot1, ret, page_flags, nranges;
+    MmapRange range;
 
     trace_target_mprotect(start, len, target_prot);
 
@@ -195,6 +286,12 @@ int target_mprotect(abi_ulong start, abi_ulong len, int target_prot)
     host_last = ROUND_UP(last, host_page_size) - 1;
     nranges = 0;
 
+    /*
+     * The host protection must change together with the page flags,
+     * which write protect pages with translated code, so mprotect is
+     * still made with mmap_lock held.
+     */
+    mmap_range_lock(&range, host_start, host_last);
     mmap_lock();
 
     if (host_last - host_start < host_page_size) {
@@ -265,6 +362,7 @@ int target_mprotect(abi_ulong start, abi_ulong len, int target_prot)
 
  error:
     mmap_unlock();
+    mmap_range_unlock(&range);
     return ret;
 }
 
@@ -600,7 +698,19 @@ static abi_long mmap_h_eq_g(abi_ulong start, abi_ulong len,
         want_p = g2h_untagged(start);
     }
 
-    p = mmap(want_p, len, host_prot, flags, fd, offset);
+    if (flags & MAP_FIXED) {
+        /*
+         * The caller holds the range lock: drop the old mapping from
+         * the page flags, and map without mmap_lock.  If the host mmap
+         * fails, the old mapping may be gone anyway.
+         */
+        page_set_flags(start, start + len - 1, 0);
+        mmap_unlock();
+        p = mmap(want_p, len, host_prot, flags, fd, offset);
+        mmap_lock();
+    } else {
+        p = mmap(want_p, len, host_prot, flags, fd, offset);
+    }
     if (p == MAP_FAILED) {
         return -1;
     }
@@ -953,6 +1063,7 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int target_prot,
 {
     abi_long ret;
     int page_flags;
+    MmapRange range = { };
 
     trace_target_mmap(start, len, target_prot, flags, fd, offset);
 
@@ -989,12 +1100,24 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int target_prot,
         }
     }
 
+    if (flags & (MAP_FIXED | MAP_FIXED_NOREPLACE)) {
+        mmap_range_lock_host(&range, start, start + len - 1);
+    } else if (reserved_va || qemu_real_host_page_size() != TARGET_PAGE_SIZE) {
+        /*
+         * The address is picked from the page flags, or the mapping is
+         * made in several steps: exclude all other mapping changes.
+         * Otherwise the host picks the address, which no range lock
+         * can cover while mmap_lock is held.
+         */
+        mmap_range_lock(&range, 0, -1);
+    }
     mmap_lock();
 
     ret = target_mmap__locked(start, len, target_prot, flags,
                               page_flags, fd, offset);
 
     mmap_unlock();
+    mmap_range_unlock(&range);
 
     /*
      * If we're mapping shared memory, ensure we generate code for parallel
@@ -1013,15 +1136,18 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int target_prot,
     return ret;
 }
 
-static int mmap_reserve_or_unmap(abi_ulong start, abi_ulong len)
+/*
+ * Return in *@preal_start and *@preal_len the host pages that only hold
+ * guest pages of [@start, @start + @len), or false if there are none.
+ */
+static bool mmap_unmap_range(abi_ulong start, abi_ulong len,
+                             abi_ulong *preal_start, abi_ulong *preal_len)
 {
     int host_page_size = qemu_real_host_page_size();
     abi_ulong real_start;
     abi_ulong real_last;
-    abi_ulong real_len;
     abi_ulong last;
     abi_ulong a;
-    void *host_start;
     int prot;
 
     last = start + len - 1;
@@ -1043,7 +1169,7 @@ static int mmap_reserve_or_unmap(abi_ulong start, abi_ulong len)
             prot |= page_get_flags(a + 1);
         }
         if (prot != 0) {
-            return 0;
+            return false;
         }
     } else {
         for (prot = 0, a = real_start; a < start; a += TARGET_PAGE_SIZE) {
@@ -1061,19 +1187,31 @@ static int mmap_reserve_or_unmap(abi_ulong start, abi_ulong len)
         }
 
         if (real_last < real_start) {
-            return 0;
+            return false;
         }
     }
 
-    real_len = real_last - real_start + 1;
-    host_start = g2h_untagged(real_start);
+    *preal_start = real_start;
+    *preal_len = real_last - real_start + 1;
+    return true;
+}
+
+static int mmap_reserve_or_unmap(abi_ulong start, abi_ulong len)
+{
+    abi_ulong real_start, real_len;
 
-    return do_munmap(host_start, real_len);
+    if (!mmap_unmap_range(start, len, &real_start, &real_len)) {
+        return 0;
+    }
+    return do_munmap(g2h_untagged(real_start), real_len);
 }
 
 int target_munmap(abi_ulong start, abi_ulong len)
 {
-    int ret;
+    abi_ulong real_start, real_len, last;
+    MmapRange range;
+    bool unmap;
+    int ret = 0;
 
     trace_target_munmap(start, len);
 
@@ -1087,14 +1225,25 @@ int target_munmap(abi_ulong start, abi_ulong len)
         return -1;
     }
 
+    last = start + len - 1;
+    mmap_range_lock_host(&range, start, last);
+
     mmap_lock();
-    ret = mmap_reserve_or_unmap(start, len);
-    if (likely(ret == 0)) {
-        page_set_flags(start, start + len - 1, 0);
-        shm_region_rm_complete(start, start + len - 1);
-    }
+    unmap = mmap_unmap_range(start, len, &real_start, &real_len);
+    page_set_flags(start, last, 0);
+    shm_region_rm_complete(start, last);
     mmap_unlock();
 
+    /*
+     * With the page flags gone and the range locked, nothing else uses
+     * the host pages.  munmap can only fail here for lack of memory, in
+     * which case the guest pages are left unmapped all the same.
+     */
+    if (unmap) {
+        ret = do_munmap(g2h_untagged(real_start), real_len);
+    }
+
+    mmap_range_unlock(&range);
     return ret;
 }
 
@@ -1104,6 +1253,7 @@ abi_long target_mremap(abi_ulong old_addr, abi_ulong old_size,
 {
     int prot;
     void *host_addr;
+    MmapRange range;
 
     if (!guest_range_valid_untagged(old_addr, old_size) ||
         ((flags & MREMAP_FIXED) &&
@@ -1114,6 +1264,7 @@ abi_long target_mremap(abi_ulong old_addr, abi_ulong old_size,
         return -1;
     }
 
+    mmap_range_lock(&range, 0, -1);
     mmap_lock();
 
     if (flags & MREMAP_FIXED) {
@@ -1188,6 +1339,7 @@ abi_long target_mremap(abi_ulong old_addr, abi_ulong old_size,
         shm_region_rm_complete(new_addr, new_addr + new_size - 1);
     }
     mmap_unlock();
+    mmap_range_unlock(&range);
     return new_addr;
 }
 
@@ -1287,8 +1439,8 @@ static inline abi_ulong target_shmlba(CPUArchState *cpu_env)
 #define HOST_FORCE_SHMLBA 0
 #endif
 
-abi_ulong target_shmat(CPUArchState *cpu_env, int shmid,
-                       abi_ulong shmaddr, int shmflg)
+static abi_ulong shmat_excl(CPUArchState *cpu_env, int shmid,
+                            abi_ulong shmaddr, int shmflg)
 {
     CPUState *cpu = env_cpu(cpu_env);
     struct shmid_ds shm_info;
@@ -1460,7 +1612,20 @@ abi_ulong target_shmat(CPUArchState *cpu_env, int shmid,
     return shmaddr;
 }
 
-abi_long target_shmdt(abi_ulong shmaddr)
+abi_ulong target_shmat(CPUArchState *cpu_env, int shmid,
+                       abi_ulong shmaddr, int shmflg)
+{
+    MmapRange range;
+    abi_ulong ret;
+
+    /* The address may be picked from the page flags. */
+    mmap_range_lock(&range, 0, -1);
+    ret = shmat_excl(cpu_env, shmid, shmaddr, shmflg);
+    mmap_range_unlock(&range);
+    return ret;
+}
+
+static abi_long shmdt_excl(abi_ulong shmaddr)
 {
     abi_long rv;
 
@@ -1483,3 +1648,15 @@ abi_long target_shmdt(abi_ulong shmaddr)
     }
     return rv;
 }
+
+abi_long target_shmdt(abi_ulong shmaddr)
+{
+    MmapRange range;
+    abi_long rv;
+
+    /* The size of the segment is only known with mmap_lock held. */
+    mmap_range_lock(&range, 0, -1);
+    rv = shmdt_excl(shmaddr);
+    mmap_range_unlock(&range);
+    return rv;
+}
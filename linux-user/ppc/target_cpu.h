@@ -56,4 +56,33 @@ static inline abi_ulong get_sp_from_cpustate(CPUPPCState *state)
 {
     return state->gpr[1];
 }
+
+/*
+ * For cpu_vdso_syscall(); the nip is still on the SC.  As in cpu_loop(),
+ * errors are returned as a positive errno with the overflow flag of
+ * cr0 set.
+ */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPUPPCState *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+    if (excp != POWERPC_EXCP_SYSCALL_USER) {
+        return -1;
+    }
+    *arg1 = env->gpr[3];
+    *arg2 = env->gpr[4];
+    return env->gpr[0];
+}
+
+static inline void cpu_vdso_syscall_return(CPUPPCState *env, abi_long ret)
+{
+    env->nip += 4;
+    env->crf[0] &= ~0x1;
+    if ((abi_ulong)ret > (abi_ulong)(-515)) {
+        env->crf[0] |= 0x1;
+        ret = -ret;
+    }
+    env->gpr[3] = ret;
+}
 #endif
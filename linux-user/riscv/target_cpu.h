@@ -24,4 +24,27 @@ static inline abi_ulong get_sp_from_cpustate(CPURISCVState *state)
 {
    return state->gpr[xSP];
 }
+
+/*
+ * For cpu_vdso_syscall(); the pc is still on the ECALL.  The vDSO
+ * always passes the syscall number in a7.
+ */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPURISCVState *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+    if (excp != RISCV_EXCP_U_ECALL) {
+        return -1;
+    }
+    *arg1 = env->gpr[xA0];
+    *arg2 = env->gpr[xA1];
+    return env->gpr[xA7];
+}
+
+static inline void cpu_vdso_syscall_return(CPURISCVState *env, abi_long ret)
+{
+    env->pc += 4;
+    env->gpr[xA0] = ret;
+}
 #endif
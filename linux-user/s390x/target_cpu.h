@@ -42,4 +42,24 @@ static inline abi_ulong get_sp_from_cpustate(CPUS390XState *state)
 {
    return state->regs[15];
 }
+
+/* For cpu_vdso_syscall(); the psw still points at the SVC. */
+#define TARGET_HAS_VDSO_SYSCALL
+
+static inline int cpu_vdso_syscall_nr(CPUS390XState *env, int excp,
+                                      abi_long *arg1, abi_long *arg2)
+{
+    if (excp != EXCP_SVC) {
+        return -1;
+    }
+    *arg1 = env->regs[2];
+    *arg2 = env->regs[3];
+    return env->int_svc_code ? env->int_svc_code : env->regs[1];
+}
+
+static inline void cpu_vdso_syscall_return(CPUS390XState *env, abi_long ret)
+{
+    env->psw.addr += env->int_svc_ilen;
+    env->regs[2] = ret;
+}
 #endif
@@ -13841,6 +13841,59 @@ static abi_long do_syscall1(CPUArchState *cpu_env, int num, abi_long arg1,
     return ret;
 }
 
+abi_ulong vdso_code_start, vdso_code_end;
+
+/*
+ * The vDSO time functions are plain system calls.  Answer them without
+ * returning to cpu_loop(), which saves the exit from and re-entry into
+ * cpu_exec() along with the pending signal and exclusive work checks;
+ * those are picked up at the next exit.  As with the kernel's vDSO,
+ * these calls are not seen by -strace, plugins or gdb catchpoints.
+ */
+bool cpu_vdso_syscall(CPUState *cpu)
+{
+#ifdef TARGET_HAS_VDSO_SYSCALL
+    CPUArchState *env = cpu_env(cpu);
+    vaddr pc = cpu->cc->get_pc(cpu);
+    abi_long arg1, arg2;
+    int num;
+
+    if (pc < vdso_code_start || pc >= vdso_code_end ||
+        cpu->singlestep_enabled) {
+        return false;
+    }
+
+    num = cpu_vdso_syscall_nr(env, cpu->exception_index, &arg1, &arg2);
+    switch (num) {
+#ifdef TARGET_NR_clock_gettime
+    case TARGET_NR_clock_gettime:
+#endif
+#ifdef TARGET_NR_clock_gettime64
+    case TARGET_NR_clock_gettime64:
+#endif
+#ifdef TARGET_NR_clock_getres
+    case TARGET_NR_clock_getres:
+#endif
+#ifdef TARGET_NR_clock_getres_time64
+    case TARGET_NR_clock_getres_time64:
+#endif
+#ifdef TARGET_NR_gettimeofday
+    case TARGET_NR_gettimeofday:
+#endif
+#ifdef TARGET_NR_time
+    case TARGET_NR_time:
+#endif
+        cpu_vdso_syscall_return(env, do_syscall1(env, num, arg1, arg2,
+                                                 0, 0, 0, 0, 0, 0));
+        return true;
+    default:
+        return false;
+    }
+#else
+    return false;
+#endif
+}
+
 abi_long do_syscall(CPUArchState *cpu_env, int num, abi_long arg1,
                     abi_long arg2, abi_long arg3, abi_long arg4,
                     abi_long arg5, abi_long arg6, abi_long arg7,
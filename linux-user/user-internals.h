@@ -29,6 +29,8 @@ void task_settid(TaskState *);
 void stop_all_tasks(void);
 extern const char *qemu_uname_release;
 extern unsigned long mmap_min_addr;
+/* Guest address range of the vDSO code, empty if there is no vDSO. */
+extern abi_ulong vdso_code_start, vdso_code_end;
 
 typedef struct IOCTLEntry IOCTLEntry;
 
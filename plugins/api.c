@@ -95,6 +95,42 @@ static bool tb_is_mem_only(void)
     return tb_cflags(tcg_ctx->gen_tb) & CF_MEMI_ONLY;
 }
 
+/*
+ * Check that the @n elements an indexed op may select, or the @n bits
+ * for QEMU_PLUGIN_INLINE_SET_BIT, fit in the scoreboard element.
+ */
+static void inline_op_check_index(enum qemu_plugin_op op,
+                                  qemu_plugin_u64 entry,
+                                  unsigned int shift, uint64_t n)
+{
+    size_t size = g_array_get_element_size(entry.score->data);
+    uint64_t words;
+
+    g_assert(is_power_of_2(n) && shift < 64);
+    words = op == QEMU_PLUGIN_INLINE_SET_BIT ? DIV_ROUND_UP(n, 64) : n;
+    g_assert(entry.offset <= size &&
+             words <= (size - entry.offset) / sizeof(uint64_t));
+}
+
+/*
+ * The address of a block or an instruction is known at translation
+ * time, so the element of an indexed op is selected right away.
+ */
+static void inline_op_index(enum qemu_plugin_op op, qemu_plugin_u64 *entry,
+                            uint64_t *imm, uint64_t vaddr,
+                            unsigned int shift, uint64_t n)
+{
+    uint64_t index;
+
+    inline_op_check_index(op, *entry, shift, n);
+    index = (vaddr >> shift) & (n - 1);
+    if (op == QEMU_PLUGIN_INLINE_SET_BIT) {
+        *imm = index;
+    } else {
+        entry->offset += index * sizeof(uint64_t);
+    }
+}
+
 void qemu_plugin_register_vcpu_tb_exec_cb(struct qemu_plugin_tb *tb,
                                           qemu_plugin_vcpu_udata_cb_t cb,
                                           enum qemu_plugin_cb_flags flags,
@@ -135,6 +171,18 @@ void qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
     }
 }
 
+void qemu_plugin_register_vcpu_tb_exec_inline_indexed_per_vcpu(
+    struct qemu_plugin_tb *tb,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    unsigned int shift,
+    uint64_t n,
+    uint64_t imm)
+{
+    inline_op_index(op, &entry, &imm, qemu_plugin_tb_vaddr(tb), shift, n);
+    qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(tb, op, entry, imm);
+}
+
 void qemu_plugin_register_vcpu_insn_exec_cb(struct qemu_plugin_insn *insn,
                                             qemu_plugin_vcpu_udata_cb_t cb,
                                             enum qemu_plugin_cb_flags flags,
@@ -176,6 +224,27 @@ void qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(
     }
 }
 
+void qemu_plugin_register_vcpu_insn_exec_inline_indexed_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    unsigned int shift,
+    uint64_t n,
+    uint64_t imm)
+{
+    inline_op_index(op, &entry, &imm, insn->vaddr, shift, n);
+    qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(insn, op, entry, imm);
+}
+
+void qemu_plugin_register_vcpu_insn_exec_trace(
+    struct qemu_plugin_insn *insn,
+    struct qemu_plugin_trace_buffer *buf,
+    uint32_t flags)
+{
+    if (!tb_is_mem_only()) {
+        plugin_register_trace_cb(&insn->insn_cbs, buf, insn->vaddr, 0, flags);
+    }
+}
 
 /*
  * We always plant memory instrumentation because they don't finalise until
@@ -200,6 +269,28 @@ void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
     plugin_register_inline_op_on_entry(&insn->mem_cbs, rw, op, entry, imm);
 }
 
+void qemu_plugin_register_vcpu_mem_inline_indexed_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_mem_rw rw,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    unsigned int shift,
+    uint64_t n,
+    uint64_t imm)
+{
+    inline_op_check_index(op, entry, shift, n);
+    plugin_register_inline_op_on_vaddr(&insn->mem_cbs, rw, op, entry,
+                                       shift, n, imm);
+}
+
+void qemu_plugin_register_vcpu_mem_trace(struct qemu_plugin_insn *insn,
+                                         enum qemu_plugin_mem_rw rw,
+                                         struct qemu_plugin_trace_buffer *buf,
+                                         uint32_t flags)
+{
+    plugin_register_trace_cb(&insn->mem_cbs, buf, insn->vaddr, rw, flags);
+}
+
 void qemu_plugin_register_vcpu_tb_trans_cb(qemu_plugin_id_t id,
                                            qemu_plugin_vcpu_tb_trans_cb_t cb)
 {
@@ -640,6 +731,24 @@ uint64_t qemu_plugin_u64_sum(qemu_plugin_u64 entry)
     return total;
 }
 
+struct qemu_plugin_trace_buffer *
+qemu_plugin_trace_buffer_new(size_t n_records,
+                             qemu_plugin_trace_drain_cb_t cb,
+                             void *userdata)
+{
+    return plugin_trace_buffer_new(n_records, cb, userdata);
+}
+
+void qemu_plugin_trace_buffer_flush(struct qemu_plugin_trace_buffer *buf)
+{
+    plugin_trace_buffer_flush(buf);
+}
+
+void qemu_plugin_trace_buffer_free(struct qemu_plugin_trace_buffer *buf)
+{
+    plugin_trace_buffer_free(buf);
+}
+
 /*
  * Time control
  */
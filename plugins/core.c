@@ -346,6 +346,12 @@ static enum plugin_dyn_cb_type op_to_cb_type(enum qemu_plugin_op op)
         return PLUGIN_CB_INLINE_ADD_U64;
     case QEMU_PLUGIN_INLINE_STORE_U64:
         return PLUGIN_CB_INLINE_STORE_U64;
+    case QEMU_PLUGIN_INLINE_MIN_U64:
+        return PLUGIN_CB_INLINE_MIN_U64;
+    case QEMU_PLUGIN_INLINE_MAX_U64:
+        return PLUGIN_CB_INLINE_MAX_U64;
+    case QEMU_PLUGIN_INLINE_SET_BIT:
+        return PLUGIN_CB_INLINE_SET_BIT;
     default:
         g_assert_not_reached();
     }
@@ -367,6 +373,27 @@ void plugin_register_inline_op_on_entry(GArray **arr,
     dyn_cb->inline_insn = inline_cb;
 }
 
+void plugin_register_inline_op_on_vaddr(GArray **arr,
+                                        enum qemu_plugin_mem_rw rw,
+                                        enum qemu_plugin_op op,
+                                        qemu_plugin_u64 entry,
+                                        unsigned int shift,
+                                        uint64_t n,
+                                        uint64_t imm)
+{
+    struct qemu_plugin_dyn_cb *dyn_cb;
+
+    struct qemu_plugin_inline_cb inline_cb = { .rw = rw,
+                                               .entry = entry,
+                                               .imm = imm,
+                                               .indexed = true,
+                                               .shift = shift,
+                                               .mask = n - 1 };
+    dyn_cb = plugin_get_dyn_cb(arr);
+    dyn_cb->type = op_to_cb_type(op);
+    dyn_cb->inline_insn = inline_cb;
+}
+
 void plugin_register_dyn_cb__udata(GArray **arr,
                                    qemu_plugin_vcpu_udata_cb_t cb,
                                    enum qemu_plugin_cb_flags flags,
@@ -465,6 +492,66 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
     dyn_cb->regular = regular_cb;
 }
 
+static struct qemu_plugin_trace_vcpu *
+plugin_trace_vcpu(struct qemu_plugin_trace_buffer *buf,
+                  unsigned int vcpu_index)
+{
+    char *base_ptr = buf->score->data->data;
+    return (struct qemu_plugin_trace_vcpu *)base_ptr + vcpu_index;
+}
+
+/*
+ * Hand the pending records of a vCPU to the plugin and start over. A
+ * vCPU that never used the buffer has no room left, so this is also
+ * where its records get allocated.
+ *
+ * Disable CFI checks.
+ * The callback function has been loaded from an external library so we do not
+ * have type information
+ */
+QEMU_DISABLE_CFI
+static void plugin_trace_drain(unsigned int vcpu_index, void *udata)
+{
+    struct qemu_plugin_trace_buffer *buf = udata;
+    struct qemu_plugin_trace_vcpu *v = plugin_trace_vcpu(buf, vcpu_index);
+
+    if (!v->records) {
+        v->records = g_new(qemu_plugin_trace_record, buf->n_records);
+    } else if (v->next != v->records) {
+        buf->drain(vcpu_index, v->records, v->next - v->records, buf->userp);
+    }
+    v->next = v->records;
+    v->left = buf->n_records;
+}
+
+void plugin_register_trace_cb(GArray **arr,
+                              struct qemu_plugin_trace_buffer *buf,
+                              uint64_t pc,
+                              enum qemu_plugin_mem_rw rw,
+                              uint32_t flags)
+{
+    static TCGHelperInfo info = {
+        .flags = TCG_CALL_NO_RWG,
+        /*
+         * Match plugin_trace_drain:
+         *   void (*)(uint32_t, void *)
+         */
+        .typemask = (dh_typemask(void, 0) |
+                     dh_typemask(i32, 1) |
+                     dh_typemask(ptr, 2))
+    };
+
+    struct qemu_plugin_dyn_cb *dyn_cb = plugin_get_dyn_cb(arr);
+    struct qemu_plugin_trace_cb trace_cb = { .buf = buf,
+                                             .drain = plugin_trace_drain,
+                                             .info = &info,
+                                             .pc = pc,
+                                             .flags = flags,
+                                             .rw = rw };
+    dyn_cb->type = PLUGIN_CB_TRACE;
+    dyn_cb->trace = trace_cb;
+}
+
 /*
  * Disable CFI checks.
  * The callback function has been loaded from an external library so we do not
@@ -581,26 +668,56 @@ void qemu_plugin_flush_cb(void)
 
 void exec_inline_op(enum plugin_dyn_cb_type type,
                     struct qemu_plugin_inline_cb *cb,
-                    int cpu_index)
+                    int cpu_index, uint64_t vaddr)
 {
     char *ptr = cb->entry.score->data->data;
     size_t elem_size = g_array_get_element_size(
         cb->entry.score->data);
     size_t offset = cb->entry.offset;
     uint64_t *val = (uint64_t *)(ptr + offset + cpu_index * elem_size);
+    uint64_t index = cb->indexed ? (vaddr >> cb->shift) & cb->mask : 0;
 
     switch (type) {
     case PLUGIN_CB_INLINE_ADD_U64:
-        *val += cb->imm;
+        val[index] += cb->imm;
         break;
     case PLUGIN_CB_INLINE_STORE_U64:
-        *val = cb->imm;
+        val[index] = cb->imm;
+        break;
+    case PLUGIN_CB_INLINE_MIN_U64:
+        val[index] = MIN(val[index], cb->imm);
+        break;
+    case PLUGIN_CB_INLINE_MAX_U64:
+        val[index] = MAX(val[index], cb->imm);
+        break;
+    case PLUGIN_CB_INLINE_SET_BIT:
+        index = cb->indexed ? index : cb->imm;
+        val[index / 64] |= 1ull << (index % 64);
         break;
     default:
         g_assert_not_reached();
     }
 }
 
+static void exec_trace_op(struct qemu_plugin_trace_cb *cb, int cpu_index,
+                          uint64_t vaddr, qemu_plugin_meminfo_t info)
+{
+    struct qemu_plugin_trace_vcpu *v = plugin_trace_vcpu(cb->buf, cpu_index);
+
+    /*
+     * Leave the room the generated code reserved for this instruction,
+     * so that its remaining inline appends still fit.
+     */
+    if (v->left <= PLUGIN_TRACE_INSN_MAX) {
+        plugin_trace_drain(cpu_index, cb->buf);
+    }
+    *v->next++ = (qemu_plugin_trace_record) { .pc = cb->pc,
+                                               .vaddr = vaddr,
+                                               .info = info,
+                                               .flags = cb->flags };
+    v->left--;
+}
+
 void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
                              uint64_t value_low,
                              uint64_t value_high,
@@ -630,8 +747,18 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
             break;
         case PLUGIN_CB_INLINE_ADD_U64:
         case PLUGIN_CB_INLINE_STORE_U64:
+        case PLUGIN_CB_INLINE_MIN_U64:
+        case PLUGIN_CB_INLINE_MAX_U64:
+        case PLUGIN_CB_INLINE_SET_BIT:
             if (rw & cb->inline_insn.rw) {
-                exec_inline_op(cb->type, &cb->inline_insn, cpu->cpu_index);
+                exec_inline_op(cb->type, &cb->inline_insn, cpu->cpu_index,
+                               vaddr);
+            }
+            break;
+        case PLUGIN_CB_TRACE:
+            if (rw & cb->trace.rw) {
+                exec_trace_op(&cb->trace, cpu->cpu_index, vaddr,
+                              make_plugin_meminfo(oi, rw));
             }
             break;
         default:
@@ -768,3 +895,42 @@ void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
     g_array_free(score->data, TRUE);
     g_free(score);
 }
+
+struct qemu_plugin_trace_buffer *
+plugin_trace_buffer_new(size_t n_records, qemu_plugin_trace_drain_cb_t cb,
+                        void *userdata)
+{
+    struct qemu_plugin_trace_buffer *buf =
+        g_new0(struct qemu_plugin_trace_buffer, 1);
+
+    /* keep room for a full instruction after each one from a helper */
+    buf->n_records = MAX(n_records, 2 * PLUGIN_TRACE_INSN_MAX);
+    buf->drain = cb;
+    buf->userp = userdata;
+    buf->score = plugin_scoreboard_new(sizeof(struct qemu_plugin_trace_vcpu));
+
+    return buf;
+}
+
+void plugin_trace_buffer_flush(struct qemu_plugin_trace_buffer *buf)
+{
+    qemu_rec_mutex_lock(&plugin.lock);
+    for (int i = 0; i < plugin.num_vcpus; i++) {
+        if (plugin_trace_vcpu(buf, i)->records) {
+            plugin_trace_drain(i, buf);
+        }
+    }
+    qemu_rec_mutex_unlock(&plugin.lock);
+}
+
+void plugin_trace_buffer_free(struct qemu_plugin_trace_buffer *buf)
+{
+    qemu_rec_mutex_lock(&plugin.lock);
+    for (int i = 0; i < buf->score->data->len; i++) {
+        g_free(plugin_trace_vcpu(buf, i)->records);
+    }
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    plugin_scoreboard_free(buf->score);
+    g_free(buf);
+}
@@ -74,6 +74,14 @@ void plugin_register_inline_op_on_entry(GArray **arr,
                                         qemu_plugin_u64 entry,
                                         uint64_t imm);
 
+void plugin_register_inline_op_on_vaddr(GArray **arr,
+                                        enum qemu_plugin_mem_rw rw,
+                                        enum qemu_plugin_op op,
+                                        qemu_plugin_u64 entry,
+                                        unsigned int shift,
+                                        uint64_t n,
+                                        uint64_t imm);
+
 void plugin_reset_uninstall(qemu_plugin_id_t id,
                             qemu_plugin_simple_cb_t cb,
                             bool reset);
@@ -110,7 +118,13 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
 
 void exec_inline_op(enum plugin_dyn_cb_type type,
                     struct qemu_plugin_inline_cb *cb,
-                    int cpu_index);
+                    int cpu_index, uint64_t vaddr);
+
+void plugin_register_trace_cb(GArray **arr,
+                              struct qemu_plugin_trace_buffer *buf,
+                              uint64_t pc,
+                              enum qemu_plugin_mem_rw rw,
+                              uint32_t flags);
 
 int plugin_num_vcpus(void);
 
@@ -118,4 +132,12 @@ struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size);
 
 void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score);
 
+struct qemu_plugin_trace_buffer *
+plugin_trace_buffer_new(size_t n_records, qemu_plugin_trace_drain_cb_t cb,
+                        void *userdata);
+
+void plugin_trace_buffer_flush(struct qemu_plugin_trace_buffer *buf);
+
+void plugin_trace_buffer_free(struct qemu_plugin_trace_buffer *buf);
+
 #endif /* PLUGIN_H */
@@ -185,8 +185,13 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                kernel-irqchip=on|off|split controls accelerated irqchip support (default=on)\n"
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
     "                one-insn-per-tb=on|off (one guest instruction per TCG translation block)\n"
+    "                return-stack=on|off (predict guest returns in TCG, default=off)\n"
+    "                atomic-locks=on|off (emulate wide atomics with locks, default=off)\n"
+    "                cold-code=on|off (separate TCG slow paths from hot code, default=off)\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                tb-workers=n (background TCG translation threads, default 0)\n"
+    "                tier2-threshold=n (retranslate TCG blocks executed n times, default 0)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                eager-split-size=n (KVM Eager Page Split chunk size, default 0, disabled. ARM only)\n"
     "                notify-vmexit=run|internal-error|disable,notify-window=n (enable notify VM exit and set notify window, x86 only)\n"
@@ -221,6 +226,35 @@ SRST
         can be useful in some situations, such as when trying to analyse
         the logs produced by the ``-d`` option.
 
+    ``return-stack=on|off``
+        Keeps a shadow stack of the return addresses of guest calls, so
+        that translated returns can jump directly to the block they are
+        predicted to return to, after checking the prediction, instead
+        of looking it up.  Only some targets (i386, aarch64) push to the
+        stack.  ``info jit`` reports how often the prediction was right.
+        The default is off.
+
+    ``atomic-locks=on|off``
+        When the host has no instruction for a 16-byte atomic operation
+        of the guest, the TCG accelerator normally executes it with all
+        other vCPUs stopped.  With this option, it takes one of a set of
+        locks chosen by address instead, so that only vCPUs accessing
+        the same locations serialize.  The operations are then atomic
+        only with respect to each other, and a concurrent 8-byte atomic
+        access to half of the same location may be lost.  ``info jit``
+        reports how many operations still stopped all vCPUs.  Hosts
+        with 16-byte atomic loads and stores but no 16-byte
+        compare-and-swap do not support this option.  The default is
+        off.
+
+    ``cold-code=on|off``
+        Places the slow paths of guest memory accesses in an area at
+        the end of each region of the TCG code buffer, instead of after
+        the code of each translation block.  This keeps the code that
+        runs most of the time densely packed in the host instruction
+        cache and TLB.  It is only supported with x86 hosts and is
+        ignored elsewhere.  The default is off.
+
     ``split-wx=on|off``
         Controls the use of split w^x mapping for the TCG code generation
         buffer. Some operating systems require this to be enabled, and in
@@ -230,6 +264,23 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``tb-workers=n``
+        Starts n threads that translate, ahead of time, the blocks that
+        newly translated code branches to directly within the same guest
+        page, so that vCPUs find them already translated. A vCPU that
+        needs a block a worker is busy with waits for it instead of
+        translating it again. n may not exceed the number of host CPUs.
+        Only used with ``thread=multi``; the default of 0 disables this.
+
+    ``tier2-threshold=n``
+        Makes the TCG accelerator retranslate a translation block once
+        it has been executed n times. The new translation continues
+        across forward unconditional direct branches where the target
+        supports it, so that more guest code is optimized as a unit.
+        The number of promoted blocks and the share of guest
+        instructions they executed is reported by ``info jit``. The
+        default of 0 disables this.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefore taking advantage of
@@ -4819,13 +4870,13 @@ SRST
 ERST
 
 DEF("icount", HAS_ARG, QEMU_OPTION_icount, \
-    "-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=<filename>[,rrsnapshot=<snapshot>]]\n" \
+    "-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=<filename>[,rrsnapshot=<snapshot>][,rrsnapshot-period=N]]\n" \
     "                enable virtual instruction counter with 2^N clock ticks per\n" \
     "                instruction, enable aligning the host and virtual clocks\n" \
     "                or disable real time cpu sleeping, and optionally enable\n" \
     "                record-and-replay mode\n", QEMU_ARCH_ALL)
 SRST
-``-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=filename[,rrsnapshot=snapshot]]``
+``-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=filename[,rrsnapshot=snapshot][,rrsnapshot-period=N]]``
     Enable virtual instruction counter. The virtual cpu will execute one
     instruction every 2^N ns of virtual time. If ``auto`` is specified
     then the virtual cpu speed will be automatically adjusted to keep
@@ -4867,6 +4918,9 @@ SRST
     name. In record mode, a new VM snapshot with the given name is created
     at the start of execution recording. In replay mode this option
     specifies the snapshot name used to load the initial VM state.
+    In replay mode, ``rrsnapshot-period=N`` creates a VM snapshot named
+    ``replay-<icount>`` every N instructions, to speed up seeking and
+    reverse debugging.
 ERST
 
 DEF("watchdog-action", HAS_ARG, QEMU_OPTION_watchdog_action, \
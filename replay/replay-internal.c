@@ -10,6 +10,9 @@
  */
 
 #include "qemu/osdep.h"
+#include <zlib.h>
+#include "qemu/bswap.h"
+#include "qemu/units.h"
 #include "sysemu/replay.h"
 #include "sysemu/runstate.h"
 #include "replay-internal.h"
@@ -30,6 +33,43 @@ static unsigned long mutex_head, mutex_tail;
 static bool write_error;
 FILE *replay_file;
 
+/*
+ * The event stream is stored in chunks that are compressed separately,
+ * so that any position in the stream can be reached by decompressing a
+ * single chunk.  A new chunk is started at an event, once the current
+ * one holds REPLAY_CHUNK_SIZE bytes.  Each chunk is stored as
+ *
+ *   uint64_t icount;       instruction count at its first event
+ *   uint32_t size;         size of its events
+ *   uint32_t zsize;        size of the zlib compressed events
+ *   uint8_t data[zsize];
+ *
+ * The chunks are followed by the index, a 32-bit count and for each
+ * chunk its icount, its offset in the event stream and its offset in
+ * the file.  The 64-bit field of the log header is the file offset of
+ * the index.  All fields are big-endian.
+ */
+#define HEADER_SIZE         (sizeof(uint32_t) + sizeof(uint64_t))
+#define CHUNK_HEADER_SIZE   (sizeof(uint64_t) + 2 * sizeof(uint32_t))
+#define INDEX_ENTRY_SIZE    (3 * sizeof(uint64_t))
+#define REPLAY_CHUNK_SIZE   (256 * KiB)
+
+typedef struct ReplayChunk {
+    uint64_t icount;
+    uint64_t offset;
+    uint64_t file_offset;
+} ReplayChunk;
+
+static GArray *chunks;
+/* Events of the chunk being written, or read */
+static GByteArray *chunk_data;
+/* Instruction count and stream offset at the start of chunk_data */
+static uint64_t chunk_icount;
+static uint64_t chunk_offset;
+/* Chunk being read, and read position in chunk_data */
+static unsigned chunk_index;
+static size_t chunk_pos;
+
 static void replay_write_error(void)
 {
     if (!write_error) {
@@ -44,18 +84,263 @@ static void replay_read_error(void)
     exit(1);
 }
 
+static void replay_write_raw(const void *buf, size_t size)
+{
+    if (fwrite(buf, 1, size, replay_file) != size) {
+        replay_write_error();
+    }
+}
+
+static void replay_read_raw(void *buf, size_t size)
+{
+    if (fread(buf, 1, size, replay_file) != size) {
+        replay_read_error();
+    }
+}
+
+static void replay_flush_chunk(void)
+{
+    ReplayChunk c = {
+        .icount = chunk_icount,
+        .offset = chunk_offset,
+    };
+    uint8_t header[CHUNK_HEADER_SIZE];
+    g_autofree uint8_t *zdata = NULL;
+    uLongf zsize;
+    long file_offset;
+
+    if (!chunk_data->len) {
+        return;
+    }
+
+    file_offset = ftell(replay_file);
+    zsize = compressBound(chunk_data->len);
+    zdata = g_malloc(zsize);
+    if (file_offset < 0 ||
+        compress2(zdata, &zsize, chunk_data->data, chunk_data->len,
+                  Z_BEST_SPEED) != Z_OK) {
+        replay_write_error();
+    } else {
+        c.file_offset = file_offset;
+        stq_be_p(header, c.icount);
+        stl_be_p(header + 8, chunk_data->len);
+        stl_be_p(header + 12, zsize);
+        replay_write_raw(header, sizeof(header));
+        replay_write_raw(zdata, zsize);
+    }
+
+    g_array_append_val(chunks, c);
+    chunk_offset += chunk_data->len;
+    g_byte_array_set_size(chunk_data, 0);
+}
+
+static void replay_load_chunk(unsigned index)
+{
+    ReplayChunk *c = &g_array_index(chunks, ReplayChunk, index);
+    uint8_t header[CHUNK_HEADER_SIZE];
+    g_autofree uint8_t *zdata = NULL;
+    uLongf size;
+    uint32_t zsize;
+
+    if (fseek(replay_file, c->file_offset, SEEK_SET)) {
+        replay_read_error();
+    }
+    replay_read_raw(header, sizeof(header));
+    size = ldl_be_p(header + 8);
+    zsize = ldl_be_p(header + 12);
+
+    zdata = g_malloc(zsize);
+    replay_read_raw(zdata, zsize);
+    g_byte_array_set_size(chunk_data, size);
+    if (uncompress(chunk_data->data, &size, zdata, zsize) != Z_OK ||
+        size != chunk_data->len) {
+        replay_read_error();
+    }
+
+    chunk_index = index;
+    chunk_icount = c->icount;
+    chunk_offset = c->offset;
+    chunk_pos = 0;
+}
+
+static void replay_read_stream(uint8_t *buf, size_t size)
+{
+    while (size) {
+        size_t n;
+
+        if (chunk_pos == chunk_data->len) {
+            if (chunk_index + 1 >= chunks->len) {
+                replay_read_error();
+            }
+            replay_load_chunk(chunk_index + 1);
+            continue;
+        }
+
+        n = MIN(size, chunk_data->len - chunk_pos);
+        memcpy(buf, chunk_data->data + chunk_pos, n);
+        chunk_pos += n;
+        buf += n;
+        size -= n;
+    }
+}
+
+void replay_log_start_write(void)
+{
+    chunks = g_array_new(false, false, sizeof(ReplayChunk));
+    chunk_data = g_byte_array_new();
+    chunk_offset = 0;
+
+    /* The header is written last */
+    if (fseek(replay_file, HEADER_SIZE, SEEK_SET)) {
+        replay_write_error();
+    }
+}
+
+void replay_log_finish_write(uint32_t version)
+{
+    uint8_t buf[INDEX_ENTRY_SIZE];
+    long index_offset;
+    unsigned i;
+
+    replay_flush_chunk();
+
+    index_offset = ftell(replay_file);
+    if (index_offset < 0) {
+        replay_write_error();
+        return;
+    }
+    stl_be_p(buf, chunks->len);
+    replay_write_raw(buf, sizeof(uint32_t));
+    for (i = 0; i < chunks->len; i++) {
+        ReplayChunk *c = &g_array_index(chunks, ReplayChunk, i);
+
+        stq_be_p(buf, c->icount);
+        stq_be_p(buf + 8, c->offset);
+        stq_be_p(buf + 16, c->file_offset);
+        replay_write_raw(buf, INDEX_ENTRY_SIZE);
+    }
+
+    if (fseek(replay_file, 0, SEEK_SET)) {
+        replay_write_error();
+        return;
+    }
+    stl_be_p(buf, version);
+    stq_be_p(buf + 4, index_offset);
+    replay_write_raw(buf, HEADER_SIZE);
+}
+
+bool replay_log_start_read(uint32_t version)
+{
+    uint8_t buf[INDEX_ENTRY_SIZE];
+    uint32_t i, n;
+
+    replay_read_raw(buf, HEADER_SIZE);
+    if (ldl_be_p(buf) != version) {
+        return false;
+    }
+
+    if (fseek(replay_file, ldq_be_p(buf + 4), SEEK_SET)) {
+        replay_read_error();
+    }
+    replay_read_raw(buf, sizeof(uint32_t));
+    n = ldl_be_p(buf);
+    chunks = g_array_sized_new(false, false, sizeof(ReplayChunk), n);
+    for (i = 0; i < n; i++) {
+        ReplayChunk c;
+
+        replay_read_raw(buf, INDEX_ENTRY_SIZE);
+        c.icount = ldq_be_p(buf);
+        c.offset = ldq_be_p(buf + 8);
+        c.file_offset = ldq_be_p(buf + 16);
+        g_array_append_val(chunks, c);
+    }
+
+    chunk_data = g_byte_array_new();
+    if (n) {
+        replay_load_chunk(0);
+    }
+    return true;
+}
+
+void replay_log_close(void)
+{
+    fclose(replay_file);
+    replay_file = NULL;
+
+    g_array_free(chunks, true);
+    chunks = NULL;
+    g_byte_array_free(chunk_data, true);
+    chunk_data = NULL;
+}
+
+uint64_t replay_log_tell(void)
+{
+    if (replay_mode == REPLAY_MODE_RECORD) {
+        return chunk_offset + chunk_data->len;
+    }
+    return chunk_offset + chunk_pos;
+}
+
+bool replay_log_seek(uint64_t offset, uint64_t icount)
+{
+    unsigned lo = 0, hi = chunks->len;
+
+    /* Find the last chunk that starts at or before @offset */
+    while (hi - lo > 1) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (g_array_index(chunks, ReplayChunk, mid).offset <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /*
+     * The events before @offset were recorded at or before @icount and
+     * the ones after it at or after @icount.  Otherwise the position was
+     * saved with another recording.
+     */
+    if (lo < chunks->len) {
+        ReplayChunk *c = &g_array_index(chunks, ReplayChunk, lo);
+
+        if (c->offset < offset ? c->icount > icount : c->icount < icount) {
+            return false;
+        }
+        if (lo + 1 < chunks->len &&
+            g_array_index(chunks, ReplayChunk, lo + 1).icount < icount) {
+            return false;
+        }
+    }
+
+    if (lo < chunks->len && lo != chunk_index) {
+        replay_load_chunk(lo);
+    }
+    if (offset - chunk_offset > chunk_data->len) {
+        replay_read_error();
+    }
+    chunk_pos = offset - chunk_offset;
+    return true;
+}
+
 void replay_put_byte(uint8_t byte)
 {
     if (replay_file) {
-        if (putc(byte, replay_file) == EOF) {
-            replay_write_error();
-        }
+        g_byte_array_append(chunk_data, &byte, 1);
     }
 }
 
 void replay_put_event(uint8_t event)
 {
     assert(event < EVENT_COUNT);
+    if (replay_file) {
+        if (chunk_data->len >= REPLAY_CHUNK_SIZE) {
+            replay_flush_chunk();
+        }
+        if (!chunk_data->len) {
+            chunk_icount = replay_state.current_icount;
+        }
+    }
     replay_put_byte(event);
 }
 
@@ -82,9 +367,7 @@ void replay_put_array(const uint8_t *buf, size_t size)
 {
     if (replay_file) {
         replay_put_dword(size);
-        if (fwrite(buf, 1, size, replay_file) != size) {
-            replay_write_error();
-        }
+        g_byte_array_append(chunk_data, buf, size);
     }
 }
 
@@ -92,11 +375,11 @@ uint8_t replay_get_byte(void)
 {
     uint8_t byte = 0;
     if (replay_file) {
-        int r = getc(replay_file);
-        if (r == EOF) {
-            replay_read_error();
+        if (chunk_pos < chunk_data->len) {
+            byte = chunk_data->data[chunk_pos++];
+        } else {
+            replay_read_stream(&byte, 1);
         }
-        byte = r;
     }
     return byte;
 }
@@ -138,9 +421,7 @@ void replay_get_array(uint8_t *buf, size_t *size)
 {
     if (replay_file) {
         *size = replay_get_dword();
-        if (fread(buf, 1, *size, replay_file) != *size) {
-            replay_read_error();
-        }
+        replay_read_stream(buf, *size);
     }
 }
 
@@ -149,9 +430,7 @@ void replay_get_array_alloc(uint8_t **buf, size_t *size)
     if (replay_file) {
         *size = replay_get_dword();
         *buf = g_malloc(*size);
-        if (fread(*buf, 1, *size, replay_file) != *size) {
-            replay_read_error();
-        }
+        replay_read_stream(*buf, *size);
     }
 }
 
@@ -82,7 +82,7 @@ enum ReplayEvents {
  * @current_event: current event index
  * @data_kind: current event
  * @has_unread_data: true if event not yet processed
- * @file_offset: offset into replay log at replay snapshot
+ * @file_offset: offset into the replay event stream at replay snapshot
  * @block_request_id: current serialised block request id
  * @read_event_id: current async read event id
  */
@@ -120,6 +120,21 @@ int64_t replay_get_qword(void);
 void replay_get_array(uint8_t *buf, size_t *size);
 void replay_get_array_alloc(uint8_t **buf, size_t *size);
 
+/* Log file functions */
+
+/*! Prepares the log file for writing the event stream. */
+void replay_log_start_write(void);
+/*! Writes the pending events, the chunk index and the header. */
+void replay_log_finish_write(uint32_t version);
+/*! Reads the log header and index, false if of another version. */
+bool replay_log_start_read(uint32_t version);
+/*! Closes the log file. */
+void replay_log_close(void);
+/*! Returns the current position in the event stream. */
+uint64_t replay_log_tell(void);
+/*! Moves to a replay_log_tell() position, false if @icount mismatches. */
+bool replay_log_seek(uint64_t offset, uint64_t icount);
+
 /* Mutex functions for protecting replay log file and ensuring
  * synchronisation between vCPU and main-loop threads. */
 
@@ -211,5 +226,7 @@ G_NORETURN void replay_sync_error(const char *error);
    Should be called before virtual devices initialization
    to make cached timers available for post_load functions. */
 void replay_vmstate_register(void);
+/*! Saves a VM snapshot every @period instructions while replaying. */
+void replay_vmstate_start_periodic(uint64_t period);
 
 #endif
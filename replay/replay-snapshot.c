@@ -16,13 +16,15 @@
 #include "monitor/monitor.h"
 #include "qapi/qmp/qstring.h"
 #include "qemu/error-report.h"
+#include "qemu/timer.h"
+#include "sysemu/runstate.h"
 #include "migration/vmstate.h"
 #include "migration/snapshot.h"
 
 static int replay_pre_save(void *opaque)
 {
     ReplayState *state = opaque;
-    state->file_offset = ftell(replay_file);
+    state->file_offset = replay_log_tell();
 
     return 0;
 }
@@ -31,7 +33,10 @@ static int replay_post_load(void *opaque, int version_id)
 {
     ReplayState *state = opaque;
     if (replay_mode == REPLAY_MODE_PLAY) {
-        fseek(replay_file, state->file_offset, SEEK_SET);
+        if (!replay_log_seek(state->file_offset, state->current_icount)) {
+            error_report("Snapshot does not match the replay log");
+            return -EINVAL;
+        }
         /* If this was a vmstate, saved in recording mode,
            we need to initialize replay data fields. */
         replay_fetch_data_kind();
@@ -92,6 +97,51 @@ void replay_vmstate_init(void)
     }
 }
 
+/*
+ * Periodic snapshots bound the replay that reverse debugging and
+ * replay_seek() need, to the instructions between two snapshots.  They
+ * are only taken the first time an instruction count is reached, and
+ * when no event is pending, so the poll period only needs to be short
+ * compared to the time it takes to execute @replay_snapshot_period
+ * instructions.
+ */
+#define REPLAY_SNAPSHOT_POLL_MS 100
+
+static QEMUTimer *replay_snapshot_timer;
+static uint64_t replay_snapshot_period;
+static uint64_t replay_snapshot_last;
+
+static void replay_snapshot_tick(void *opaque)
+{
+    uint64_t icount = replay_get_current_icount();
+
+    if (runstate_is_running()
+        && icount >= replay_snapshot_last + replay_snapshot_period
+        && replay_can_snapshot()) {
+        g_autofree char *name = g_strdup_printf("replay-%" PRIu64, icount);
+        Error *err = NULL;
+
+        if (!save_snapshot(name, true, NULL, false, NULL, &err)) {
+            error_report_err(err);
+            error_report("Could not create periodic snapshot, disabling");
+            return;
+        }
+        replay_snapshot_last = icount;
+    }
+
+    timer_mod(replay_snapshot_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + REPLAY_SNAPSHOT_POLL_MS);
+}
+
+void replay_vmstate_start_periodic(uint64_t period)
+{
+    replay_snapshot_period = period;
+    replay_snapshot_timer = timer_new_ms(QEMU_CLOCK_REALTIME,
+                                         replay_snapshot_tick, NULL);
+    timer_mod(replay_snapshot_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + REPLAY_SNAPSHOT_POLL_MS);
+}
+
 bool replay_can_snapshot(void)
 {
     return replay_mode == REPLAY_MODE_NONE
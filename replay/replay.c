@@ -22,12 +22,12 @@
 
 /* Current version of the replay mechanism.
    Increase it when file format changes. */
-#define REPLAY_VERSION              0xe0200c
-/* Size of replay log header */
-#define HEADER_SIZE                 (sizeof(uint32_t) + sizeof(uint64_t))
+#define REPLAY_VERSION              0xe0200d
 
 ReplayMode replay_mode = REPLAY_MODE_NONE;
 char *replay_snapshot;
+/* Instructions between automatic snapshots in replay mode, or 0 */
+static uint64_t replay_snapshot_period;
 
 /* Name of replay file  */
 static char *replay_filename;
@@ -373,15 +373,12 @@ static void replay_enable(const char *fname, int mode)
 
     /* skip file header for RECORD and check it for PLAY */
     if (replay_mode == REPLAY_MODE_RECORD) {
-        fseek(replay_file, HEADER_SIZE, SEEK_SET);
+        replay_log_start_write();
     } else if (replay_mode == REPLAY_MODE_PLAY) {
-        unsigned int version = replay_get_dword();
-        if (version != REPLAY_VERSION) {
+        if (!replay_log_start_read(REPLAY_VERSION)) {
             fprintf(stderr, "Replay: invalid input log file version\n");
             exit(1);
         }
-        /* go to the beginning */
-        fseek(replay_file, HEADER_SIZE, SEEK_SET);
         replay_fetch_data_kind();
     }
 
@@ -424,6 +421,7 @@ void replay_configure(QemuOpts *opts)
     }
 
     replay_snapshot = g_strdup(qemu_opt_get(opts, "rrsnapshot"));
+    replay_snapshot_period = qemu_opt_get_number(opts, "rrsnapshot-period", 0);
     replay_vmstate_register();
     replay_enable(fname, mode);
 
@@ -446,7 +444,9 @@ void replay_start(void)
         exit(1);
     }
 
-    /* Timer for snapshotting will be set up here. */
+    if (replay_mode == REPLAY_MODE_PLAY && replay_snapshot_period) {
+        replay_vmstate_start_periodic(replay_snapshot_period);
+    }
 
     replay_enable_events();
 }
@@ -470,13 +470,11 @@ void replay_finish(void)
             /* write end event */
             replay_put_event(EVENT_END);
 
-            /* write header */
-            fseek(replay_file, 0, SEEK_SET);
-            replay_put_dword(REPLAY_VERSION);
+            /* write index and header */
+            replay_log_finish_write(REPLAY_VERSION);
         }
 
-        fclose(replay_file);
-        replay_file = NULL;
+        replay_log_close();
     }
     g_free(replay_filename);
     replay_filename = NULL;
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+
+#  Measure the execution speed of a user-mode guest, in millions of
+#  guest instructions per second.
+#
+#  Syntax:
+#  guest-mips.py [-h] [-p <libinsn.so>] [-r <runs>] -- \
+#                <qemu executable> [<qemu executable options>] \
+#                <target executable> [<target executable options>]
+#
+#  [-h] - Print the script arguments help message.
+#  [-p] - Path to the insn plugin, from tests/tcg/plugins.
+#         Default: tests/tcg/plugins/libinsn.so in the current directory.
+#  [-r] - Number of timed runs; the fastest one is reported.  Default: 3.
+#
+#  The instruction count comes from a first run with the insn plugin,
+#  the time from runs without it, so that instrumentation does not
+#  skew the result.  This is mostly useful to compare the TCG
+#  interpreter (--enable-tcg-interpreter) with a native backend.
+#
+#  Example of usage:
+#  guest-mips.py -- qemu-aarch64 tests/tcg/aarch64-linux-user/sha512
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def count_insns(qemu, plugin, rest):
+    """
+    Run the guest once under the insn plugin and return the total
+    number of guest instructions it executed.
+    """
+    with tempfile.TemporaryDirectory() as tmpdirname:
+        log_path = os.path.join(tmpdirname, "insn.log")
+        run = subprocess.run([qemu,
+                              "-plugin", plugin + ",inline=on",
+                              "-d", "plugin", "-D", log_path] + rest,
+                             stdout=subprocess.DEVNULL,
+                             stderr=subprocess.PIPE)
+        if run.returncode:
+            sys.exit(run.stderr.decode("utf-8"))
+        with open(log_path, "r") as log:
+            match = re.search(r"total insns: (\d+)", log.read())
+    if not match:
+        sys.exit("Couldn't find the instruction count ... Exiting.")
+    return int(match.group(1))
+
+
+def time_run(command):
+    """
+    Run the guest without instrumentation and return the elapsed time.
+    """
+    start = time.perf_counter()
+    run = subprocess.run(command,
+                         stdout=subprocess.DEVNULL,
+                         stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if run.returncode:
+        sys.exit(run.stderr.decode("utf-8"))
+    return elapsed
+
+
+def main():
+    # Parse the command line arguments
+    parser = argparse.ArgumentParser(
+        usage='guest-mips.py [-h] [-p <libinsn.so>] [-r <runs>] -- '
+        '<qemu executable> [<qemu executable options>] '
+        '<target executable> [<target executable options>]')
+
+    parser.add_argument('-p', dest='plugin', type=str,
+                        default="tests/tcg/plugins/libinsn.so",
+                        help='Path to the insn plugin')
+    parser.add_argument('-r', dest='runs', type=int, default=3,
+                        help='Number of timed runs')
+    parser.add_argument('command', type=str, nargs='+', help=argparse.SUPPRESS)
+
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.plugin):
+        sys.exit("Couldn't find the insn plugin at " + args.plugin)
+
+    insns = count_insns(args.command[0], args.plugin, args.command[1:])
+    elapsed = min(time_run(args.command) for _ in range(max(args.runs, 1)))
+
+    print("Guest instructions:  {:,}".format(insns))
+    print("Time (s):            {:.3f}".format(elapsed))
+    print("Guest MIPS:          {:.1f}".format(insns / elapsed / 1e6))
+
+
+if __name__ == "__main__":
+    main()
@@ -19,9 +19,11 @@
 # License along with this library; if not, see <http://www.gnu.org/licenses/>.
 
 import argparse
+import io
 import struct
 import os
 import sys
+import zlib
 from collections import namedtuple
 from os import path
 
@@ -407,14 +409,28 @@ def decode_file(filename):
     "Decode a record/replay dump"
     dumpfile = open(filename, "rb")
     dumpsize = path.getsize(filename)
-    # read and throwaway the header
+    # read the header
     version = read_dword(dumpfile)
-    junk = read_qword(dumpfile)
+    index_offset = read_qword(dumpfile)
 
     # see REPLAY_VERSION
     print("HEADER: version 0x%x" % (version))
 
-    if version == 0xe0200c:
+    if version == 0xe0200d:
+        # the events are stored in compressed chunks, up to the index
+        events = bytearray()
+        while dumpfile.tell() < index_offset:
+            icount = read_qword(dumpfile)
+            size = read_dword(dumpfile)
+            zsize = read_dword(dumpfile)
+            print("CHUNK: icount %d, %d bytes (%d compressed)" %
+                  (icount, size, zsize))
+            events += zlib.decompress(dumpfile.read(zsize))
+        dumpfile.close()
+        dumpfile = io.BytesIO(events)
+        dumpsize = len(events)
+
+    if version == 0xe0200c or version == 0xe0200d:
         event_decode_table = v12_event_table
         replay_state.checkpoint_start = 30
     elif version == 0xe02007:
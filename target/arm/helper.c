@@ -17,6 +17,7 @@
 #include "qemu/timer.h"
 #include "qemu/bitops.h"
 #include "qemu/crc32c.h"
+#include "crypto/crc32.h"
 #include "qemu/qemu-print.h"
 #include "exec/exec-all.h"
 #include <zlib.h> /* for crc32 */
@@ -12424,6 +12425,10 @@ uint32_t HELPER(crc32)(uint32_t acc, uint32_t val, uint32_t bytes)
 {
     uint8_t buf[4];
 
+    if (HAVE_CRC32_ACCEL) {
+        return crc32_accel(acc, val, bytes);
+    }
+
     stl_le_p(buf, val);
 
     /* zlib crc32 converts the accumulator and output to one's complement.  */
@@ -12434,6 +12439,10 @@ uint32_t HELPER(crc32c)(uint32_t acc, uint32_t val, uint32_t bytes)
 {
     uint8_t buf[4];
 
+    if (HAVE_CRC32C_ACCEL) {
+        return crc32c_accel(acc, val, bytes);
+    }
+
     stl_le_p(buf, val);
 
     /* Linux crc32c converts the output to one's complement.  */
@@ -1700,8 +1700,9 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
     int32_t level;
     ARMVAParameters param;
     uint64_t ttbr;
-    hwaddr descaddr, indexmask, indexmask_grainsize;
+    hwaddr descaddr, indexmask, indexmask_grainsize, tableaddr;
     uint32_t tableattrs;
+    bool tablehit;
     target_ulong page_size;
     uint64_t attrs;
     int32_t stride;
@@ -1900,12 +1901,25 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
         ptw->in_space = ARMSS_NonSecure;
     }
 
-    if (!S1_ptw_translate(env, ptw, descaddr, fi)) {
-        goto do_fault;
-    }
-    descriptor = arm_ldq_ptw(env, ptw, fi);
-    if (fi->type != ARMFault_None) {
-        goto do_fault;
+    /*
+     * Table descriptors seen by earlier walks are cached.  Debug
+     * accesses must not change the state of the cpu, and leave the
+     * cache alone.  A leaf must always be loaded, as S1_ptw_translate
+     * sets up the access used by FEAT_HAFDBS to update it.
+     */
+    tableaddr = descaddr;
+    tablehit = likely(!ptw->in_debug) && level < 3 &&
+        tlb_walk_cache_lookup(env_cpu(env),
+                              arm_to_core_mmu_idx(ptw->in_ptw_idx),
+                              tableaddr, &descriptor);
+    if (!tablehit) {
+        if (!S1_ptw_translate(env, ptw, descaddr, fi)) {
+            goto do_fault;
+        }
+        descriptor = arm_ldq_ptw(env, ptw, fi);
+        if (fi->type != ARMFault_None) {
+            goto do_fault;
+        }
     }
     new_descriptor = descriptor;
 
@@ -1944,6 +1958,12 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
          * we can gather them up by ORing in the bits at each level).
          */
         tableattrs |= extract64(descriptor, 59, 5);
+        if (!tablehit && likely(!ptw->in_debug) && ptw->out_host) {
+            tlb_walk_cache_insert(env_cpu(env),
+                                  arm_to_core_mmu_idx(ptw->in_ptw_idx),
+                                  tableaddr, descriptor, ptw->out_host,
+                                  MO_64 | (ptw->out_be ? MO_BE : MO_LE));
+        }
         level++;
         indexmask = indexmask_grainsize;
         goto next_level;
@@ -2168,6 +2188,9 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
 
     /* If FEAT_HAFDBS has made changes, update the PTE. */
     if (new_descriptor != descriptor) {
+        tlb_walk_cache_discard(env_cpu(env),
+                               arm_to_core_mmu_idx(ptw->in_ptw_idx),
+                               ptw->out_virt);
         new_descriptor = arm_casq_ptw(env, descriptor, new_descriptor, ptw, fi);
         if (fi->type != ARMFault_None) {
             goto do_fault;
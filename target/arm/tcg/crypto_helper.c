@@ -15,6 +15,7 @@
 #include "exec/helper-proto.h"
 #include "tcg/tcg-gvec-desc.h"
 #include "crypto/aes-round.h"
+#include "crypto/sha-round.h"
 #include "crypto/sm4.h"
 #include "vec_internal.h"
 
@@ -304,6 +305,18 @@ void HELPER(crypto_sha256h)(void *vd, void *vn, void *vm, uint32_t desc)
     union CRYPTO_STATE m = { .l = { rm[0], rm[1] } };
     int i;
 
+    if (HAVE_SHA256_ACCEL) {
+        SHAState x = { .d = { rd[0], rd[1] } };
+        SHAState y = { .d = { rn[0], rn[1] } };
+        SHAState wk = { .d = { rm[0], rm[1] } };
+
+        sha256_rnds4_accel(&x, &y, &wk);
+        rd[0] = x.d[0];
+        rd[1] = x.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         uint32_t t = cho(CR_ST_WORD(n, 0), CR_ST_WORD(n, 1), CR_ST_WORD(n, 2))
                      + CR_ST_WORD(n, 3) + S1(CR_ST_WORD(n, 0))
@@ -339,6 +352,18 @@ void HELPER(crypto_sha256h2)(void *vd, void *vn, void *vm, uint32_t desc)
     union CRYPTO_STATE m = { .l = { rm[0], rm[1] } };
     int i;
 
+    if (HAVE_SHA256_ACCEL) {
+        SHAState x = { .d = { rn[0], rn[1] } };
+        SHAState y = { .d = { rd[0], rd[1] } };
+        SHAState wk = { .d = { rm[0], rm[1] } };
+
+        sha256_rnds4_accel(&x, &y, &wk);
+        rd[0] = y.d[0];
+        rd[1] = y.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         uint32_t t = cho(CR_ST_WORD(d, 0), CR_ST_WORD(d, 1), CR_ST_WORD(d, 2))
                      + CR_ST_WORD(d, 3) + S1(CR_ST_WORD(d, 0))
@@ -363,6 +388,17 @@ void HELPER(crypto_sha256su0)(void *vd, void *vm, uint32_t desc)
     union CRYPTO_STATE d = { .l = { rd[0], rd[1] } };
     union CRYPTO_STATE m = { .l = { rm[0], rm[1] } };
 
+    if (HAVE_SHA256_ACCEL) {
+        SHAState x = { .d = { rd[0], rd[1] } };
+        SHAState y = { .d = { rm[0], rm[1] } };
+
+        sha256_msg1_accel(&x, &x, &y);
+        rd[0] = x.d[0];
+        rd[1] = x.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     CR_ST_WORD(d, 0) += s0(CR_ST_WORD(d, 1));
     CR_ST_WORD(d, 1) += s0(CR_ST_WORD(d, 2));
     CR_ST_WORD(d, 2) += s0(CR_ST_WORD(d, 3));
@@ -436,6 +472,18 @@ void HELPER(crypto_sha512h)(void *vd, void *vn, void *vm, uint32_t desc)
     uint64_t d0 = rd[0];
     uint64_t d1 = rd[1];
 
+    if (HAVE_SHA512_ACCEL) {
+        SHAState d = { .d = { rd[0], rd[1] } };
+        SHAState n = { .d = { rn[0], rn[1] } };
+        SHAState m = { .d = { rm[0], rm[1] } };
+
+        sha512h_accel(&d, &d, &n, &m);
+        rd[0] = d.d[0];
+        rd[1] = d.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     d1 += S1_512(rm[1]) + cho512(rm[1], rn[0], rn[1]);
     d0 += S1_512(d1 + rm[0]) + cho512(d1 + rm[0], rm[1], rn[0]);
 
@@ -453,6 +501,18 @@ void HELPER(crypto_sha512h2)(void *vd, void *vn, void *vm, uint32_t desc)
     uint64_t d0 = rd[0];
     uint64_t d1 = rd[1];
 
+    if (HAVE_SHA512_ACCEL) {
+        SHAState d = { .d = { rd[0], rd[1] } };
+        SHAState n = { .d = { rn[0], rn[1] } };
+        SHAState m = { .d = { rm[0], rm[1] } };
+
+        sha512h2_accel(&d, &d, &n, &m);
+        rd[0] = d.d[0];
+        rd[1] = d.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     d1 += S0_512(rm[0]) + maj512(rn[0], rm[1], rm[0]);
     d0 += S0_512(d1) + maj512(d1, rm[0], rm[1]);
 
@@ -469,6 +529,17 @@ void HELPER(crypto_sha512su0)(void *vd, void *vn, uint32_t desc)
     uint64_t d0 = rd[0];
     uint64_t d1 = rd[1];
 
+    if (HAVE_SHA512_ACCEL) {
+        SHAState d = { .d = { rd[0], rd[1] } };
+        SHAState n = { .d = { rn[0], rn[1] } };
+
+        sha512su0_accel(&d, &d, &n);
+        rd[0] = d.d[0];
+        rd[1] = d.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     d0 += s0_512(rd[1]);
     d1 += s0_512(rn[0]);
 
@@ -484,6 +555,18 @@ void HELPER(crypto_sha512su1)(void *vd, void *vn, void *vm, uint32_t desc)
     uint64_t *rn = vn;
     uint64_t *rm = vm;
 
+    if (HAVE_SHA512_ACCEL) {
+        SHAState d = { .d = { rd[0], rd[1] } };
+        SHAState n = { .d = { rn[0], rn[1] } };
+        SHAState m = { .d = { rm[0], rm[1] } };
+
+        sha512su1_accel(&d, &d, &n, &m);
+        rd[0] = d.d[0];
+        rd[1] = d.d[1];
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     rd[0] += s1_512(rn[0]) + rm[0];
     rd[1] += s1_512(rn[1]) + rm[1];
 
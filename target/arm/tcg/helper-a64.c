@@ -28,6 +28,7 @@
 #include "qemu/bitops.h"
 #include "internals.h"
 #include "qemu/crc32c.h"
+#include "crypto/crc32.h"
 #include "exec/exec-all.h"
 #include "exec/cpu_ldst.h"
 #include "qemu/int128.h"
@@ -501,6 +502,10 @@ uint64_t HELPER(crc32_64)(uint64_t acc, uint64_t val, uint32_t bytes)
 {
     uint8_t buf[8];
 
+    if (HAVE_CRC32_ACCEL) {
+        return crc32_accel(acc, val, bytes);
+    }
+
     stq_le_p(buf, val);
 
     /* zlib crc32 converts the accumulator and output to one's complement.  */
@@ -511,6 +516,10 @@ uint64_t HELPER(crc32c_64)(uint64_t acc, uint64_t val, uint32_t bytes)
 {
     uint8_t buf[8];
 
+    if (HAVE_CRC32C_ACCEL) {
+        return crc32c_accel(acc, val, bytes);
+    }
+
     stq_le_p(buf, val);
 
     /* Linux crc32c converts the output to one's complement.  */
@@ -489,9 +489,22 @@ static inline bool use_goto_tb(DisasContext *s, uint64_t dest)
     return translator_use_goto_tb(&s->base, dest);
 }
 
+static inline bool use_goto_tb_xpage(DisasContext *s, uint64_t dest)
+{
+    if (s->ss_active) {
+        return false;
+    }
+    return translator_use_goto_tb_xpage(&s->base, dest);
+}
+
 static void gen_goto_tb(DisasContext *s, int n, int64_t diff)
 {
-    if (use_goto_tb(s, s->pc_curr + diff)) {
+    uint64_t dest = s->pc_curr + diff;
+    bool direct = use_goto_tb(s, dest);
+    bool xpage = !direct && use_goto_tb_xpage(s, dest);
+    TCGLabel *miss = NULL;
+
+    if (direct || xpage) {
         /*
          * For pcrel, the pc must always be up-to-date on entry to
          * the linked TB, so that it can use simple additions for all
@@ -502,12 +515,31 @@ static void gen_goto_tb(DisasContext *s, int n, int64_t diff)
          */
         if (tb_cflags(s->base.tb) & CF_PCREL) {
             gen_a64_update_pc(s, diff);
-            tcg_gen_goto_tb(n);
+            if (xpage) {
+                miss = translator_goto_tb_xpage(&s->base, n, dest, cpu_pc);
+            } else {
+                tcg_gen_goto_tb(n);
+            }
+            tcg_gen_exit_tb(s->base.tb, n);
+            if (miss) {
+                gen_set_label(miss);
+                tcg_gen_lookup_and_goto_ptr();
+            }
         } else {
-            tcg_gen_goto_tb(n);
+            if (xpage) {
+                miss = translator_goto_tb_xpage(&s->base, n, dest, NULL);
+            } else {
+                tcg_gen_goto_tb(n);
+            }
             gen_a64_update_pc(s, diff);
+            tcg_gen_exit_tb(s->base.tb, n);
+            if (miss) {
+                /* Not linkable, see translator_goto_tb_xpage(). */
+                gen_set_label(miss);
+                gen_a64_update_pc(s, diff);
+                tcg_gen_lookup_and_goto_ptr();
+            }
         }
-        tcg_gen_exit_tb(s->base.tb, n);
         s->base.is_jmp = DISAS_NORETURN;
     } else {
         gen_a64_update_pc(s, diff);
@@ -1448,7 +1480,16 @@ static inline AArch64DecodeFn *lookup_disas_fn(const AArch64DecodeTable *table,
 
 static bool trans_B(DisasContext *s, arg_i *a)
 {
+    uint64_t dest = s->pc_curr + a->imm;
+
     reset_btype(s);
+    if (!s->ss_active && translator_follow_jump(&s->base, dest)) {
+        /* Keep to the bound on insns computed in init_disas_context. */
+        s->base.pc_next = dest;
+        s->base.max_insns = MIN(s->base.max_insns, s->base.num_insns +
+                                -(dest | TARGET_PAGE_MASK) / 4);
+        return true;
+    }
     gen_goto_tb(s, 0, a->imm);
     return true;
 }
@@ -1456,6 +1497,7 @@ static bool trans_B(DisasContext *s, arg_i *a)
 static bool trans_BL(DisasContext *s, arg_i *a)
 {
     gen_pc_plus_diff(s, cpu_reg(s, 30), curr_insn_len(s));
+    translator_ras_push(&s->base, cpu_reg(s, 30));
     reset_btype(s);
     gen_goto_tb(s, 0, a->imm);
     return true;
@@ -1560,6 +1602,7 @@ static bool trans_BLR(DisasContext *s, arg_r *a)
         dst = tmp;
     }
     gen_pc_plus_diff(s, lr, curr_insn_len(s));
+    translator_ras_push(&s->base, lr);
     gen_a64_set_pc(s, dst);
     set_btype_for_blr(s);
     s->base.is_jmp = DISAS_JUMP;
@@ -1569,6 +1612,11 @@ static bool trans_BLR(DisasContext *s, arg_r *a)
 static bool trans_RET(DisasContext *s, arg_r *a)
 {
     gen_a64_set_pc(s, cpu_reg(s, a->rn));
+    /*
+     * RET leaves PSTATE.BTYPE at 0, so the next TB has the flags of
+     * this one if it started with BTYPE 0 as well.
+     */
+    s->ras_ret = EX_TBFLAG_A64(arm_tbflags_from_tb(s->base.tb), BTYPE) == 0;
     s->base.is_jmp = DISAS_JUMP;
     return true;
 }
@@ -11919,7 +11967,11 @@ static void aarch64_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
             gen_a64_update_pc(dc, 4);
             /* fall through */
         case DISAS_JUMP:
-            tcg_gen_lookup_and_goto_ptr();
+            if (dc->ras_ret) {
+                translator_ras_return(&dc->base, cpu_pc);
+            } else {
+                tcg_gen_lookup_and_goto_ptr();
+            }
             break;
         case DISAS_NORETURN:
         case DISAS_SWI:
@@ -110,6 +110,11 @@ typedef struct DisasContext {
      * ie A64 LDX*, LDAX*, A32/T32 LDREX*, LDAEX*.
      */
     bool is_ldex;
+    /*
+     * True if the insn just emitted was a return that may use the
+     * return-address stack, see translator_ras_return().
+     */
+    bool ras_ret;
     /* True if AccType_UNPRIV should be used for LDTR et al */
     bool unpriv;
     /* True if v8.3-PAuth is active.  */
@@ -21,6 +21,8 @@
 #include "crypto/aes.h"
 #include "crypto/aes-round.h"
 #include "crypto/clmul.h"
+#include "crypto/crc32.h"
+#include "crypto/sha-round.h"
 
 #if SHIFT == 0
 #define Reg MMXReg
@@ -2117,8 +2119,14 @@ void glue(helper_pcmpistrm, SUFFIX)(CPUX86State *env, Reg *d, Reg *s,
 #define CRCPOLY_BITREV 0x82f63b78
 target_ulong helper_crc32(uint32_t crc1, target_ulong msg, uint32_t len)
 {
-    target_ulong crc = (msg & ((target_ulong) -1 >>
-                               (TARGET_LONG_BITS - len))) ^ crc1;
+    target_ulong crc;
+
+    /* The instruction implements CRC-32C, without inversion. */
+    if (HAVE_CRC32C_ACCEL) {
+        return crc32c_accel(crc1, msg, len / 8);
+    }
+
+    crc = (msg & ((target_ulong) -1 >> (TARGET_LONG_BITS - len))) ^ crc1;
 
     while (len--) {
         crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_BITREV : 0);
@@ -2607,6 +2615,16 @@ void helper_sha1msg2(Reg *d, Reg *a, Reg *b)
 #define SHA256_MSGS0(w) (ror32((w), 7) ^ ror32((w), 18) ^ ((w) >> 3))
 #define SHA256_MSGS1(w) (ror32((w), 17) ^ ror32((w), 19) ^ ((w) >> 10))
 
+#define SHA_STATE(r)    { .w = { (r)->L(0), (r)->L(1), (r)->L(2), (r)->L(3) } }
+
+static inline void sha_state_to_reg(Reg *d, const SHAState *s)
+{
+    d->L(0) = s->w[0];
+    d->L(1) = s->w[1];
+    d->L(2) = s->w[2];
+    d->L(3) = s->w[3];
+}
+
 void helper_sha256rnds2(Reg *d, Reg *a, Reg *b, uint32_t wk0, uint32_t wk1)
 {
     uint32_t t, AA, EE;
@@ -2620,6 +2638,14 @@ void helper_sha256rnds2(Reg *d, Reg *a, Reg *b, uint32_t wk0, uint32_t wk1)
     uint32_t G = a->L(1);
     uint32_t H = a->L(0);
 
+    if (HAVE_SHA256_RNDS2_ACCEL) {
+        SHAState cdgh = SHA_STATE(a), abef = SHA_STATE(b), r;
+
+        sha256_rnds2_accel(&r, &cdgh, &abef, wk0, wk1);
+        sha_state_to_reg(d, &r);
+        return;
+    }
+
     /* Even round */
     t = SHA256_CH(E, F, G) + SHA256_RNDS1(E) + wk0 + H;
     AA = t + SHA256_MAJ(A, B, C) + SHA256_RNDS0(A);
@@ -2646,6 +2672,14 @@ void helper_sha256msg1(Reg *d, Reg *a, Reg *b)
     /* b->L(0) could be overwritten by the first assignment, save it.  */
     uint32_t b0 = b->L(0);
 
+    if (HAVE_SHA256_ACCEL) {
+        SHAState x = SHA_STATE(a), y = SHA_STATE(b), r;
+
+        sha256_msg1_accel(&r, &x, &y);
+        sha_state_to_reg(d, &r);
+        return;
+    }
+
     d->L(0) = a->L(0) + SHA256_MSGS0(a->L(1));
     d->L(1) = a->L(1) + SHA256_MSGS0(a->L(2));
     d->L(2) = a->L(2) + SHA256_MSGS0(a->L(3));
@@ -2654,6 +2688,14 @@ void helper_sha256msg1(Reg *d, Reg *a, Reg *b)
 
 void helper_sha256msg2(Reg *d, Reg *a, Reg *b)
 {
+    if (HAVE_SHA256_RNDS2_ACCEL) {
+        SHAState x = SHA_STATE(a), y = SHA_STATE(b), r;
+
+        sha256_msg2_accel(&r, &x, &y);
+        sha_state_to_reg(d, &r);
+        return;
+    }
+
     /* Earlier assignments cannot overwrite any of the two operands.  */
     d->L(0) = a->L(0) + SHA256_MSGS1(b->L(2));
     d->L(1) = a->L(1) + SHA256_MSGS1(b->L(3));
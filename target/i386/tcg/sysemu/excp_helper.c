@@ -58,6 +58,9 @@ typedef struct PTETranslate {
     int ptw_idx;
     void *haddr;
     hwaddr gaddr;
+    /* If hit, the entry was found in the page table walk cache. */
+    bool hit;
+    uint64_t pte;
 } PTETranslate;
 
 static bool ptw_translate(PTETranslate *inout, hwaddr addr)
@@ -65,6 +68,7 @@ static bool ptw_translate(PTETranslate *inout, hwaddr addr)
     int flags;
 
     inout->gaddr = addr;
+    inout->hit = false;
     flags = probe_access_full_mmu(inout->env, addr, 0, MMU_DATA_STORE,
                                   inout->ptw_idx, &inout->haddr, NULL);
 
@@ -82,8 +86,40 @@ static bool ptw_translate(PTETranslate *inout, hwaddr addr)
     return true;
 }
 
+/*
+ * As ptw_translate(), for an entry that may point to another paging
+ * structure, which is then looked up in the page table walk cache.
+ */
+static bool ptw_translate_table(PTETranslate *inout, hwaddr addr)
+{
+    if (tlb_walk_cache_lookup(env_cpu(inout->env), inout->ptw_idx,
+                              addr, &inout->pte)) {
+        inout->gaddr = addr;
+        inout->haddr = NULL;
+        inout->hit = true;
+        return true;
+    }
+    return ptw_translate(inout, addr);
+}
+
+/*
+ * Cache an entry of size @memop that points to another paging
+ * structure, once its accessed bit is set.
+ */
+static inline void ptw_cache_table(const PTETranslate *in, uint64_t pte,
+                                   MemOp memop)
+{
+    if (!in->hit && in->haddr) {
+        tlb_walk_cache_insert(env_cpu(in->env), in->ptw_idx, in->gaddr, pte,
+                              in->haddr, memop);
+    }
+}
+
 static inline uint32_t ptw_ldl(const PTETranslate *in, uint64_t ra)
 {
+    if (in->hit) {
+        return in->pte;
+    }
     if (likely(in->haddr)) {
         return ldl_p(in->haddr);
     }
@@ -92,6 +128,9 @@ static inline uint32_t ptw_ldl(const PTETranslate *in, uint64_t ra)
 
 static inline uint64_t ptw_ldq(const PTETranslate *in, uint64_t ra)
 {
+    if (in->hit) {
+        return in->pte;
+    }
     if (likely(in->haddr)) {
         return ldq_p(in->haddr);
     }
@@ -121,6 +160,8 @@ static inline bool ptw_setl(const PTETranslate *in, uint32_t old, uint32_t set)
 {
     if (set & ~old) {
         uint32_t new = old | set;
+
+        tlb_walk_cache_discard(env_cpu(in->env), in->ptw_idx, in->gaddr);
         if (likely(in->haddr)) {
             old = cpu_to_le32(old);
             new = cpu_to_le32(new);
@@ -166,7 +207,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
                  * Page table level 5
                  */
                 pte_addr = (in->cr3 & ~0xfff) + (((addr >> 48) & 0x1ff) << 3);
-                if (!ptw_translate(&pte_trans, pte_addr)) {
+                if (!ptw_translate_table(&pte_trans, pte_addr)) {
                     return false;
                 }
             restart_5:
@@ -180,6 +221,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
                 if (!ptw_setl(&pte_trans, pte, PG_ACCESSED_MASK)) {
                     goto restart_5;
                 }
+                ptw_cache_table(&pte_trans, pte, MO_LEUQ);
                 ptep = pte ^ PG_NX_MASK;
             } else {
                 pte = in->cr3;
@@ -190,7 +232,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
              * Page table level 4
              */
             pte_addr = (pte & PG_ADDRESS_MASK) + (((addr >> 39) & 0x1ff) << 3);
-            if (!ptw_translate(&pte_trans, pte_addr)) {
+            if (!ptw_translate_table(&pte_trans, pte_addr)) {
                 return false;
             }
         restart_4:
@@ -204,13 +246,14 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
             if (!ptw_setl(&pte_trans, pte, PG_ACCESSED_MASK)) {
                 goto restart_4;
             }
+            ptw_cache_table(&pte_trans, pte, MO_LEUQ);
             ptep &= pte ^ PG_NX_MASK;
 
             /*
              * Page table level 3
              */
             pte_addr = (pte & PG_ADDRESS_MASK) + (((addr >> 30) & 0x1ff) << 3);
-            if (!ptw_translate(&pte_trans, pte_addr)) {
+            if (!ptw_translate_table(&pte_trans, pte_addr)) {
                 return false;
             }
         restart_3_lma:
@@ -230,6 +273,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
                 page_size = 1024 * 1024 * 1024;
                 goto do_check_protect;
             }
+            ptw_cache_table(&pte_trans, pte, MO_LEUQ);
         } else
 #endif
         {
@@ -237,7 +281,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
              * Page table level 3
              */
             pte_addr = (in->cr3 & 0xffffffe0ULL) + ((addr >> 27) & 0x18);
-            if (!ptw_translate(&pte_trans, pte_addr)) {
+            if (!ptw_translate_table(&pte_trans, pte_addr)) {
                 return false;
             }
             rsvd_mask |= PG_HI_USER_MASK;
@@ -252,6 +296,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
             if (!ptw_setl(&pte_trans, pte, PG_ACCESSED_MASK)) {
                 goto restart_3_nolma;
             }
+            ptw_cache_table(&pte_trans, pte, MO_LEUQ);
             ptep = PG_NX_MASK | PG_USER_MASK | PG_RW_MASK;
         }
 
@@ -259,7 +304,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
          * Page table level 2
          */
         pte_addr = (pte & PG_ADDRESS_MASK) + (((addr >> 21) & 0x1ff) << 3);
-        if (!ptw_translate(&pte_trans, pte_addr)) {
+        if (!ptw_translate_table(&pte_trans, pte_addr)) {
             return false;
         }
     restart_2_pae:
@@ -279,6 +324,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
         if (!ptw_setl(&pte_trans, pte, PG_ACCESSED_MASK)) {
             goto restart_2_pae;
         }
+        ptw_cache_table(&pte_trans, pte, MO_LEUQ);
         ptep &= pte ^ PG_NX_MASK;
 
         /*
@@ -303,7 +349,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
          * Page table level 2
          */
         pte_addr = (in->cr3 & 0xfffff000ULL) + ((addr >> 20) & 0xffc);
-        if (!ptw_translate(&pte_trans, pte_addr)) {
+        if (!ptw_translate_table(&pte_trans, pte_addr)) {
             return false;
         }
     restart_2_nopae:
@@ -327,6 +373,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
         if (!ptw_setl(&pte_trans, pte, PG_ACCESSED_MASK)) {
             goto restart_2_nopae;
         }
+        ptw_cache_table(&pte_trans, pte, MO_LEUL);
 
         /*
          * Page table level 1
@@ -490,6 +537,11 @@ do_check_protect_pse36:
  do_fault:
     error_code = 0;
  do_fault_cont:
+    /*
+     * A page fault invalidates the paging-structure caches, so that
+     * the guest may e.g. add permissions without flushing the TLB.
+     */
+    tlb_walk_cache_flush(env_cpu(env));
     if (is_user) {
         error_code |= PG_ERROR_U_MASK;
     }
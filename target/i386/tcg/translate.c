@@ -114,6 +114,7 @@ typedef struct DisasContext {
     bool jmp_opt; /* use direct block chaining for direct jumps */
     bool repz_opt; /* optimize jumps within repz instructions */
     bool cc_op_dirty;
+    bool ras_ret; /* the block ends with a near return */
 
     CCOp cc_op;  /* current CC operation */
     int mem_index; /* select memory access functions */
@@ -2155,6 +2156,19 @@ static void gen_bnd_jmp(DisasContext *s)
     }
 }
 
+/* The pc that cpu_get_tb_cpu_state() computes from EIP = @eip. */
+static TCGv_i64 gen_tb_pc(DisasContext *s, TCGv eip)
+{
+    TCGv_i64 pc = tcg_temp_new_i64();
+
+    tcg_gen_extu_tl_i64(pc, eip);
+    if (!CODE64(s)) {
+        tcg_gen_addi_i64(pc, pc, s->cs_base);
+        tcg_gen_ext32u_i64(pc, pc);
+    }
+    return pc;
+}
+
 /*
  * Generate an end of block, including common tasks such as generating
  * single step traps, resetting the RF flag, and handling the interrupt
@@ -2187,7 +2201,12 @@ gen_eob(DisasContext *s, int mode)
     } else if (mode == DISAS_JUMP &&
                /* give irqs a chance to happen */
                !inhibit_reset) {
-        tcg_gen_lookup_and_goto_ptr();
+        if (s->ras_ret && !(s->base.tb->flags & HF_RF_MASK)) {
+            /* The hflags are those of this TB, as ras_return requires. */
+            translator_ras_return(&s->base, gen_tb_pc(s, cpu_eip));
+        } else {
+            tcg_gen_lookup_and_goto_ptr();
+        }
     } else {
         tcg_gen_exit_tb(NULL, 0);
     }
@@ -2199,6 +2218,7 @@ gen_eob(DisasContext *s, int mode)
 static void gen_jmp_rel(DisasContext *s, MemOp ot, int diff, int tb_num)
 {
     bool use_goto_tb = s->jmp_opt;
+    bool xpage = false;
     target_ulong mask = -1;
     target_ulong new_pc = s->pc + diff;
     target_ulong new_eip = new_pc - s->cs_base;
@@ -2227,9 +2247,13 @@ static void gen_jmp_rel(DisasContext *s, MemOp ot, int diff, int tb_num)
          */
         if (!use_goto_tb || !is_same_page(&s->base, new_pc)) {
             tcg_gen_andi_tl(cpu_eip, cpu_eip, mask);
+            xpage = use_goto_tb;
             use_goto_tb = false;
         }
-    } else if (!CODE64(s)) {
+    } else {
+        xpage = use_goto_tb;
+    }
+    if (!CODE64(s)) {
         new_pc = (uint32_t)(new_eip + s->cs_base);
     }
 
@@ -2241,6 +2265,31 @@ static void gen_jmp_rel(DisasContext *s, MemOp ot, int diff, int tb_num)
         }
         tcg_gen_exit_tb(s->base.tb, tb_num);
         s->base.is_jmp = DISAS_NORETURN;
+    } else if (xpage && translator_use_goto_tb_xpage(&s->base, new_pc)) {
+        TCGLabel *miss;
+
+        /* jump to another page, guarded against mapping changes */
+        if (tb_cflags(s->base.tb) & CF_PCREL) {
+            TCGv_i64 dest = tcg_temp_new_i64();
+
+            tcg_gen_extu_tl_i64(dest, cpu_eip);
+            tcg_gen_addi_i64(dest, dest, s->cs_base);
+            if (!CODE64(s)) {
+                tcg_gen_ext32u_i64(dest, dest);
+            }
+            miss = translator_goto_tb_xpage(&s->base, tb_num, new_pc, dest);
+        } else {
+            miss = translator_goto_tb_xpage(&s->base, tb_num, new_pc, NULL);
+            tcg_gen_movi_tl(cpu_eip, new_eip);
+        }
+        tcg_gen_exit_tb(s->base.tb, tb_num);
+
+        /* The mapping changed: end the block as for an unchained jump. */
+        gen_set_label(miss);
+        if (!(tb_cflags(s->base.tb) & CF_PCREL)) {
+            tcg_gen_movi_tl(cpu_eip, new_eip);
+        }
+        gen_eob(s, DISAS_JUMP);
     } else {
         if (!(tb_cflags(s->base.tb) & CF_PCREL)) {
             tcg_gen_movi_tl(cpu_eip, new_eip);
@@ -2260,6 +2309,34 @@ static void gen_jmp_rel_csize(DisasContext *s, int diff, int tb_num)
     gen_jmp_rel(s, CODE32(s) ? MO_32 : MO_16, diff, tb_num);
 }
 
+/*
+ * When retranslating a hot TB, continue at the target of a direct jump
+ * to eip+diff instead of ending the TB.  Return true if so.
+ */
+static bool gen_jmp_rel_follow(DisasContext *s, MemOp ot, int diff)
+{
+    target_ulong new_pc = s->pc + diff;
+    target_ulong new_eip = new_pc - s->cs_base;
+
+    if (!s->jmp_opt || new_pc < s->pc) {
+        return false;
+    }
+
+    /* The truncation done by gen_jmp_rel must not change the target. */
+    if (!CODE64(s)) {
+        new_eip &= ot == MO_16 ? 0xffff : 0xffffffff;
+        if ((uint32_t)(new_eip + s->cs_base) != new_pc) {
+            return false;
+        }
+    }
+
+    if (!translator_follow_jump(&s->base, new_pc)) {
+        return false;
+    }
+    s->pc = new_pc;
+    return true;
+}
+
 static inline void gen_ldq_env_A0(DisasContext *s, int offset)
 {
     tcg_gen_qemu_ld_i64(s->tmp1_i64, s->A0, s->mem_index, MO_LEUQ);
@@ -3651,6 +3728,7 @@ static void i386_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cpu)
 
     dc->cc_op = CC_OP_DYNAMIC;
     dc->cc_op_dirty = false;
+    dc->ras_ret = false;
     /* select memory access functions */
     dc->mem_index = cpu_mmu_index(cpu, false);
     dc->cpuid_features = env->features[FEAT_1_EDX];
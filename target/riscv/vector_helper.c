@@ -340,6 +340,16 @@ GEN_VEXT_ST_US(vse16_v, int16_t, ste_h)
 GEN_VEXT_ST_US(vse32_v, int32_t, ste_w)
 GEN_VEXT_ST_US(vse64_v, int64_t, ste_d)
 
+/*
+ * Probe the pages of a unit-stride store that is expanded inline, so
+ * that a fault is taken before any of it is written.
+ */
+void HELPER(vext_probe_st)(CPURISCVState *env, target_ulong base,
+                           uint32_t size)
+{
+    probe_pages(env, base, size, GETPC(), MMU_DATA_STORE);
+}
+
 /*
  * unit stride mask load and store, EEW = 1
  */
@@ -204,6 +204,11 @@ typedef enum {
 #define TCG_TARGET_HAS_v64              have_avx1
 #define TCG_TARGET_HAS_v128             have_avx1
 #define TCG_TARGET_HAS_v256             have_avx2
+/*
+ * Only use zmm registers when byte, word and quadword elements are all
+ * available at that width, so that each op can expand the same as V256.
+ */
+#define TCG_TARGET_HAS_v512             (have_avx512bw && have_avx512dq)
 
 #define TCG_TARGET_HAS_andc_vec         1
 #define TCG_TARGET_HAS_orc_vec          have_avx512vl
@@ -248,6 +253,8 @@ typedef enum {
 
 #define TCG_TARGET_DEFAULT_MO (TCG_MO_ALL & ~TCG_MO_ST_LD)
 #define TCG_TARGET_NEED_LDST_LABELS
+/* Slow paths are linked with rel32 branches and may be placed anywhere. */
+#define TCG_TARGET_LDST_COLD
 #define TCG_TARGET_NEED_POOL_LABELS
 
 #endif
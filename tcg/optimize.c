@@ -45,6 +45,13 @@ typedef struct MemCopyInfo {
     TCGType type;
 } MemCopyInfo;
 
+/* A store to env whose value has not been read back yet. */
+typedef struct StorePending {
+    IntervalTreeNode itree;
+    QSIMPLEQ_ENTRY(StorePending) next;
+    TCGOp *op;
+} StorePending;
+
 typedef struct TempOptInfo {
     bool is_const;
     TCGTemp *prev_copy;
@@ -63,6 +70,9 @@ typedef struct OptContext {
     IntervalTreeRoot mem_copy;
     QSIMPLEQ_HEAD(, MemCopyInfo) mem_free;
 
+    IntervalTreeRoot st_pending;
+    QSIMPLEQ_HEAD(, StorePending) st_free;
+
     /* In flight values from optimization. */
     uint64_t a_mask;  /* mask bit is 0 iff value identical to first input */
     uint64_t z_mask;  /* mask bit is 0 iff value bit is 0 */
@@ -337,18 +347,138 @@ static bool args_are_copies(TCGArg arg1, TCGArg arg2)
     return ts_are_copies(arg_temp(arg1), arg_temp(arg2));
 }
 
-static TCGTemp *find_mem_copy_for(OptContext *ctx, TCGType type, intptr_t s)
+static TCGTemp *find_mem_copy_for(OptContext *ctx, TCGType type,
+                                  intptr_t s, intptr_t l)
 {
     MemCopyInfo *mc;
 
     for (mc = mem_copy_first(ctx, s, s); mc; mc = mem_copy_next(mc, s, s)) {
-        if (mc->itree.start == s && mc->type == type) {
+        if (mc->itree.start == s && mc->itree.last == l && mc->type == type) {
             return find_better_copy(mc->ts);
         }
     }
     return NULL;
 }
 
+static void opt_stat_inc(size_t *counter)
+{
+    qatomic_set(counter, *counter + 1);
+}
+
+void tcg_opt_stats(TCGOptStats *stats)
+{
+    unsigned int n_ctxs = qatomic_read(&tcg_cur_ctxs);
+
+    memset(stats, 0, sizeof(*stats));
+    for (unsigned int i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = qatomic_read(&tcg_ctxs[i]);
+        const TCGOptStats *st = &s->opt_stats;
+
+        stats->ops_in += qatomic_read(&st->ops_in);
+        stats->ops_opt += qatomic_read(&st->ops_opt);
+        stats->ops_live += qatomic_read(&st->ops_live);
+        stats->ld_forward += qatomic_read(&st->ld_forward);
+        stats->st_dup += qatomic_read(&st->st_dup);
+        stats->st_dead += qatomic_read(&st->st_dead);
+        stats->ext_elim += qatomic_read(&st->ext_elim);
+    }
+}
+
+/*
+ * Dead store elimination for env.  A store is pending from the time it
+ * is emitted until something may read the bytes it wrote: a load from
+ * env that overlaps them, or anything we cannot see through, i.e. a
+ * load from another base, a helper call, a guest memory access (which
+ * may fault and unwind to cpu_loop_exit) or the end of the basic block.
+ * A pending store entirely covered by a later one is dead.
+ */
+static StorePending *st_pending_first(OptContext *ctx, intptr_t s, intptr_t l)
+{
+    IntervalTreeNode *r = interval_tree_iter_first(&ctx->st_pending, s, l);
+    return r ? container_of(r, StorePending, itree) : NULL;
+}
+
+static StorePending *st_pending_next(StorePending *sp, intptr_t s, intptr_t l)
+{
+    IntervalTreeNode *r = interval_tree_iter_next(&sp->itree, s, l);
+    return r ? container_of(r, StorePending, itree) : NULL;
+}
+
+static void remove_st_pending(OptContext *ctx, StorePending *sp)
+{
+    interval_tree_remove(&sp->itree, &ctx->st_pending);
+    QSIMPLEQ_INSERT_TAIL(&ctx->st_free, sp, next);
+}
+
+static void remove_st_pending_in(OptContext *ctx, intptr_t s, intptr_t l)
+{
+    while (true) {
+        StorePending *sp = st_pending_first(ctx, s, l);
+        if (!sp) {
+            break;
+        }
+        remove_st_pending(ctx, sp);
+    }
+}
+
+static void remove_st_pending_all(OptContext *ctx)
+{
+    remove_st_pending_in(ctx, 0, -1);
+    tcg_debug_assert(interval_tree_is_empty(&ctx->st_pending));
+}
+
+/*
+ * Globals are loaded from and synced to env behind the back of the
+ * optimizer, so never remove a store that overlaps one of them.
+ */
+static bool env_global_overlaps(OptContext *ctx, intptr_t s, intptr_t l)
+{
+    TCGContext *tcg = ctx->tcg;
+    TCGTemp *env = tcgv_ptr_temp(tcg_env);
+
+    for (int i = 0; i < tcg->nb_globals; i++) {
+        TCGTemp *ts = &tcg->temps[i];
+
+        if (ts->kind == TEMP_GLOBAL && ts->mem_base == env &&
+            ts->mem_offset <= l &&
+            ts->mem_offset + tcg_type_size(ts->type) - 1 >= s) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void record_st_pending(OptContext *ctx, TCGOp *op,
+                              intptr_t s, intptr_t l)
+{
+    StorePending *sp;
+
+ restart:
+    for (sp = st_pending_first(ctx, s, l); sp; sp = st_pending_next(sp, s, l)) {
+        if (sp->itree.start >= s && sp->itree.last <= l) {
+            if (!env_global_overlaps(ctx, sp->itree.start, sp->itree.last)) {
+                tcg_op_remove(ctx->tcg, sp->op);
+                opt_stat_inc(&ctx->tcg->opt_stats.st_dead);
+            }
+            remove_st_pending(ctx, sp);
+            goto restart;
+        }
+    }
+
+    sp = QSIMPLEQ_FIRST(&ctx->st_free);
+    if (sp) {
+        QSIMPLEQ_REMOVE_HEAD(&ctx->st_free, next);
+    } else {
+        sp = tcg_malloc(sizeof(*sp));
+    }
+
+    memset(sp, 0, sizeof(*sp));
+    sp->itree.start = s;
+    sp->itree.last = l;
+    sp->op = op;
+    interval_tree_insert(&sp->itree, &ctx->st_pending);
+}
+
 static TCGArg arg_new_constant(OptContext *ctx, uint64_t val)
 {
     TCGType type = ctx->type;
@@ -398,6 +528,7 @@ static bool tcg_opt_gen_mov(OptContext *ctx, TCGOp *op, TCGArg dst, TCGArg src)
     case TCG_TYPE_V64:
     case TCG_TYPE_V128:
     case TCG_TYPE_V256:
+    case TCG_TYPE_V512:
         /* TCGOP_VECL and TCGOP_VECE remain unchanged.  */
         new_op = INDEX_op_mov_vec;
         break;
@@ -1097,6 +1228,7 @@ static bool fold_to_not(OptContext *ctx, TCGOp *op, int idx)
     case TCG_TYPE_V64:
     case TCG_TYPE_V128:
     case TCG_TYPE_V256:
+    case TCG_TYPE_V512:
         not_op = INDEX_op_not_vec;
         have_not = TCG_TARGET_HAS_not_vec;
         break;
@@ -1530,6 +1662,9 @@ static bool fold_call(OptContext *ctx, TCGOp *op)
         remove_mem_copy_all(ctx);
     }
 
+    /* Any helper may read env, or raise an exception. */
+    remove_st_pending_all(ctx);
+
     /* Reset temp data for outputs. */
     for (i = 0; i < nb_oargs; i++) {
         reset_temp(ctx, op->args[i]);
@@ -1774,7 +1909,11 @@ static bool fold_exts(OptContext *ctx, TCGOp *op)
         ctx->a_mask = s_mask & ~s_mask_old;
     }
 
-    return fold_masks(ctx, op);
+    if (fold_masks(ctx, op)) {
+        opt_stat_inc(&ctx->tcg->opt_stats.ext_elim);
+        return true;
+    }
+    return false;
 }
 
 static bool fold_extu(OptContext *ctx, TCGOp *op)
@@ -1815,7 +1954,11 @@ static bool fold_extu(OptContext *ctx, TCGOp *op)
     if (!type_change) {
         ctx->a_mask = z_mask_old ^ z_mask;
     }
-    return fold_masks(ctx, op);
+    if (fold_masks(ctx, op)) {
+        opt_stat_inc(&ctx->tcg->opt_stats.ext_elim);
+        return true;
+    }
+    return false;
 }
 
 static bool fold_mb(OptContext *ctx, TCGOp *op)
@@ -2552,6 +2695,7 @@ static bool fold_sub_to_neg(OptContext *ctx, TCGOp *op)
     case TCG_TYPE_V64:
     case TCG_TYPE_V128:
     case TCG_TYPE_V256:
+    case TCG_TYPE_V512:
         neg_op = INDEX_op_neg_vec;
         have_neg = (TCG_TARGET_HAS_neg_vec &&
                     tcg_can_emit_vec_op(neg_op, ctx->type, TCGOP_VECE(op)) > 0);
@@ -2600,64 +2744,153 @@ static bool fold_sub2(OptContext *ctx, TCGOp *op)
     return fold_addsub2(ctx, op, false);
 }
 
+/*
+ * Return the extension equivalent to the sub-word load @opc, or 0 if the
+ * host does not have it.  For zero extensions, also set @and_mask to the
+ * mask with which AND can replace it.
+ */
+static TCGOpcode ld_ext_opc(TCGOpcode opc, uint64_t *and_mask)
+{
+    *and_mask = 0;
+
+    switch (opc) {
+    case INDEX_op_ld8u_i32:
+        *and_mask = UINT8_MAX;
+        return TCG_TARGET_HAS_ext8u_i32 ? INDEX_op_ext8u_i32 : 0;
+    case INDEX_op_ld8u_i64:
+        *and_mask = UINT8_MAX;
+        return TCG_TARGET_HAS_ext8u_i64 ? INDEX_op_ext8u_i64 : 0;
+    case INDEX_op_ld16u_i32:
+        *and_mask = UINT16_MAX;
+        return TCG_TARGET_HAS_ext16u_i32 ? INDEX_op_ext16u_i32 : 0;
+    case INDEX_op_ld16u_i64:
+        *and_mask = UINT16_MAX;
+        return TCG_TARGET_HAS_ext16u_i64 ? INDEX_op_ext16u_i64 : 0;
+    case INDEX_op_ld32u_i64:
+        *and_mask = UINT32_MAX;
+        return TCG_TARGET_HAS_ext32u_i64 ? INDEX_op_ext32u_i64 : 0;
+    case INDEX_op_ld8s_i32:
+        return TCG_TARGET_HAS_ext8s_i32 ? INDEX_op_ext8s_i32 : 0;
+    case INDEX_op_ld8s_i64:
+        return TCG_TARGET_HAS_ext8s_i64 ? INDEX_op_ext8s_i64 : 0;
+    case INDEX_op_ld16s_i32:
+        return TCG_TARGET_HAS_ext16s_i32 ? INDEX_op_ext16s_i32 : 0;
+    case INDEX_op_ld16s_i64:
+        return TCG_TARGET_HAS_ext16s_i64 ? INDEX_op_ext16s_i64 : 0;
+    case INDEX_op_ld32s_i64:
+        return TCG_TARGET_HAS_ext32s_i64 ? INDEX_op_ext32s_i64 : 0;
+    default:
+        g_assert_not_reached();
+    }
+}
+
 static bool fold_tcg_ld(OptContext *ctx, TCGOp *op)
 {
-    /* We can't do any folding with a load, but we can record bits. */
+    TCGOpcode ext_opc;
+    TCGTemp *src;
+    intptr_t ofs = op->args[2];
+    intptr_t lm1;
+    uint64_t and_mask;
+
+    /* Record the known bits of the result. */
     switch (op->opc) {
     CASE_OP_32_64(ld8s):
         ctx->s_mask = MAKE_64BIT_MASK(8, 56);
+        lm1 = 0;
         break;
     CASE_OP_32_64(ld8u):
         ctx->z_mask = MAKE_64BIT_MASK(0, 8);
         ctx->s_mask = MAKE_64BIT_MASK(9, 55);
+        lm1 = 0;
         break;
     CASE_OP_32_64(ld16s):
         ctx->s_mask = MAKE_64BIT_MASK(16, 48);
+        lm1 = 1;
         break;
     CASE_OP_32_64(ld16u):
         ctx->z_mask = MAKE_64BIT_MASK(0, 16);
         ctx->s_mask = MAKE_64BIT_MASK(17, 47);
+        lm1 = 1;
         break;
     case INDEX_op_ld32s_i64:
         ctx->s_mask = MAKE_64BIT_MASK(32, 32);
+        lm1 = 3;
         break;
     case INDEX_op_ld32u_i64:
         ctx->z_mask = MAKE_64BIT_MASK(0, 32);
         ctx->s_mask = MAKE_64BIT_MASK(33, 31);
+        lm1 = 3;
         break;
     default:
         g_assert_not_reached();
     }
-    return false;
+
+    if (op->args[1] != tcgv_ptr_arg(tcg_env)) {
+        remove_st_pending_all(ctx);
+        return false;
+    }
+
+    /*
+     * If a temp holds the bytes being loaded in its low part, replace
+     * the load by an extension of that temp.  The folding of the
+     * extension then drops it if the temp is known to be extended.
+     */
+    src = find_mem_copy_for(ctx, ctx->type, ofs, ofs + lm1);
+    if (src && src->base_type == ctx->type) {
+        ext_opc = ld_ext_opc(op->opc, &and_mask);
+        if (ext_opc || and_mask) {
+            opt_stat_inc(&ctx->tcg->opt_stats.ld_forward);
+            op->args[1] = temp_arg(src);
+            if (ext_opc) {
+                op->opc = ext_opc;
+                return and_mask ? fold_extu(ctx, op) : fold_exts(ctx, op);
+            }
+            op->opc = (ctx->type == TCG_TYPE_I32
+                       ? INDEX_op_and_i32 : INDEX_op_and_i64);
+            op->args[2] = arg_new_constant(ctx, and_mask);
+            return fold_and(ctx, op);
+        }
+    }
+
+    remove_st_pending_in(ctx, ofs, ofs + lm1);
+    finish_folding(ctx, op);
+    record_mem_copy(ctx, ctx->type, arg_temp(op->args[0]), ofs, ofs + lm1);
+    return true;
 }
 
 static bool fold_tcg_ld_memcopy(OptContext *ctx, TCGOp *op)
 {
     TCGTemp *dst, *src;
-    intptr_t ofs;
+    intptr_t ofs, last;
     TCGType type;
 
     if (op->args[1] != tcgv_ptr_arg(tcg_env)) {
+        remove_st_pending_all(ctx);
         return false;
     }
 
     type = ctx->type;
     ofs = op->args[2];
+    last = ofs + tcg_type_size(type) - 1;
     dst = arg_temp(op->args[0]);
-    src = find_mem_copy_for(ctx, type, ofs);
+    src = find_mem_copy_for(ctx, type, ofs, last);
     if (src && src->base_type == type) {
+        opt_stat_inc(&ctx->tcg->opt_stats.ld_forward);
         return tcg_opt_gen_mov(ctx, op, temp_arg(dst), temp_arg(src));
     }
 
+    remove_st_pending_in(ctx, ofs, last);
     reset_ts(ctx, dst);
-    record_mem_copy(ctx, type, dst, ofs, ofs + tcg_type_size(type) - 1);
+    record_mem_copy(ctx, type, dst, ofs, last);
     return true;
 }
 
 static bool fold_tcg_st(OptContext *ctx, TCGOp *op)
 {
+    TCGTemp *src = arg_temp(op->args[0]);
     intptr_t ofs = op->args[2];
-    intptr_t lm1;
+    intptr_t last;
+    TCGType type = ctx->type;
 
     if (op->args[1] != tcgv_ptr_arg(tcg_env)) {
         remove_mem_copy_all(ctx);
@@ -2666,58 +2899,39 @@ static bool fold_tcg_st(OptContext *ctx, TCGOp *op)
 
     switch (op->opc) {
     CASE_OP_32_64(st8):
-        lm1 = 0;
+        last = ofs;
         break;
     CASE_OP_32_64(st16):
-        lm1 = 1;
+        last = ofs + 1;
         break;
     case INDEX_op_st32_i64:
-    case INDEX_op_st_i32:
-        lm1 = 3;
+        last = ofs + 3;
         break;
+    case INDEX_op_st_i32:
     case INDEX_op_st_i64:
-        lm1 = 7;
-        break;
     case INDEX_op_st_vec:
-        lm1 = tcg_type_size(ctx->type) - 1;
+        last = ofs + tcg_type_size(type) - 1;
         break;
     default:
         g_assert_not_reached();
     }
-    remove_mem_copy_in(ctx, ofs, ofs + lm1);
-    return false;
-}
-
-static bool fold_tcg_st_memcopy(OptContext *ctx, TCGOp *op)
-{
-    TCGTemp *src;
-    intptr_t ofs, last;
-    TCGType type;
-
-    if (op->args[1] != tcgv_ptr_arg(tcg_env)) {
-        fold_tcg_st(ctx, op);
-        return false;
-    }
-
-    src = arg_temp(op->args[0]);
-    ofs = op->args[2];
-    type = ctx->type;
 
     /*
      * Eliminate duplicate stores of a constant.
      * This happens frequently when the target ISA zero-extends.
      */
     if (ts_is_const(src)) {
-        TCGTemp *prev = find_mem_copy_for(ctx, type, ofs);
+        TCGTemp *prev = find_mem_copy_for(ctx, type, ofs, last);
         if (src == prev) {
+            opt_stat_inc(&ctx->tcg->opt_stats.st_dup);
             tcg_op_remove(ctx->tcg, op);
             return true;
         }
     }
 
-    last = ofs + tcg_type_size(type) - 1;
     remove_mem_copy_in(ctx, ofs, last);
     record_mem_copy(ctx, type, src, ofs, last);
+    record_st_pending(ctx, op, ofs, last);
     return false;
 }
 
@@ -2800,6 +3014,7 @@ void tcg_optimize(TCGContext *s)
     OptContext ctx = { .tcg = s };
 
     QSIMPLEQ_INIT(&ctx.mem_free);
+    QSIMPLEQ_INIT(&ctx.st_free);
 
     /* Array VALS has an element for each temp.
        If this temp holds a constant then its value is kept in VALS' element.
@@ -2826,6 +3041,16 @@ void tcg_optimize(TCGContext *s)
         init_arguments(&ctx, op, def->nb_oargs + def->nb_iargs);
         copy_propagate(&ctx, op, def->nb_oargs, def->nb_iargs);
 
+        /*
+         * Pending stores to env are live at the end of the block, or
+         * if the op may read env in a way that fold_tcg_ld*() does not see.
+         */
+        if ((def->flags & (TCG_OPF_BB_END | TCG_OPF_SIDE_EFFECTS |
+                           TCG_OPF_CALL_CLOBBER)) ||
+            opc == INDEX_op_mb || opc == INDEX_op_dupm_vec) {
+            remove_st_pending_all(&ctx);
+        }
+
         /* Pre-compute the type of the operation. */
         if (def->flags & TCG_OPF_VECTOR) {
             ctx.type = TCG_TYPE_V64 + TCGOP_VECL(op);
@@ -2930,12 +3155,10 @@ void tcg_optimize(TCGContext *s)
         CASE_OP_32_64(st8):
         CASE_OP_32_64(st16):
         case INDEX_op_st32_i64:
-            done = fold_tcg_st(&ctx, op);
-            break;
         case INDEX_op_st_i32:
         case INDEX_op_st_i64:
         case INDEX_op_st_vec:
-            done = fold_tcg_st_memcopy(&ctx, op);
+            done = fold_tcg_st(&ctx, op);
             break;
         case INDEX_op_mb:
             done = fold_mb(&ctx, op);
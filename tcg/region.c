@@ -72,10 +72,31 @@ struct tcg_region_state {
     /* fields protected by the lock */
     size_t current; /* current region index */
     size_t agg_size_full; /* aggregate size of full regions */
+    size_t *size_full; /* per-region contribution to agg_size_full */
+    size_t *order; /* regions handed out to contexts, oldest first */
+    size_t n_order;
+    size_t *free; /* regions reclaimed by tcg_region_evict */
+    size_t n_free;
 };
 
+/*
+ * Fraction of the regions that tcg_region_evict reclaims at a time,
+ * rounded up to at least one region.
+ */
+#define TCG_REGION_EVICT_DIV 4
+
 static struct tcg_region_state region;
 
+/* Preferred host address for code_gen_buffer, or NULL for any. */
+static void *code_gen_buffer_hint;
+
+/*
+ * Reserve 1/TCG_REGION_COLD_DIV of each region for slow paths, see
+ * tcg_set_cold_code().
+ */
+#define TCG_REGION_COLD_DIV 8
+static bool cold_code;
+
 /*
  * This is an array of struct tcg_region_tree's, with padding.
  * We use void * to simplify the computation of region_trees[i]; each
@@ -311,6 +332,14 @@ size_t tcg_nb_tbs(void)
     return nb_tbs;
 }
 
+/* Call with rt->lock held */
+static void tcg_region_tree_reset(struct tcg_region_tree *rt)
+{
+    /* Increment the refcount first so that destroy acts as a reset */
+    q_tree_ref(rt->tree);
+    q_tree_destroy(rt->tree);
+}
+
 static void tcg_region_tree_reset_all(void)
 {
     size_t i;
@@ -319,9 +348,7 @@ static void tcg_region_tree_reset_all(void)
     for (i = 0; i < region.n; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
-        /* Increment the refcount first so that destroy acts as a reset */
-        q_tree_ref(rt->tree);
-        q_tree_destroy(rt->tree);
+        tcg_region_tree_reset(rt);
     }
     tcg_region_tree_unlock_all();
 }
@@ -355,15 +382,38 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
     s->code_gen_ptr = start;
     s->code_gen_buffer_size = end - start;
     s->code_gen_highwater = end - TCG_HIGHWATER;
+    s->code_gen_cold_ptr = NULL;
+    s->code_gen_cold_highwater = NULL;
+
+    if (cold_code) {
+        void *cold = end - QEMU_ALIGN_UP((end - start) / TCG_REGION_COLD_DIV,
+                                         qemu_icache_linesize);
+
+        s->code_gen_highwater = cold - TCG_HIGHWATER;
+        s->code_gen_cold_ptr = cold;
+        s->code_gen_cold_highwater = end - TCG_HIGHWATER;
+    }
+}
+
+static size_t tcg_region_index(const void *p)
+{
+    /* Only the first region starts somewhere other than its stride. */
+    return (p - region.start_aligned) / region.stride;
 }
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
-    if (region.current == region.n) {
+    size_t curr_region;
+
+    if (region.n_free) {
+        curr_region = region.free[--region.n_free];
+    } else if (region.current < region.n) {
+        curr_region = region.current++;
+    } else {
         return true;
     }
-    tcg_region_assign(s, region.current);
-    region.current++;
+    tcg_region_assign(s, curr_region);
+    region.order[region.n_order++] = curr_region;
     return false;
 }
 
@@ -376,11 +426,13 @@ bool tcg_region_alloc(TCGContext *s)
     bool err;
     /* read the region size now; alloc__locked will overwrite it on success */
     size_t size_full = s->code_gen_buffer_size;
+    size_t prev_region = tcg_region_index(s->code_gen_buffer);
 
     qemu_mutex_lock(&region.lock);
     err = tcg_region_alloc__locked(s);
     if (!err) {
         region.agg_size_full += size_full - TCG_HIGHWATER;
+        region.size_full[prev_region] = size_full - TCG_HIGHWATER;
     }
     qemu_mutex_unlock(&region.lock);
     return err;
@@ -412,6 +464,9 @@ void tcg_region_reset_all(void)
     qemu_mutex_lock(&region.lock);
     region.current = 0;
     region.agg_size_full = 0;
+    memset(region.size_full, 0, region.n * sizeof(size_t));
+    region.n_order = 0;
+    region.n_free = 0;
 
     for (i = 0; i < n_ctxs; i++) {
         TCGContext *s = qatomic_read(&tcg_ctxs[i]);
@@ -422,6 +477,89 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
+static bool tcg_region_in_use(size_t curr_region, unsigned int n_ctxs)
+{
+    void *start, *end;
+    unsigned int i;
+
+    tcg_region_bounds(curr_region, &start, &end);
+    for (i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = qatomic_read(&tcg_ctxs[i]);
+
+        if (s->code_gen_buffer == start) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Call from a safe-work context.
+ *
+ * Reclaim the regions that were handed out the longest time ago,
+ * skipping those that a context is still generating code into.
+ * @func is called for each TB in a reclaimed region, so that the caller
+ * can unlink it, before the region's TB tree is emptied.
+ *
+ * Return false if no region can be reclaimed, in which case the caller
+ * has to fall back to tcg_region_reset_all().  Otherwise, set
+ * *@n_evicted to the number of regions reclaimed; this is 0 if
+ * another caller has made room already.
+ */
+bool tcg_region_evict(GTraverseFunc func, gpointer user_data,
+                      size_t *n_evicted)
+{
+    unsigned int n_ctxs = qatomic_read(&tcg_cur_ctxs);
+    g_autofree size_t *victims = NULL;
+    size_t want, n = 0, i, j;
+
+    *n_evicted = 0;
+
+    qemu_mutex_lock(&region.lock);
+    if (region.n_free || region.current < region.n) {
+        qemu_mutex_unlock(&region.lock);
+        return true;
+    }
+
+    want = MAX(region.n / TCG_REGION_EVICT_DIV, 1);
+    victims = g_new(size_t, want);
+    for (i = j = 0; i < region.n_order; i++) {
+        size_t curr_region = region.order[i];
+
+        if (n < want && !tcg_region_in_use(curr_region, n_ctxs)) {
+            victims[n++] = curr_region;
+        } else {
+            region.order[j++] = curr_region;
+        }
+    }
+    region.n_order = j;
+    qemu_mutex_unlock(&region.lock);
+
+    if (n == 0) {
+        return false;
+    }
+
+    for (i = 0; i < n; i++) {
+        struct tcg_region_tree *rt = region_trees + victims[i] * tree_size;
+
+        qemu_mutex_lock(&rt->lock);
+        q_tree_foreach(rt->tree, func, user_data);
+        tcg_region_tree_reset(rt);
+        qemu_mutex_unlock(&rt->lock);
+    }
+
+    qemu_mutex_lock(&region.lock);
+    for (i = 0; i < n; i++) {
+        region.agg_size_full -= region.size_full[victims[i]];
+        region.size_full[victims[i]] = 0;
+        region.free[region.n_free++] = victims[i];
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    *n_evicted = n;
+    return true;
+}
+
 static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
 {
 #ifdef CONFIG_USER_ONLY
@@ -435,9 +573,14 @@ static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
      * being of reasonable size. If that's not possible we make do by evenly
      * dividing the code_gen_buffer among the vCPUs.
      */
-    /* Use a single region if all we have is one vCPU thread */
+    /*
+     * With a single vCPU thread, split the buffer anyway so that running
+     * out of space can be handled by reclaiming part of it.  Keep each
+     * region >= 2 MB.
+     */
     if (max_cpus == 1 || !qemu_tcg_mttcg_enabled()) {
-        return 1;
+        n_regions = tb_size / (2 * MiB);
+        return MAX(MIN(n_regions, 8), 1);
     }
 
     /*
@@ -556,7 +699,7 @@ static int alloc_code_gen_buffer_anon(size_t size, int prot,
 {
     void *buf;
 
-    buf = mmap(NULL, size, prot, flags, -1, 0);
+    buf = mmap(code_gen_buffer_hint, size, prot, flags, -1, 0);
     if (buf == MAP_FAILED) {
         error_setg_errno(errp, errno,
                          "allocate %zu bytes for jit buffer", size);
@@ -721,6 +864,18 @@ static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
 }
 #endif /* USE_STATIC_CODE_GEN_BUFFER, WIN32, POSIX */
 
+void tcg_set_cold_code(bool enable)
+{
+#ifdef TCG_TARGET_LDST_COLD
+    cold_code = enable;
+#endif
+}
+
+void tcg_set_code_gen_buffer_hint(void *addr)
+{
+    code_gen_buffer_hint = addr;
+}
+
 /*
  * Initializes region partitioning.
  *
@@ -808,6 +963,9 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
 
     /* init the region struct */
     qemu_mutex_init(&region.lock);
+    region.size_full = g_new0(size_t, region.n);
+    region.order = g_new(size_t, region.n);
+    region.free = g_new(size_t, region.n);
 
     /*
      * Set guard pages in the rw buffer, as that's the one into which
@@ -1500,6 +1500,7 @@ void tcg_func_start(TCGContext *s)
 
     s->nb_ops = 0;
     s->nb_labels = 0;
+    s->gen_tb_nb_succ = 0;
     s->current_frame_offset = s->frame_start;
 
 #ifdef CONFIG_DEBUG_TCG
@@ -1672,6 +1673,7 @@ TCGTemp *tcg_temp_new_internal(TCGType type, TCGTempKind kind)
     case TCG_TYPE_V64:
     case TCG_TYPE_V128:
     case TCG_TYPE_V256:
+    case TCG_TYPE_V512:
         n = 1;
         break;
     case TCG_TYPE_I64:
@@ -1763,6 +1765,9 @@ TCGv_vec tcg_temp_new_vec(TCGType type)
     case TCG_TYPE_V256:
         assert(TCG_TARGET_HAS_v256);
         break;
+    case TCG_TYPE_V512:
+        assert(TCG_TARGET_HAS_v512);
+        break;
     default:
         g_assert_not_reached();
     }
@@ -1936,7 +1941,8 @@ TCGTemp *tcgv_i32_temp(TCGv_i32 v)
 bool tcg_op_supported(TCGOpcode op)
 {
     const bool have_vec
-        = TCG_TARGET_HAS_v64 | TCG_TARGET_HAS_v128 | TCG_TARGET_HAS_v256;
+        = TCG_TARGET_HAS_v64 | TCG_TARGET_HAS_v128 | TCG_TARGET_HAS_v256
+        | TCG_TARGET_HAS_v512;
 
     switch (op) {
     case INDEX_op_discard:
@@ -2446,6 +2452,7 @@ static char *tcg_get_arg_str_ptr(TCGContext *s, char *buf, int buf_size,
         case TCG_TYPE_V64:
         case TCG_TYPE_V128:
         case TCG_TYPE_V256:
+        case TCG_TYPE_V512:
             snprintf(buf, buf_size, "v%d$0x%" PRIx64,
                      64 << (ts->type - TCG_TYPE_V64), ts->val);
             break;
@@ -4140,8 +4147,9 @@ static void temp_allocate_frame(TCGContext *s, TCGTemp *ts)
     case TCG_TYPE_I128:
     case TCG_TYPE_V128:
     case TCG_TYPE_V256:
+    case TCG_TYPE_V512:
         /*
-         * Note that we do not require aligned storage for V256,
+         * Note that we do not require aligned storage for V256 or V512,
          * and that we provide alignment for I128 to match V128,
          * even if that's above what the host ABI requires.
          */
@@ -6120,7 +6128,9 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb, uint64_t pc_start)
     }
 #endif
 
+    qatomic_set(&s->opt_stats.ops_in, s->opt_stats.ops_in + s->nb_ops);
     tcg_optimize(s);
+    qatomic_set(&s->opt_stats.ops_opt, s->opt_stats.ops_opt + s->nb_ops);
 
     reachable_code_pass(s);
     liveness_pass_0(s);
@@ -6144,6 +6154,7 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb, uint64_t pc_start)
             liveness_pass_1(s);
         }
     }
+    qatomic_set(&s->opt_stats.ops_live, s->opt_stats.ops_live + s->nb_ops);
 
     if (unlikely(qemu_loglevel_mask(CPU_LOG_TB_OP_OPT)
                  && qemu_log_in_addr_range(pc_start))) {
@@ -6175,6 +6186,7 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb, uint64_t pc_start)
 
 #ifdef TCG_TARGET_NEED_LDST_LABELS
     QSIMPLEQ_INIT(&s->ldst_labels);
+    s->cold_code_ptr = s->code_gen_cold_ptr;
 #endif
 #ifdef TCG_TARGET_NEED_POOL_LABELS
     s->pool_labels = NULL;
@@ -6279,7 +6291,18 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb, uint64_t pc_start)
     flush_idcache_range((uintptr_t)tcg_splitwx_to_rx(s->code_buf),
                         (uintptr_t)s->code_buf,
                         tcg_ptr_byte_diff(s->code_ptr, s->code_buf));
+    if (s->code_gen_cold_ptr) {
+        void *cold = s->code_gen_cold_ptr;
+
+        flush_idcache_range((uintptr_t)tcg_splitwx_to_rx(cold),
+                            (uintptr_t)cold,
+                            (void *)s->cold_code_ptr - cold);
+    }
 #endif
+    /* The slow paths of this TB are final; keep them. */
+    if (s->code_gen_cold_ptr) {
+        s->code_gen_cold_ptr = s->cold_code_ptr;
+    }
 
     return tcg_current_code_size(s);
 }
@@ -193,6 +193,33 @@ static void tci_args_rrrrrr(uint32_t insn, TCGReg *r0, TCGReg *r1,
     *r5 = extract32(insn, 28, 4);
 }
 
+/*
+ * The compare-and-branch superinstructions keep their label in a second
+ * word, relative to the end of the instruction.  These return the
+ * pointer past that word.
+ */
+static const uint32_t *tci_args_rrcl(uint32_t insn, const uint32_t *tb_ptr,
+                                     TCGReg *r0, TCGReg *r1, TCGCond *c2,
+                                     void **l3)
+{
+    *r0 = extract32(insn, 8, 4);
+    *r1 = extract32(insn, 12, 4);
+    *c2 = extract32(insn, 16, 4);
+    *l3 = sextract32(*tb_ptr, 12, 20) + (void *)(tb_ptr + 1);
+    return tb_ptr + 1;
+}
+
+static const uint32_t *tci_args_rcil(uint32_t insn, const uint32_t *tb_ptr,
+                                     TCGReg *r0, TCGCond *c1,
+                                     tcg_target_ulong *i2, void **l3)
+{
+    *r0 = extract32(insn, 8, 4);
+    *c1 = extract32(insn, 12, 4);
+    *i2 = sextract32(insn, 16, 16);
+    *l3 = sextract32(*tb_ptr, 12, 20) + (void *)(tb_ptr + 1);
+    return tb_ptr + 1;
+}
+
 static bool tci_compare32(uint32_t u0, uint32_t u1, TCGCond condition)
 {
     bool result = false;
@@ -339,16 +366,61 @@ static void tci_qemu_st(CPUArchState *env, uint64_t taddr, uint64_t val,
     }
 }
 
+/*
+ * With computed goto, each handler fetches the next instruction and
+ * jumps straight to its handler, instead of going back to a switch
+ * statement shared by all of them.  This leaves one indirect branch
+ * per handler for the host to predict, which tracks the common
+ * sequences of operations much better.  Each case label is also a
+ * plain label, whose address goes into the dispatch table.
+ *
+ * All compilers supported by QEMU implement computed goto; undefine
+ * TCI_THREADED to go back to the switch statement, e.g. when comparing
+ * the two.
+ */
+#define TCI_THREADED
+
+#ifdef TCI_THREADED
+# define TCI_LABEL(x)       glue(tci_op_, x):
+# define TCI_TARGET(op, x)  [op] = &&glue(tci_op_, x),
+# define TCI_NEXT()                             \
+    do {                                        \
+        insn = *tb_ptr++;                       \
+        opc = extract32(insn, 0, 8);            \
+        goto *tci_targets[opc];                 \
+    } while (0)
+#else
+# define TCI_LABEL(x)
+# define TCI_NEXT()         continue
+#endif
+
+#define CASE_OP(x) \
+        case glue(INDEX_op_, x): \
+        TCI_LABEL(x)
+#define TARGET_OP(x) \
+        TCI_TARGET(glue(INDEX_op_, x), x)
+
 #if TCG_TARGET_REG_BITS == 64
 # define CASE_32_64(x) \
         case glue(glue(INDEX_op_, x), _i64): \
-        case glue(glue(INDEX_op_, x), _i32):
+        case glue(glue(INDEX_op_, x), _i32): \
+        TCI_LABEL(x)
 # define CASE_64(x) \
-        case glue(glue(INDEX_op_, x), _i64):
+        case glue(glue(INDEX_op_, x), _i64): \
+        TCI_LABEL(glue(x, _i64))
+# define TARGET_32_64(x) \
+        TCI_TARGET(glue(glue(INDEX_op_, x), _i64), x) \
+        TCI_TARGET(glue(glue(INDEX_op_, x), _i32), x)
+# define TARGET_64(x) \
+        TCI_TARGET(glue(glue(INDEX_op_, x), _i64), glue(x, _i64))
 #else
 # define CASE_32_64(x) \
-        case glue(glue(INDEX_op_, x), _i32):
+        case glue(glue(INDEX_op_, x), _i32): \
+        TCI_LABEL(x)
 # define CASE_64(x)
+# define TARGET_32_64(x) \
+        TCI_TARGET(glue(glue(INDEX_op_, x), _i32), x)
+# define TARGET_64(x)
 #endif
 
 /* Interpret pseudo code in tb. */
@@ -360,6 +432,190 @@ static void tci_qemu_st(CPUArchState *env, uint64_t taddr, uint64_t val,
 uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
                                             const void *v_tb_ptr)
 {
+#ifdef TCI_THREADED
+    static const void * const tci_targets[NB_OPS] = {
+        [0 ... NB_OPS - 1] = &&tci_op_illegal,
+            TARGET_OP(call)
+            TARGET_OP(br)
+            TARGET_OP(setcond_i32)
+            TARGET_OP(movcond_i32)
+#if TCG_TARGET_REG_BITS == 32
+            TARGET_OP(setcond2_i32)
+#elif TCG_TARGET_REG_BITS == 64
+            TARGET_OP(setcond_i64)
+            TARGET_OP(movcond_i64)
+#endif
+            TARGET_32_64(mov)
+            TARGET_OP(tci_movi)
+            TARGET_OP(tci_movl)
+            TARGET_32_64(ld8u)
+            TARGET_32_64(ld8s)
+            TARGET_32_64(ld16u)
+            TARGET_32_64(ld16s)
+            TARGET_OP(ld_i32)
+            TARGET_64(ld32u)
+            TARGET_32_64(st8)
+            TARGET_32_64(st16)
+            TARGET_OP(st_i32)
+            TARGET_64(st32)
+            TARGET_32_64(add)
+            TARGET_32_64(sub)
+            TARGET_32_64(mul)
+            TARGET_32_64(and)
+            TARGET_32_64(or)
+            TARGET_32_64(xor)
+#if TCG_TARGET_HAS_andc_i32 || TCG_TARGET_HAS_andc_i64
+            TARGET_32_64(andc)
+#endif
+#if TCG_TARGET_HAS_orc_i32 || TCG_TARGET_HAS_orc_i64
+            TARGET_32_64(orc)
+#endif
+#if TCG_TARGET_HAS_eqv_i32 || TCG_TARGET_HAS_eqv_i64
+            TARGET_32_64(eqv)
+#endif
+#if TCG_TARGET_HAS_nand_i32 || TCG_TARGET_HAS_nand_i64
+            TARGET_32_64(nand)
+#endif
+#if TCG_TARGET_HAS_nor_i32 || TCG_TARGET_HAS_nor_i64
+            TARGET_32_64(nor)
+#endif
+            TARGET_OP(div_i32)
+            TARGET_OP(divu_i32)
+            TARGET_OP(rem_i32)
+            TARGET_OP(remu_i32)
+#if TCG_TARGET_HAS_clz_i32
+            TARGET_OP(clz_i32)
+#endif
+#if TCG_TARGET_HAS_ctz_i32
+            TARGET_OP(ctz_i32)
+#endif
+#if TCG_TARGET_HAS_ctpop_i32
+            TARGET_OP(ctpop_i32)
+#endif
+            TARGET_OP(shl_i32)
+            TARGET_OP(shr_i32)
+            TARGET_OP(sar_i32)
+#if TCG_TARGET_HAS_rot_i32
+            TARGET_OP(rotl_i32)
+            TARGET_OP(rotr_i32)
+#endif
+#if TCG_TARGET_HAS_deposit_i32
+            TARGET_OP(deposit_i32)
+#endif
+#if TCG_TARGET_HAS_extract_i32
+            TARGET_OP(extract_i32)
+#endif
+#if TCG_TARGET_HAS_sextract_i32
+            TARGET_OP(sextract_i32)
+#endif
+            TARGET_OP(brcond_i32)
+            TARGET_OP(tci_brcond_i32)
+            TARGET_OP(tci_brcondi_i32)
+#if TCG_TARGET_REG_BITS == 32 || TCG_TARGET_HAS_add2_i32
+            TARGET_OP(add2_i32)
+#endif
+#if TCG_TARGET_REG_BITS == 32 || TCG_TARGET_HAS_sub2_i32
+            TARGET_OP(sub2_i32)
+#endif
+#if TCG_TARGET_HAS_mulu2_i32
+            TARGET_OP(mulu2_i32)
+#endif
+#if TCG_TARGET_HAS_muls2_i32
+            TARGET_OP(muls2_i32)
+#endif
+#if TCG_TARGET_HAS_ext8s_i32 || TCG_TARGET_HAS_ext8s_i64
+            TARGET_32_64(ext8s)
+#endif
+#if TCG_TARGET_HAS_ext16s_i32 || TCG_TARGET_HAS_ext16s_i64 || \
+    TCG_TARGET_HAS_bswap16_i32 || TCG_TARGET_HAS_bswap16_i64
+            TARGET_32_64(ext16s)
+#endif
+#if TCG_TARGET_HAS_ext8u_i32 || TCG_TARGET_HAS_ext8u_i64
+            TARGET_32_64(ext8u)
+#endif
+#if TCG_TARGET_HAS_ext16u_i32 || TCG_TARGET_HAS_ext16u_i64
+            TARGET_32_64(ext16u)
+#endif
+#if TCG_TARGET_HAS_bswap16_i32 || TCG_TARGET_HAS_bswap16_i64
+            TARGET_32_64(bswap16)
+#endif
+#if TCG_TARGET_HAS_bswap32_i32 || TCG_TARGET_HAS_bswap32_i64
+            TARGET_32_64(bswap32)
+#endif
+#if TCG_TARGET_HAS_not_i32 || TCG_TARGET_HAS_not_i64
+            TARGET_32_64(not)
+#endif
+            TARGET_32_64(neg)
+#if TCG_TARGET_REG_BITS == 64
+            TARGET_OP(ld32s_i64)
+            TARGET_OP(ld_i64)
+            TARGET_OP(st_i64)
+            TARGET_OP(div_i64)
+            TARGET_OP(divu_i64)
+            TARGET_OP(rem_i64)
+            TARGET_OP(remu_i64)
+#if TCG_TARGET_HAS_clz_i64
+            TARGET_OP(clz_i64)
+#endif
+#if TCG_TARGET_HAS_ctz_i64
+            TARGET_OP(ctz_i64)
+#endif
+#if TCG_TARGET_HAS_ctpop_i64
+            TARGET_OP(ctpop_i64)
+#endif
+#if TCG_TARGET_HAS_mulu2_i64
+            TARGET_OP(mulu2_i64)
+#endif
+#if TCG_TARGET_HAS_muls2_i64
+            TARGET_OP(muls2_i64)
+#endif
+#if TCG_TARGET_HAS_add2_i64
+            TARGET_OP(add2_i64)
+#endif
+#if TCG_TARGET_HAS_add2_i64
+            TARGET_OP(sub2_i64)
+#endif
+            TARGET_OP(shl_i64)
+            TARGET_OP(shr_i64)
+            TARGET_OP(sar_i64)
+#if TCG_TARGET_HAS_rot_i64
+            TARGET_OP(rotl_i64)
+            TARGET_OP(rotr_i64)
+#endif
+#if TCG_TARGET_HAS_deposit_i64
+            TARGET_OP(deposit_i64)
+#endif
+#if TCG_TARGET_HAS_extract_i64
+            TARGET_OP(extract_i64)
+#endif
+#if TCG_TARGET_HAS_sextract_i64
+            TARGET_OP(sextract_i64)
+#endif
+            TARGET_OP(brcond_i64)
+            TARGET_OP(tci_brcond_i64)
+            TARGET_OP(tci_brcondi_i64)
+            TARGET_OP(ext32s_i64)
+            TARGET_OP(ext_i32_i64)
+            TARGET_OP(ext32u_i64)
+            TARGET_OP(extu_i32_i64)
+#if TCG_TARGET_HAS_bswap64_i64
+            TARGET_OP(bswap64_i64)
+#endif
+#endif /* TCG_TARGET_REG_BITS == 64 */
+            TARGET_OP(exit_tb)
+            TARGET_OP(goto_tb)
+            TARGET_OP(goto_ptr)
+            TARGET_OP(qemu_ld_a32_i32)
+            TARGET_OP(qemu_ld_a64_i32)
+            TARGET_OP(qemu_ld_a32_i64)
+            TARGET_OP(qemu_ld_a64_i64)
+            TARGET_OP(qemu_st_a32_i32)
+            TARGET_OP(qemu_st_a64_i32)
+            TARGET_OP(qemu_st_a32_i64)
+            TARGET_OP(qemu_st_a64_i64)
+            TARGET_OP(mb)
+    };
+#endif
     const uint32_t *tb_ptr = v_tb_ptr;
     tcg_target_ulong regs[TCG_TARGET_NB_REGS];
     uint64_t stack[(TCG_STATIC_CALL_ARGS_SIZE + TCG_STATIC_FRAME_SIZE)
@@ -385,9 +641,12 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
 
         insn = *tb_ptr++;
         opc = extract32(insn, 0, 8);
+#ifdef TCI_THREADED
+        goto *tci_targets[opc];
+#endif
 
         switch (opc) {
-        case INDEX_op_call:
+        CASE_OP(call)
             {
                 void *call_slots[MAX_CALL_IARGS];
                 ffi_cif *cif;
@@ -438,51 +697,51 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             default:
                 g_assert_not_reached();
             }
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_br:
+        CASE_OP(br)
             tci_args_l(insn, tb_ptr, &ptr);
             tb_ptr = ptr;
-            continue;
-        case INDEX_op_setcond_i32:
+            TCI_NEXT();
+        CASE_OP(setcond_i32)
             tci_args_rrrc(insn, &r0, &r1, &r2, &condition);
             regs[r0] = tci_compare32(regs[r1], regs[r2], condition);
-            break;
-        case INDEX_op_movcond_i32:
+            TCI_NEXT();
+        CASE_OP(movcond_i32)
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             tmp32 = tci_compare32(regs[r1], regs[r2], condition);
             regs[r0] = regs[tmp32 ? r3 : r4];
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_REG_BITS == 32
-        case INDEX_op_setcond2_i32:
+        CASE_OP(setcond2_i32)
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             T1 = tci_uint64(regs[r2], regs[r1]);
             T2 = tci_uint64(regs[r4], regs[r3]);
             regs[r0] = tci_compare64(T1, T2, condition);
-            break;
+            TCI_NEXT();
 #elif TCG_TARGET_REG_BITS == 64
-        case INDEX_op_setcond_i64:
+        CASE_OP(setcond_i64)
             tci_args_rrrc(insn, &r0, &r1, &r2, &condition);
             regs[r0] = tci_compare64(regs[r1], regs[r2], condition);
-            break;
-        case INDEX_op_movcond_i64:
+            TCI_NEXT();
+        CASE_OP(movcond_i64)
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             tmp32 = tci_compare64(regs[r1], regs[r2], condition);
             regs[r0] = regs[tmp32 ? r3 : r4];
-            break;
+            TCI_NEXT();
 #endif
         CASE_32_64(mov)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = regs[r1];
-            break;
-        case INDEX_op_tci_movi:
+            TCI_NEXT();
+        CASE_OP(tci_movi)
             tci_args_ri(insn, &r0, &t1);
             regs[r0] = t1;
-            break;
-        case INDEX_op_tci_movl:
+            TCI_NEXT();
+        CASE_OP(tci_movl)
             tci_args_rl(insn, tb_ptr, &r0, &ptr);
             regs[r0] = *(tcg_target_ulong *)ptr;
-            break;
+            TCI_NEXT();
 
             /* Load/store operations (32 bit). */
 
@@ -490,443 +749,467 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint8_t *)ptr;
-            break;
+            TCI_NEXT();
         CASE_32_64(ld8s)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(int8_t *)ptr;
-            break;
+            TCI_NEXT();
         CASE_32_64(ld16u)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint16_t *)ptr;
-            break;
+            TCI_NEXT();
         CASE_32_64(ld16s)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(int16_t *)ptr;
-            break;
-        case INDEX_op_ld_i32:
+            TCI_NEXT();
+        CASE_OP(ld_i32)
         CASE_64(ld32u)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint32_t *)ptr;
-            break;
+            TCI_NEXT();
         CASE_32_64(st8)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint8_t *)ptr = regs[r0];
-            break;
+            TCI_NEXT();
         CASE_32_64(st16)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint16_t *)ptr = regs[r0];
-            break;
-        case INDEX_op_st_i32:
+            TCI_NEXT();
+        CASE_OP(st_i32)
         CASE_64(st32)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint32_t *)ptr = regs[r0];
-            break;
+            TCI_NEXT();
 
             /* Arithmetic operations (mixed 32/64 bit). */
 
         CASE_32_64(add)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] + regs[r2];
-            break;
+            TCI_NEXT();
         CASE_32_64(sub)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] - regs[r2];
-            break;
+            TCI_NEXT();
         CASE_32_64(mul)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] * regs[r2];
-            break;
+            TCI_NEXT();
         CASE_32_64(and)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] & regs[r2];
-            break;
+            TCI_NEXT();
         CASE_32_64(or)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] | regs[r2];
-            break;
+            TCI_NEXT();
         CASE_32_64(xor)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] ^ regs[r2];
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_HAS_andc_i32 || TCG_TARGET_HAS_andc_i64
         CASE_32_64(andc)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] & ~regs[r2];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_orc_i32 || TCG_TARGET_HAS_orc_i64
         CASE_32_64(orc)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] | ~regs[r2];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_eqv_i32 || TCG_TARGET_HAS_eqv_i64
         CASE_32_64(eqv)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ~(regs[r1] ^ regs[r2]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_nand_i32 || TCG_TARGET_HAS_nand_i64
         CASE_32_64(nand)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ~(regs[r1] & regs[r2]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_nor_i32 || TCG_TARGET_HAS_nor_i64
         CASE_32_64(nor)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ~(regs[r1] | regs[r2]);
-            break;
+            TCI_NEXT();
 #endif
 
             /* Arithmetic operations (32 bit). */
 
-        case INDEX_op_div_i32:
+        CASE_OP(div_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int32_t)regs[r1] / (int32_t)regs[r2];
-            break;
-        case INDEX_op_divu_i32:
+            TCI_NEXT();
+        CASE_OP(divu_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint32_t)regs[r1] / (uint32_t)regs[r2];
-            break;
-        case INDEX_op_rem_i32:
+            TCI_NEXT();
+        CASE_OP(rem_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int32_t)regs[r1] % (int32_t)regs[r2];
-            break;
-        case INDEX_op_remu_i32:
+            TCI_NEXT();
+        CASE_OP(remu_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint32_t)regs[r1] % (uint32_t)regs[r2];
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_HAS_clz_i32
-        case INDEX_op_clz_i32:
+        CASE_OP(clz_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             tmp32 = regs[r1];
             regs[r0] = tmp32 ? clz32(tmp32) : regs[r2];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ctz_i32
-        case INDEX_op_ctz_i32:
+        CASE_OP(ctz_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             tmp32 = regs[r1];
             regs[r0] = tmp32 ? ctz32(tmp32) : regs[r2];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ctpop_i32
-        case INDEX_op_ctpop_i32:
+        CASE_OP(ctpop_i32)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = ctpop32(regs[r1]);
-            break;
+            TCI_NEXT();
 #endif
 
             /* Shift/rotate operations (32 bit). */
 
-        case INDEX_op_shl_i32:
+        CASE_OP(shl_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint32_t)regs[r1] << (regs[r2] & 31);
-            break;
-        case INDEX_op_shr_i32:
+            TCI_NEXT();
+        CASE_OP(shr_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint32_t)regs[r1] >> (regs[r2] & 31);
-            break;
-        case INDEX_op_sar_i32:
+            TCI_NEXT();
+        CASE_OP(sar_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int32_t)regs[r1] >> (regs[r2] & 31);
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_HAS_rot_i32
-        case INDEX_op_rotl_i32:
+        CASE_OP(rotl_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = rol32(regs[r1], regs[r2] & 31);
-            break;
-        case INDEX_op_rotr_i32:
+            TCI_NEXT();
+        CASE_OP(rotr_i32)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ror32(regs[r1], regs[r2] & 31);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_deposit_i32
-        case INDEX_op_deposit_i32:
+        CASE_OP(deposit_i32)
             tci_args_rrrbb(insn, &r0, &r1, &r2, &pos, &len);
             regs[r0] = deposit32(regs[r1], pos, len, regs[r2]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_extract_i32
-        case INDEX_op_extract_i32:
+        CASE_OP(extract_i32)
             tci_args_rrbb(insn, &r0, &r1, &pos, &len);
             regs[r0] = extract32(regs[r1], pos, len);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_sextract_i32
-        case INDEX_op_sextract_i32:
+        CASE_OP(sextract_i32)
             tci_args_rrbb(insn, &r0, &r1, &pos, &len);
             regs[r0] = sextract32(regs[r1], pos, len);
-            break;
+            TCI_NEXT();
 #endif
-        case INDEX_op_brcond_i32:
+        CASE_OP(brcond_i32)
             tci_args_rl(insn, tb_ptr, &r0, &ptr);
             if ((uint32_t)regs[r0]) {
                 tb_ptr = ptr;
             }
-            break;
+            TCI_NEXT();
+        CASE_OP(tci_brcond_i32)
+            tb_ptr = tci_args_rrcl(insn, tb_ptr, &r0, &r1, &condition, &ptr);
+            if (tci_compare32(regs[r0], regs[r1], condition)) {
+                tb_ptr = ptr;
+            }
+            TCI_NEXT();
+        CASE_OP(tci_brcondi_i32)
+            tb_ptr = tci_args_rcil(insn, tb_ptr, &r0, &condition, &t1, &ptr);
+            if (tci_compare32(regs[r0], t1, condition)) {
+                tb_ptr = ptr;
+            }
+            TCI_NEXT();
 #if TCG_TARGET_REG_BITS == 32 || TCG_TARGET_HAS_add2_i32
-        case INDEX_op_add2_i32:
+        CASE_OP(add2_i32)
             tci_args_rrrrrr(insn, &r0, &r1, &r2, &r3, &r4, &r5);
             T1 = tci_uint64(regs[r3], regs[r2]);
             T2 = tci_uint64(regs[r5], regs[r4]);
             tci_write_reg64(regs, r1, r0, T1 + T2);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_REG_BITS == 32 || TCG_TARGET_HAS_sub2_i32
-        case INDEX_op_sub2_i32:
+        CASE_OP(sub2_i32)
             tci_args_rrrrrr(insn, &r0, &r1, &r2, &r3, &r4, &r5);
             T1 = tci_uint64(regs[r3], regs[r2]);
             T2 = tci_uint64(regs[r5], regs[r4]);
             tci_write_reg64(regs, r1, r0, T1 - T2);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_mulu2_i32
-        case INDEX_op_mulu2_i32:
+        CASE_OP(mulu2_i32)
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
             tmp64 = (uint64_t)(uint32_t)regs[r2] * (uint32_t)regs[r3];
             tci_write_reg64(regs, r1, r0, tmp64);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_muls2_i32
-        case INDEX_op_muls2_i32:
+        CASE_OP(muls2_i32)
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
             tmp64 = (int64_t)(int32_t)regs[r2] * (int32_t)regs[r3];
             tci_write_reg64(regs, r1, r0, tmp64);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ext8s_i32 || TCG_TARGET_HAS_ext8s_i64
         CASE_32_64(ext8s)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (int8_t)regs[r1];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ext16s_i32 || TCG_TARGET_HAS_ext16s_i64 || \
     TCG_TARGET_HAS_bswap16_i32 || TCG_TARGET_HAS_bswap16_i64
         CASE_32_64(ext16s)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (int16_t)regs[r1];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ext8u_i32 || TCG_TARGET_HAS_ext8u_i64
         CASE_32_64(ext8u)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (uint8_t)regs[r1];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ext16u_i32 || TCG_TARGET_HAS_ext16u_i64
         CASE_32_64(ext16u)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (uint16_t)regs[r1];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_bswap16_i32 || TCG_TARGET_HAS_bswap16_i64
         CASE_32_64(bswap16)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = bswap16(regs[r1]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_bswap32_i32 || TCG_TARGET_HAS_bswap32_i64
         CASE_32_64(bswap32)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = bswap32(regs[r1]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_not_i32 || TCG_TARGET_HAS_not_i64
         CASE_32_64(not)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = ~regs[r1];
-            break;
+            TCI_NEXT();
 #endif
         CASE_32_64(neg)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = -regs[r1];
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_REG_BITS == 64
             /* Load/store operations (64 bit). */
 
-        case INDEX_op_ld32s_i64:
+        CASE_OP(ld32s_i64)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(int32_t *)ptr;
-            break;
-        case INDEX_op_ld_i64:
+            TCI_NEXT();
+        CASE_OP(ld_i64)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint64_t *)ptr;
-            break;
-        case INDEX_op_st_i64:
+            TCI_NEXT();
+        CASE_OP(st_i64)
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint64_t *)ptr = regs[r0];
-            break;
+            TCI_NEXT();
 
             /* Arithmetic operations (64 bit). */
 
-        case INDEX_op_div_i64:
+        CASE_OP(div_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int64_t)regs[r1] / (int64_t)regs[r2];
-            break;
-        case INDEX_op_divu_i64:
+            TCI_NEXT();
+        CASE_OP(divu_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint64_t)regs[r1] / (uint64_t)regs[r2];
-            break;
-        case INDEX_op_rem_i64:
+            TCI_NEXT();
+        CASE_OP(rem_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int64_t)regs[r1] % (int64_t)regs[r2];
-            break;
-        case INDEX_op_remu_i64:
+            TCI_NEXT();
+        CASE_OP(remu_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint64_t)regs[r1] % (uint64_t)regs[r2];
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_HAS_clz_i64
-        case INDEX_op_clz_i64:
+        CASE_OP(clz_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] ? clz64(regs[r1]) : regs[r2];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ctz_i64
-        case INDEX_op_ctz_i64:
+        CASE_OP(ctz_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] ? ctz64(regs[r1]) : regs[r2];
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_ctpop_i64
-        case INDEX_op_ctpop_i64:
+        CASE_OP(ctpop_i64)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = ctpop64(regs[r1]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_mulu2_i64
-        case INDEX_op_mulu2_i64:
+        CASE_OP(mulu2_i64)
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
             mulu64(&regs[r0], &regs[r1], regs[r2], regs[r3]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_muls2_i64
-        case INDEX_op_muls2_i64:
+        CASE_OP(muls2_i64)
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
             muls64(&regs[r0], &regs[r1], regs[r2], regs[r3]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_add2_i64
-        case INDEX_op_add2_i64:
+        CASE_OP(add2_i64)
             tci_args_rrrrrr(insn, &r0, &r1, &r2, &r3, &r4, &r5);
             T1 = regs[r2] + regs[r4];
             T2 = regs[r3] + regs[r5] + (T1 < regs[r2]);
             regs[r0] = T1;
             regs[r1] = T2;
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_add2_i64
-        case INDEX_op_sub2_i64:
+        CASE_OP(sub2_i64)
             tci_args_rrrrrr(insn, &r0, &r1, &r2, &r3, &r4, &r5);
             T1 = regs[r2] - regs[r4];
             T2 = regs[r3] - regs[r5] - (regs[r2] < regs[r4]);
             regs[r0] = T1;
             regs[r1] = T2;
-            break;
+            TCI_NEXT();
 #endif
 
             /* Shift/rotate operations (64 bit). */
 
-        case INDEX_op_shl_i64:
+        CASE_OP(shl_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] << (regs[r2] & 63);
-            break;
-        case INDEX_op_shr_i64:
+            TCI_NEXT();
+        CASE_OP(shr_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] >> (regs[r2] & 63);
-            break;
-        case INDEX_op_sar_i64:
+            TCI_NEXT();
+        CASE_OP(sar_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int64_t)regs[r1] >> (regs[r2] & 63);
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_HAS_rot_i64
-        case INDEX_op_rotl_i64:
+        CASE_OP(rotl_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = rol64(regs[r1], regs[r2] & 63);
-            break;
-        case INDEX_op_rotr_i64:
+            TCI_NEXT();
+        CASE_OP(rotr_i64)
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ror64(regs[r1], regs[r2] & 63);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_deposit_i64
-        case INDEX_op_deposit_i64:
+        CASE_OP(deposit_i64)
             tci_args_rrrbb(insn, &r0, &r1, &r2, &pos, &len);
             regs[r0] = deposit64(regs[r1], pos, len, regs[r2]);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_extract_i64
-        case INDEX_op_extract_i64:
+        CASE_OP(extract_i64)
             tci_args_rrbb(insn, &r0, &r1, &pos, &len);
             regs[r0] = extract64(regs[r1], pos, len);
-            break;
+            TCI_NEXT();
 #endif
 #if TCG_TARGET_HAS_sextract_i64
-        case INDEX_op_sextract_i64:
+        CASE_OP(sextract_i64)
             tci_args_rrbb(insn, &r0, &r1, &pos, &len);
             regs[r0] = sextract64(regs[r1], pos, len);
-            break;
+            TCI_NEXT();
 #endif
-        case INDEX_op_brcond_i64:
+        CASE_OP(brcond_i64)
             tci_args_rl(insn, tb_ptr, &r0, &ptr);
             if (regs[r0]) {
                 tb_ptr = ptr;
             }
-            break;
-        case INDEX_op_ext32s_i64:
-        case INDEX_op_ext_i32_i64:
+            TCI_NEXT();
+        CASE_OP(tci_brcond_i64)
+            tb_ptr = tci_args_rrcl(insn, tb_ptr, &r0, &r1, &condition, &ptr);
+            if (tci_compare64(regs[r0], regs[r1], condition)) {
+                tb_ptr = ptr;
+            }
+            TCI_NEXT();
+        CASE_OP(tci_brcondi_i64)
+            tb_ptr = tci_args_rcil(insn, tb_ptr, &r0, &condition, &t1, &ptr);
+            if (tci_compare64(regs[r0], t1, condition)) {
+                tb_ptr = ptr;
+            }
+            TCI_NEXT();
+        CASE_OP(ext32s_i64)
+        CASE_OP(ext_i32_i64)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (int32_t)regs[r1];
-            break;
-        case INDEX_op_ext32u_i64:
-        case INDEX_op_extu_i32_i64:
+            TCI_NEXT();
+        CASE_OP(ext32u_i64)
+        CASE_OP(extu_i32_i64)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (uint32_t)regs[r1];
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_HAS_bswap64_i64
-        case INDEX_op_bswap64_i64:
+        CASE_OP(bswap64_i64)
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = bswap64(regs[r1]);
-            break;
+            TCI_NEXT();
 #endif
 #endif /* TCG_TARGET_REG_BITS == 64 */
 
             /* QEMU specific operations. */
 
-        case INDEX_op_exit_tb:
+        CASE_OP(exit_tb)
             tci_args_l(insn, tb_ptr, &ptr);
             return (uintptr_t)ptr;
 
-        case INDEX_op_goto_tb:
+        CASE_OP(goto_tb)
             tci_args_l(insn, tb_ptr, &ptr);
             tb_ptr = *(void **)ptr;
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_goto_ptr:
+        CASE_OP(goto_ptr)
             tci_args_r(insn, &r0);
             ptr = (void *)regs[r0];
             if (!ptr) {
                 return 0;
             }
             tb_ptr = ptr;
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_ld_a32_i32:
+        CASE_OP(qemu_ld_a32_i32)
             tci_args_rrm(insn, &r0, &r1, &oi);
             taddr = (uint32_t)regs[r1];
             goto do_ld_i32;
-        case INDEX_op_qemu_ld_a64_i32:
+        CASE_OP(qemu_ld_a64_i32)
             if (TCG_TARGET_REG_BITS == 64) {
                 tci_args_rrm(insn, &r0, &r1, &oi);
                 taddr = regs[r1];
@@ -937,9 +1220,9 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             }
         do_ld_i32:
             regs[r0] = tci_qemu_ld(env, taddr, oi, tb_ptr);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_ld_a32_i64:
+        CASE_OP(qemu_ld_a32_i64)
             if (TCG_TARGET_REG_BITS == 64) {
                 tci_args_rrm(insn, &r0, &r1, &oi);
                 taddr = (uint32_t)regs[r1];
@@ -949,7 +1232,7 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
                 oi = regs[r3];
             }
             goto do_ld_i64;
-        case INDEX_op_qemu_ld_a64_i64:
+        CASE_OP(qemu_ld_a64_i64)
             if (TCG_TARGET_REG_BITS == 64) {
                 tci_args_rrm(insn, &r0, &r1, &oi);
                 taddr = regs[r1];
@@ -965,13 +1248,13 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             } else {
                 regs[r0] = tmp64;
             }
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_st_a32_i32:
+        CASE_OP(qemu_st_a32_i32)
             tci_args_rrm(insn, &r0, &r1, &oi);
             taddr = (uint32_t)regs[r1];
             goto do_st_i32;
-        case INDEX_op_qemu_st_a64_i32:
+        CASE_OP(qemu_st_a64_i32)
             if (TCG_TARGET_REG_BITS == 64) {
                 tci_args_rrm(insn, &r0, &r1, &oi);
                 taddr = regs[r1];
@@ -982,9 +1265,9 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             }
         do_st_i32:
             tci_qemu_st(env, taddr, regs[r0], oi, tb_ptr);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_st_a32_i64:
+        CASE_OP(qemu_st_a32_i64)
             if (TCG_TARGET_REG_BITS == 64) {
                 tci_args_rrm(insn, &r0, &r1, &oi);
                 tmp64 = regs[r0];
@@ -996,7 +1279,7 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
                 oi = regs[r3];
             }
             goto do_st_i64;
-        case INDEX_op_qemu_st_a64_i64:
+        CASE_OP(qemu_st_a64_i64)
             if (TCG_TARGET_REG_BITS == 64) {
                 tci_args_rrm(insn, &r0, &r1, &oi);
                 tmp64 = regs[r0];
@@ -1009,13 +1292,14 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             }
         do_st_i64:
             tci_qemu_st(env, taddr, tmp64, oi, tb_ptr);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_mb:
+        CASE_OP(mb)
             /* Ensure ordering for all kinds */
             smp_mb();
-            break;
+            TCI_NEXT();
         default:
+        TCI_LABEL(illegal)
             g_assert_not_reached();
         }
     }
@@ -1113,6 +1397,21 @@ int print_insn_tci(bfd_vma addr, disassemble_info *info)
                            op_name, str_r(r0), ptr);
         break;
 
+    case INDEX_op_tci_brcond_i32:
+    case INDEX_op_tci_brcond_i64:
+        tci_args_rrcl(insn, tb_ptr, &r0, &r1, &c, &ptr);
+        info->fprintf_func(info->stream, "%-12s  %s, %s, %s, %p",
+                           op_name, str_r(r0), str_r(r1), str_c(c), ptr);
+        return 2 * sizeof(insn);
+
+    case INDEX_op_tci_brcondi_i32:
+    case INDEX_op_tci_brcondi_i64:
+        tci_args_rcil(insn, tb_ptr, &r0, &c, &i1, &ptr);
+        info->fprintf_func(info->stream, "%-12s  %s, %" TCG_PRIld ", %s, %p",
+                           op_name, str_r(r0), (tcg_target_long)i1,
+                           str_c(c), ptr);
+        return 2 * sizeof(insn);
+
     case INDEX_op_setcond_i32:
     case INDEX_op_setcond_i64:
         tci_args_rrrc(insn, &r0, &r1, &r2, &c);
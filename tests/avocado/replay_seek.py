@@ -0,0 +1,140 @@
+# Record/replay test that seeks through periodic snapshots
+#
+# This work is licensed under the terms of the GNU GPL, version 2 or
+# later.  See the COPYING file in the top-level directory.
+import os
+import re
+import time
+import logging
+
+from avocado_qemu import BUILD_DIR
+from avocado.utils import datadrainer
+from avocado.utils import process
+from avocado.utils.path import find_command
+from boot_linux_console import LinuxKernelTest
+
+class ReplaySeek(LinuxKernelTest):
+    """
+    Records the boot of a kernel with an initial VM snapshot, then
+    replays it with rrsnapshot-period, checks that the periodic
+    snapshots were created, and seeks backwards and forwards in the
+    recording with replay-seek.
+    """
+
+    timeout = 120
+    PERIOD = 10000000
+    RECORD_STEPS = 10 * PERIOD
+
+    def run_vm(self, record, shift, args, replay_path, image_path):
+        logger = logging.getLogger('replay')
+        vm = self.get_vm()
+        vm.set_console()
+        if record:
+            logger.info('recording the execution...')
+            mode = 'record'
+            period = ''
+        else:
+            logger.info('replaying the execution...')
+            mode = 'replay'
+            period = ',rrsnapshot-period=%d' % self.PERIOD
+            vm.add_args('-S')
+        vm.add_args('-icount', 'shift=%s,rr=%s,rrfile=%s,rrsnapshot=init%s' %
+                    (shift, mode, replay_path, period),
+                    '-net', 'none')
+        vm.add_args('-drive', 'file=%s,if=none' % image_path)
+        if args:
+            vm.add_args(*args)
+        vm.launch()
+        console_drainer = datadrainer.LineLogger(vm.console_socket.fileno(),
+                                    logger=self.log.getChild('console'),
+                                    stop_check=(lambda : not vm.is_running()))
+        console_drainer.start()
+        return vm
+
+    @staticmethod
+    def vm_get_icount(vm):
+        return vm.qmp('query-replay')['return']['icount']
+
+    @staticmethod
+    def vm_wait_paused(vm):
+        while vm.qmp('query-status')['return']['status'] != 'paused':
+            time.sleep(0.1)
+
+    def vm_snapshots(self, vm):
+        info = vm.cmd('human-monitor-command', command_line='info snapshots')
+        return sorted(int(n) for n in re.findall(r'\breplay-(\d+)\b', info))
+
+    def seek(self, vm, icount):
+        logger = logging.getLogger('replay')
+        logger.info('seeking to icount %d' % icount)
+        vm.cmd('replay-seek', icount=icount)
+        self.vm_wait_paused(vm)
+        self.assertEqual(self.vm_get_icount(vm), icount)
+
+    def replay_seek(self, shift=7, args=None):
+        logger = logging.getLogger('replay')
+
+        # create qcow2 for snapshots
+        logger.info('creating qcow2 image for VM snapshots')
+        image_path = os.path.join(self.workdir, 'disk.qcow2')
+        qemu_img = os.path.join(BUILD_DIR, 'qemu-img')
+        if not os.path.exists(qemu_img):
+            qemu_img = find_command('qemu-img', False)
+        if qemu_img is False:
+            self.cancel('Could not find "qemu-img", which is required to '
+                        'create the temporary qcow2 image')
+        cmd = '%s create -f qcow2 %s 128M' % (qemu_img, image_path)
+        process.run(cmd)
+
+        replay_path = os.path.join(self.workdir, 'replay.bin')
+
+        # record the log
+        vm = self.run_vm(True, shift, args, replay_path, image_path)
+        while self.vm_get_icount(vm) <= self.RECORD_STEPS:
+            time.sleep(0.1)
+        last_icount = self.vm_get_icount(vm)
+        vm.shutdown()
+
+        logger.info('recorded log with %s+ steps' % last_icount)
+
+        # replay to the end, taking the periodic snapshots
+        vm = self.run_vm(False, shift, args, replay_path, image_path)
+        vm.cmd('replay-break', icount=last_icount - 1)
+        vm.cmd('cont')
+        self.vm_wait_paused(vm)
+        self.assertEqual(self.vm_get_icount(vm), last_icount - 1)
+
+        snapshots = self.vm_snapshots(vm)
+        logger.info('periodic snapshots at %s' % snapshots)
+        self.assertTrue(snapshots, 'no periodic snapshot was created')
+        previous = 0
+        for icount in snapshots:
+            self.assertGreaterEqual(icount - previous, self.PERIOD)
+            previous = icount
+
+        # seek back between two snapshots, before the first periodic
+        # one, and forward again
+        self.seek(vm, snapshots[-1] - self.PERIOD // 2)
+        self.seek(vm, snapshots[0] // 2)
+        self.seek(vm, last_icount - 2)
+
+        # seeking must not create the snapshots again
+        self.assertEqual(self.vm_snapshots(vm)[:len(snapshots)], snapshots)
+
+        vm.shutdown()
+
+    def test_aarch64_virt(self):
+        """
+        :avocado: tags=accel:tcg
+        :avocado: tags=arch:aarch64
+        :avocado: tags=machine:virt
+        :avocado: tags=cpu:cortex-a53
+        """
+        kernel_url = ('https://archives.fedoraproject.org/pub/archive/fedora'
+                      '/linux/releases/29/Everything/aarch64/os/images/pxeboot'
+                      '/vmlinuz')
+        kernel_hash = '8c73e469fc6ea06a58dc83a628fc695b693b8493'
+        kernel_path = self.fetch_asset(kernel_url, asset_hash=kernel_hash)
+
+        self.replay_seek(args=('-kernel', kernel_path,
+                               '-append', 'console=ttyAMA0'))
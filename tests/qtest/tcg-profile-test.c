@@ -0,0 +1,81 @@
+/*
+ * QTest testcase for the TCG sampling profiler
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+/* Wait this long for the firmware to be sampled, in tenths of a second */
+#define PROFILE_TIMEOUT 100
+
+static char *query_profile(QTestState *qts)
+{
+    QDict *resp, *ret;
+    char *text;
+
+    resp = qtest_qmp(qts, "{ 'execute': 'x-query-profile' }");
+    ret = qdict_get_qdict(resp, "return");
+    g_assert(ret);
+    text = g_strdup(qdict_get_str(ret, "human-readable-text"));
+    qobject_unref(resp);
+    return text;
+}
+
+static void test_profile(void)
+{
+    g_autoptr(GRegex) re = NULL;
+    g_autofree char *text = NULL;
+    g_auto(GStrv) lines = NULL;
+    QTestState *qts;
+
+    qts = qtest_init("-M pc -nodefaults -accel tcg");
+
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-profile-start', "
+                             "'arguments': { 'interval-us': 100 } }");
+    for (int i = 0; i < PROFILE_TIMEOUT; i++) {
+        g_free(text);
+        text = query_profile(qts);
+        if (text[0]) {
+            break;
+        }
+        g_usleep(100 * 1000);
+    }
+    qtest_qmp_assert_success(qts, "{ 'execute': 'x-profile-stop' }");
+
+    /* One folded stack per line: cpuN;frame;... count */
+    g_assert_cmpstr(text, !=, "");
+    re = g_regex_new("^cpu[0-9]+(;[^; ]+)+ [1-9][0-9]*$", 0, 0, NULL);
+    lines = g_strsplit(text, "\n", -1);
+    for (int i = 0; lines[i]; i++) {
+        if (lines[i + 1] == NULL) {
+            /* The text ends with a newline. */
+            g_assert_cmpstr(lines[i], ==, "");
+            break;
+        }
+        g_assert(g_regex_match(re, lines[i], 0, NULL));
+    }
+
+    /* The samples are kept until the next start. */
+    g_free(text);
+    text = query_profile(qts);
+    g_assert_cmpstr(text, !=, "");
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    if (!qtest_has_accel("tcg")) {
+        g_test_skip("TCG is not available");
+        return g_test_run();
+    }
+
+    qtest_add_func("tcg/profile", test_profile);
+
+    return g_test_run();
+}
@@ -0,0 +1,126 @@
+/*
+ * Check SVE instructions that are expanded with the generic vector
+ * (gvec) infrastructure against a scalar reference, at each vector
+ * length.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#define MAX_VL  256
+
+typedef void VecFn(uint8_t *d, const uint8_t *a, const uint8_t *b);
+typedef void RefFn(uint8_t *d, const uint8_t *a, const uint8_t *b, int vl);
+
+#define VEC_OP(NAME, INSN)                                              \
+    static void vec_##NAME(uint8_t *d, const uint8_t *a,               \
+                           const uint8_t *b)                            \
+    {                                                                   \
+        asm volatile("ldr z1, [%1]\n\t"                                 \
+                     "ldr z2, [%2]\n\t"                                 \
+                     INSN "\n\t"                                        \
+                     "str z0, [%0]"                                     \
+                     : : "r"(d), "r"(a), "r"(b)                         \
+                     : "x9", "z0", "z1", "z2", "memory");               \
+    }
+
+#define REF_OP(NAME, TYPE, EXPR)                                        \
+    static void ref_##NAME(uint8_t *d, const uint8_t *a,               \
+                           const uint8_t *b, int vl)                    \
+    {                                                                   \
+        for (int i = 0; i < vl / (int)sizeof(TYPE); i++) {             \
+            TYPE x, y, r;                                               \
+            memcpy(&x, a + i * sizeof(TYPE), sizeof(TYPE));             \
+            memcpy(&y, b + i * sizeof(TYPE), sizeof(TYPE));             \
+            r = (EXPR);                                                 \
+            memcpy(d + i * sizeof(TYPE), &r, sizeof(TYPE));             \
+        }                                                               \
+    }
+
+VEC_OP(add_b, "add z0.b, z1.b, z2.b")
+REF_OP(add_b, uint8_t, x + y)
+
+VEC_OP(sub_s, "sub z0.s, z1.s, z2.s")
+REF_OP(sub_s, uint32_t, x - y)
+
+VEC_OP(and_d, "and z0.d, z1.d, z2.d")
+REF_OP(and_d, uint64_t, x & y)
+
+VEC_OP(eor_d, "eor z0.d, z1.d, z2.d")
+REF_OP(eor_d, uint64_t, x ^ y)
+
+VEC_OP(bic_d, "bic z0.d, z1.d, z2.d")
+REF_OP(bic_d, uint64_t, x & ~y)
+
+VEC_OP(lsl_h, "lsl z0.h, z1.h, #3")
+REF_OP(lsl_h, uint16_t, x << 3)
+
+VEC_OP(asr_s, "asr z0.s, z1.s, #5")
+REF_OP(asr_s, int32_t, x >> 5)
+
+VEC_OP(sqadd_b, "sqadd z0.b, z1.b, z2.b")
+REF_OP(sqadd_b, int8_t,
+       x + y > INT8_MAX ? INT8_MAX : x + y < INT8_MIN ? INT8_MIN : x + y)
+
+VEC_OP(uqsub_h, "uqsub z0.h, z1.h, z2.h")
+REF_OP(uqsub_h, uint16_t, x > y ? x - y : 0)
+
+VEC_OP(dup_s, "ldr w9, [%2]\n\tdup z0.s, w9")
+
+static void ref_dup_s(uint8_t *d, const uint8_t *a, const uint8_t *b, int vl)
+{
+    for (int i = 0; i < vl; i += 4) {
+        memcpy(d + i, b, 4);
+    }
+}
+
+static const struct {
+    const char *name;
+    VecFn *vec;
+    RefFn *ref;
+} ops[] = {
+#define OP(NAME) { #NAME, vec_##NAME, ref_##NAME }
+    OP(add_b), OP(sub_s), OP(and_d), OP(eor_d), OP(bic_d),
+    OP(lsl_h), OP(asr_s), OP(sqadd_b), OP(uqsub_h), OP(dup_s),
+#undef OP
+};
+
+static uint8_t a[MAX_VL], b[MAX_VL], d[MAX_VL], r[MAX_VL];
+
+int main(void)
+{
+    /* Powers of 2, and sizes that need a 32 or 16-byte tail. */
+    static const int vls[] = { 16, 32, 48, 64, 80, 128, 160, 256 };
+    int err = 0;
+
+    for (int i = 0; i < MAX_VL; i++) {
+        a[i] = i * 37 + 11;
+        b[i] = i * 101 + 7;
+    }
+
+    for (int v = 0; v < sizeof(vls) / sizeof(vls[0]); v++) {
+        int vl = vls[v];
+        int got = prctl(PR_SVE_SET_VL, vl);
+
+        if (got < 0 || (got & PR_SVE_VL_LEN_MASK) != vl) {
+            continue;
+        }
+
+        for (int o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+            memset(d, 0, sizeof(d));
+            memset(r, 0, sizeof(r));
+            ops[o].vec(d, a, b);
+            ops[o].ref(r, a, b, vl);
+            if (memcmp(d, r, sizeof(d))) {
+                fprintf(stderr, "vl %d: %s mismatch\n", vl, ops[o].name);
+                err = 1;
+            }
+        }
+    }
+
+    return err;
+}
@@ -0,0 +1,85 @@
+/*
+ * Check that x87 fadd, fmul, fdiv and fsqrt raise the precision
+ * exception exactly when the result is rounded.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PE  0x20
+
+static uint16_t fnstsw(void)
+{
+    uint16_t sw;
+
+    __asm__ volatile ("fnstsw %0" : "=a" (sw));
+    return sw;
+}
+
+static void fnclex(void)
+{
+    __asm__ volatile ("fnclex");
+}
+
+static long double x87_add(long double a, long double b)
+{
+    __asm__ volatile ("faddp" : "+t" (a) : "u" (b) : "st(1)");
+    return a;
+}
+
+static long double x87_mul(long double a, long double b)
+{
+    __asm__ volatile ("fmulp" : "+t" (a) : "u" (b) : "st(1)");
+    return a;
+}
+
+static long double x87_div(long double a, long double b)
+{
+    __asm__ volatile ("fdivp" : "+t" (a) : "u" (b) : "st(1)");
+    return a;
+}
+
+static long double x87_sqrt(long double a, long double b)
+{
+    __asm__ volatile ("fsqrt" : "+t" (a));
+    return a;
+}
+
+static const struct {
+    const char *name;
+    long double (*fn)(long double, long double);
+    long double a, b, r;
+    int pe;
+} checks[] = {
+    { "fadd exact", x87_add, 1.5L, 2.25L, 3.75L, 0 },
+    { "fadd inexact", x87_add, 1.0L, 0x1p-70L, 1.0L, PE },
+    { "fmul exact", x87_mul, 3.0L, -0.5L, -1.5L, 0 },
+    { "fmul inexact", x87_mul, 1.0L + 0x1p-63L, 1.0L + 0x1p-63L,
+      1.0L + 0x1p-62L, PE },
+    { "fdiv exact", x87_div, 6.0L, 3.0L, 2.0L, 0 },
+    { "fdiv inexact", x87_div, 1.0L, 3.0L, 0xa.aaaaaaaaaaaaaabp-5L, PE },
+    { "fsqrt exact", x87_sqrt, 16.0L, 0, 4.0L, 0 },
+    { "fsqrt inexact", x87_sqrt, 2.0L, 0, 0xb.504f333f9de6484p-3L, PE },
+};
+
+int main(void)
+{
+    int ret = 0;
+
+    for (int i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        long double r;
+        int pe;
+
+        fnclex();
+        r = checks[i].fn(checks[i].a, checks[i].b);
+        pe = fnstsw() & PE;
+        if (r != checks[i].r || pe != checks[i].pe) {
+            printf("FAIL: %s: result %La, PE %d\n", checks[i].name, r, !!pe);
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
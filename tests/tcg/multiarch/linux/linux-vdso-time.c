@@ -0,0 +1,44 @@
+/*
+ * Check that the results of clock_gettime(), gettimeofday() and time()
+ * are consistent, whether they come from the vDSO or a system call.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <assert.h>
+#include <time.h>
+#include <sys/time.h>
+
+static long long ts_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+int main(void)
+{
+    struct timespec ts, prev;
+    struct timeval tv;
+    time_t t;
+
+    assert(clock_gettime(CLOCK_MONOTONIC, &prev) == 0);
+    for (int i = 0; i < 1000; i++) {
+        assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+        assert(ts.tv_nsec >= 0 && ts.tv_nsec < 1000000000);
+        assert(ts_ns(&ts) >= ts_ns(&prev));
+        prev = ts;
+    }
+
+    assert(clock_getres(CLOCK_MONOTONIC, &ts) == 0);
+    assert(ts.tv_sec == 0 && ts.tv_nsec > 0);
+
+    assert(clock_gettime(CLOCK_REALTIME, &ts) == 0);
+    assert(gettimeofday(&tv, NULL) == 0);
+    t = time(NULL);
+    assert(tv.tv_sec >= ts.tv_sec && tv.tv_sec - ts.tv_sec <= 1);
+    assert(t >= tv.tv_sec && t - tv.tv_sec <= 1);
+
+    /* An invalid clock is reported, not ignored. */
+    assert(clock_gettime(-1000, &ts) != 0);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Change memory mappings from several threads at once.
+ *
+ * Each thread owns a few pages of a shared reservation.  It repeatedly
+ * maps them with MAP_FIXED, fills them, changes their protection,
+ * passes them to a system call and unmaps them, so that the changes
+ * of neighbouring ranges, which may share host pages, run in parallel.
+ * It also checks that a page of another range never appears to be
+ * mapped by a system call while it is not, and that an address that
+ * is never mapped stays unmapped.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define NR_THREADS   4
+#define REGION_PAGES 3
+#define ITERS        500
+
+static char *base, *hole;
+static size_t page_size;
+static int devnull;
+
+static void *thread_func(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    size_t len = REGION_PAGES * page_size;
+    char *p = base + id * len;
+
+    for (int i = 0; i < ITERS; i++) {
+        ssize_t n;
+        char *q;
+        int ret;
+
+        q = mmap(p, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        assert(q == p);
+        memset(p, id + i, len);
+
+        ret = mprotect(p + page_size, page_size, PROT_READ);
+        assert(ret == 0);
+        assert(p[page_size] == (char)(id + i));
+
+        /* qemu has to find all of the buffer mapped... */
+        n = write(devnull, p, len);
+        assert(n == (ssize_t)len);
+
+        /* ... and the hole unmapped. */
+        ret = access(hole, F_OK);
+        assert(ret == -1 && errno == EFAULT);
+
+        ret = munmap(p, len);
+        assert(ret == 0);
+
+        ret = access(p, F_OK);
+        assert(ret == -1 && errno == EFAULT);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t threads[NR_THREADS];
+    int ret;
+
+    page_size = getpagesize();
+    devnull = open("/dev/null", O_WRONLY);
+    assert(devnull >= 0);
+
+    /* Reserve the ranges of the threads, followed by a hole. */
+    base = mmap(NULL, (NR_THREADS * REGION_PAGES + 2) * page_size,
+                PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(base != MAP_FAILED);
+    hole = base + NR_THREADS * REGION_PAGES * page_size;
+    ret = munmap(hole, page_size);
+    assert(ret == 0);
+
+    for (uintptr_t i = 0; i < NR_THREADS; i++) {
+        ret = pthread_create(&threads[i], NULL, thread_func, (void *)i);
+        assert(ret == 0);
+    }
+    for (int i = 0; i < NR_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    return 0;
+}
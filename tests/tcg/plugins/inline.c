@@ -10,6 +10,7 @@
 #include <glib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <qemu-plugin.h>
 
@@ -24,6 +25,8 @@ typedef struct {
     uint64_t tb_cond_track_count;
     uint64_t insn_cond_num_trigger;
     uint64_t insn_cond_track_count;
+    uint64_t count_insn_trace;
+    uint64_t count_mem_trace;
 } CPUCount;
 
 static const uint64_t cond_trigger_limit = 100;
@@ -45,11 +48,48 @@ static qemu_plugin_u64 tb_cond_num_trigger;
 static qemu_plugin_u64 tb_cond_track_count;
 static qemu_plugin_u64 insn_cond_num_trigger;
 static qemu_plugin_u64 insn_cond_track_count;
+static qemu_plugin_u64 count_insn_trace;
+static qemu_plugin_u64 count_mem_trace;
 static struct qemu_plugin_scoreboard *data;
 static qemu_plugin_u64 data_insn;
 static qemu_plugin_u64 data_tb;
 static qemu_plugin_u64 data_mem;
 
+/*
+ * Indexed ops, each checked against a copy kept by a callback: min, max
+ * and a bitmap of executed TB addresses, and a count and a bitmap of
+ * memory accesses by address.
+ */
+#define TB_BITMAP_SHIFT 2
+#define MEM_BUCKET_SHIFT 12
+#define MEM_BITMAP_SHIFT 6
+#define N_BUCKETS 64
+#define N_BITS 256
+
+typedef struct {
+    uint64_t tb_min;
+    uint64_t tb_max;
+    uint64_t tb_bitmap[N_BITS / 64];
+    uint64_t mem_buckets[N_BUCKETS];
+    uint64_t mem_bitmap[N_BITS / 64];
+} IndexedData;
+
+typedef struct {
+    IndexedData inl;
+    IndexedData cb;
+} CPUIndexed;
+
+static struct qemu_plugin_scoreboard *indexed;
+static qemu_plugin_u64 tb_min;
+static qemu_plugin_u64 tb_max;
+static qemu_plugin_u64 tb_bitmap;
+static qemu_plugin_u64 mem_buckets;
+static qemu_plugin_u64 mem_bitmap;
+
+enum { TRACE_INSN = 1, TRACE_MEM = 2 };
+/* created with the smallest size, to be drained as often as possible */
+static struct qemu_plugin_trace_buffer *trace;
+
 static uint64_t global_count_tb;
 static uint64_t global_count_insn;
 static uint64_t global_count_mem;
@@ -71,16 +111,19 @@ static void stats_insn(void)
     const uint64_t cond_track_left = qemu_plugin_u64_sum(insn_cond_track_count);
     const uint64_t conditional =
         cond_num_trigger * cond_trigger_limit + cond_track_left;
+    const uint64_t traced = qemu_plugin_u64_sum(count_insn_trace);
     g_autoptr(GString) stats = g_string_new("");
     g_string_append_printf(stats, "insn: %" PRIu64 "\n", expected);
     g_string_append_printf(stats, "insn: %" PRIu64 " (per vcpu)\n", per_vcpu);
     g_string_append_printf(stats, "insn: %" PRIu64 " (per vcpu inline)\n", inl_per_vcpu);
     g_string_append_printf(stats, "insn: %" PRIu64 " (cond cb)\n", conditional);
+    g_string_append_printf(stats, "insn: %" PRIu64 " (trace)\n", traced);
     qemu_plugin_outs(stats->str);
     g_assert(expected > 0);
     g_assert(per_vcpu == expected);
     g_assert(inl_per_vcpu == expected);
     g_assert(conditional == expected);
+    g_assert(traced == expected);
 }
 
 static void stats_tb(void)
@@ -111,14 +154,29 @@ static void stats_mem(void)
     const uint64_t per_vcpu = qemu_plugin_u64_sum(count_mem);
     const uint64_t inl_per_vcpu =
         qemu_plugin_u64_sum(count_mem_inline);
+    const uint64_t traced = qemu_plugin_u64_sum(count_mem_trace);
     g_autoptr(GString) stats = g_string_new("");
     g_string_append_printf(stats, "mem: %" PRIu64 "\n", expected);
     g_string_append_printf(stats, "mem: %" PRIu64 " (per vcpu)\n", per_vcpu);
     g_string_append_printf(stats, "mem: %" PRIu64 " (per vcpu inline)\n", inl_per_vcpu);
+    g_string_append_printf(stats, "mem: %" PRIu64 " (trace)\n", traced);
     qemu_plugin_outs(stats->str);
     g_assert(expected > 0);
     g_assert(per_vcpu == expected);
     g_assert(inl_per_vcpu == expected);
+    g_assert(traced == expected);
+}
+
+static void stats_indexed(unsigned int cpu_index)
+{
+    CPUIndexed *d = qemu_plugin_scoreboard_find(indexed, cpu_index);
+    uint64_t mem = 0;
+
+    for (int i = 0; i < N_BUCKETS; i++) {
+        mem += d->inl.mem_buckets[i];
+    }
+    g_assert(mem == qemu_plugin_u64_get(count_mem, cpu_index));
+    g_assert(memcmp(&d->inl, &d->cb, sizeof(d->inl)) == 0);
 }
 
 static void plugin_exit(qemu_plugin_id_t id, void *udata)
@@ -127,6 +185,8 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
     g_autoptr(GString) stats = g_string_new("");
     g_assert(num_cpus == max_cpu_index + 1);
 
+    qemu_plugin_trace_buffer_flush(trace);
+
     for (int i = 0; i < num_cpus ; ++i) {
         const uint64_t tb = qemu_plugin_u64_get(count_tb, i);
         const uint64_t tb_inline = qemu_plugin_u64_get(count_tb_inline, i);
@@ -142,36 +202,89 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
             qemu_plugin_u64_get(insn_cond_num_trigger, i);
         const uint64_t insn_cond_left =
             qemu_plugin_u64_get(insn_cond_track_count, i);
+        const uint64_t insn_trace = qemu_plugin_u64_get(count_insn_trace, i);
+        const uint64_t mem_trace = qemu_plugin_u64_get(count_mem_trace, i);
         g_string_printf(stats, "cpu %d: tb (%" PRIu64 ", %" PRIu64
                         ", %" PRIu64 " * %" PRIu64 " + %" PRIu64
                         ") | "
                         "insn (%" PRIu64 ", %" PRIu64
                         ", %" PRIu64 " * %" PRIu64 " + %" PRIu64
-                        ") | "
-                        "mem (%" PRIu64 ", %" PRIu64 ")"
+                        ", %" PRIu64 ") | "
+                        "mem (%" PRIu64 ", %" PRIu64 ", %" PRIu64 ")"
                         "\n",
                         i,
                         tb, tb_inline,
                         tb_cond_trigger, cond_trigger_limit, tb_cond_left,
                         insn, insn_inline,
                         insn_cond_trigger, cond_trigger_limit, insn_cond_left,
-                        mem, mem_inline);
+                        insn_trace,
+                        mem, mem_inline, mem_trace);
         qemu_plugin_outs(stats->str);
         g_assert(tb == tb_inline);
         g_assert(insn == insn_inline);
         g_assert(mem == mem_inline);
+        g_assert(insn == insn_trace);
+        g_assert(mem == mem_trace);
         g_assert(tb_cond_trigger == tb / cond_trigger_limit);
         g_assert(tb_cond_left == tb % cond_trigger_limit);
         g_assert(insn_cond_trigger == insn / cond_trigger_limit);
         g_assert(insn_cond_left == insn % cond_trigger_limit);
+        stats_indexed(i);
     }
 
     stats_tb();
     stats_insn();
     stats_mem();
 
+    qemu_plugin_trace_buffer_free(trace);
     qemu_plugin_scoreboard_free(counts);
     qemu_plugin_scoreboard_free(data);
+    qemu_plugin_scoreboard_free(indexed);
+}
+
+static void vcpu_init(qemu_plugin_id_t id, unsigned int cpu_index)
+{
+    CPUIndexed *d = qemu_plugin_scoreboard_find(indexed, cpu_index);
+
+    d->inl.tb_min = d->cb.tb_min = UINT64_MAX;
+}
+
+static void set_bit(uint64_t *bitmap, uint64_t bit)
+{
+    bitmap[bit / 64] |= 1ull << (bit % 64);
+}
+
+static void vcpu_tb_exec_indexed(unsigned int cpu_index, void *udata)
+{
+    CPUIndexed *d = qemu_plugin_scoreboard_find(indexed, cpu_index);
+    uint64_t vaddr = (uintptr_t) udata;
+
+    d->cb.tb_min = MIN(d->cb.tb_min, vaddr);
+    d->cb.tb_max = MAX(d->cb.tb_max, vaddr);
+    set_bit(d->cb.tb_bitmap, (vaddr >> TB_BITMAP_SHIFT) % N_BITS);
+}
+
+static void trace_drain(unsigned int cpu_index,
+                        const qemu_plugin_trace_record *records,
+                        size_t n, void *udata)
+{
+    g_assert(n > 0);
+    for (size_t i = 0; i < n; i++) {
+        const qemu_plugin_trace_record *r = &records[i];
+
+        switch (r->flags) {
+        case TRACE_INSN:
+            g_assert(r->vaddr == 0 && r->info == 0);
+            qemu_plugin_u64_add(count_insn_trace, cpu_index, 1);
+            break;
+        case TRACE_MEM:
+            g_assert(r->info != 0);
+            qemu_plugin_u64_add(count_mem_trace, cpu_index, 1);
+            break;
+        default:
+            g_assert_not_reached();
+        }
+    }
 }
 
 static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
@@ -216,8 +329,12 @@ static void vcpu_mem_access(unsigned int cpu_index,
                             uint64_t vaddr,
                             void *udata)
 {
+    CPUIndexed *d = qemu_plugin_scoreboard_find(indexed, cpu_index);
+
     qemu_plugin_u64_add(count_mem, cpu_index, 1);
     g_assert(qemu_plugin_u64_get(data_mem, cpu_index) == (uintptr_t) udata);
+    d->cb.mem_buckets[(vaddr >> MEM_BUCKET_SHIFT) % N_BUCKETS]++;
+    set_bit(d->cb.mem_bitmap, (vaddr >> MEM_BITMAP_SHIFT) % N_BITS);
     g_mutex_lock(&mem_lock);
     global_count_mem++;
     g_mutex_unlock(&mem_lock);
@@ -226,6 +343,7 @@ static void vcpu_mem_access(unsigned int cpu_index,
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 {
     void *tb_store = tb;
+    uint64_t tb_vaddr = qemu_plugin_tb_vaddr(tb);
     qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
         tb, QEMU_PLUGIN_INLINE_STORE_U64, data_tb, (uintptr_t) tb_store);
     qemu_plugin_register_vcpu_tb_exec_cb(
@@ -239,6 +357,17 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
         tb, vcpu_tb_cond_exec, QEMU_PLUGIN_CB_NO_REGS,
         QEMU_PLUGIN_COND_EQ, tb_cond_track_count, cond_trigger_limit, tb_store);
 
+    qemu_plugin_register_vcpu_tb_exec_cb(
+        tb, vcpu_tb_exec_indexed, QEMU_PLUGIN_CB_NO_REGS,
+        (void *)(uintptr_t) tb_vaddr);
+    qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+        tb, QEMU_PLUGIN_INLINE_MIN_U64, tb_min, tb_vaddr);
+    qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+        tb, QEMU_PLUGIN_INLINE_MAX_U64, tb_max, tb_vaddr);
+    qemu_plugin_register_vcpu_tb_exec_inline_indexed_per_vcpu(
+        tb, QEMU_PLUGIN_INLINE_SET_BIT, tb_bitmap,
+        TB_BITMAP_SHIFT, N_BITS, 0);
+
     for (int idx = 0; idx < qemu_plugin_tb_n_insns(tb); ++idx) {
         struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, idx);
         void *insn_store = insn;
@@ -270,6 +399,17 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
             insn, QEMU_PLUGIN_MEM_RW,
             QEMU_PLUGIN_INLINE_ADD_U64,
             count_mem_inline, 1);
+
+        qemu_plugin_register_vcpu_mem_inline_indexed_per_vcpu(
+            insn, QEMU_PLUGIN_MEM_RW, QEMU_PLUGIN_INLINE_ADD_U64,
+            mem_buckets, MEM_BUCKET_SHIFT, N_BUCKETS, 1);
+        qemu_plugin_register_vcpu_mem_inline_indexed_per_vcpu(
+            insn, QEMU_PLUGIN_MEM_RW, QEMU_PLUGIN_INLINE_SET_BIT,
+            mem_bitmap, MEM_BITMAP_SHIFT, N_BITS, 0);
+
+        qemu_plugin_register_vcpu_insn_exec_trace(insn, trace, TRACE_INSN);
+        qemu_plugin_register_vcpu_mem_trace(insn, QEMU_PLUGIN_MEM_RW,
+                                            trace, TRACE_MEM);
     }
 }
 
@@ -302,7 +442,24 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
     data_insn = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_insn);
     data_tb = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_tb);
     data_mem = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_mem);
+    count_insn_trace = qemu_plugin_scoreboard_u64_in_struct(
+        counts, CPUCount, count_insn_trace);
+    count_mem_trace = qemu_plugin_scoreboard_u64_in_struct(
+        counts, CPUCount, count_mem_trace);
+    indexed = qemu_plugin_scoreboard_new(sizeof(CPUIndexed));
+    tb_min = qemu_plugin_scoreboard_u64_in_struct(
+        indexed, CPUIndexed, inl.tb_min);
+    tb_max = qemu_plugin_scoreboard_u64_in_struct(
+        indexed, CPUIndexed, inl.tb_max);
+    tb_bitmap = qemu_plugin_scoreboard_u64_in_struct(
+        indexed, CPUIndexed, inl.tb_bitmap);
+    mem_buckets = qemu_plugin_scoreboard_u64_in_struct(
+        indexed, CPUIndexed, inl.mem_buckets);
+    mem_bitmap = qemu_plugin_scoreboard_u64_in_struct(
+        indexed, CPUIndexed, inl.mem_bitmap);
+    trace = qemu_plugin_trace_buffer_new(0, trace_drain, NULL);
 
+    qemu_plugin_register_vcpu_init_cb(id, vcpu_init);
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
     qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
 
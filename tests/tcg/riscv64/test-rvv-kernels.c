@@ -0,0 +1,150 @@
+/*
+ * Check simple RVV kernels against a scalar reference: memcpy, saxpy
+ * and a sum reduction, written as strip-mined vsetvli loops, plus a
+ * whole register spill and fill.  With vlen=256, every kernel uses
+ * register groups of 128 bytes, which QEMU loads and stores inline.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define N  1003
+
+static uint8_t src8[N * 4], dst8[N * 4];
+static float x[N], y[N], ref_y[N];
+static int32_t v32[N];
+
+static void rvv_memcpy(void *d, const void *s, size_t n)
+{
+    size_t vl;
+
+    for (; n > 0; n -= vl, s += vl, d += vl) {
+        asm volatile("vsetvli %0, %1, e8, m4, ta, ma\n\t"
+                     "vle8.v v8, (%2)\n\t"
+                     "vse8.v v8, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(s), "r"(d)
+                     : "v8", "v9", "v10", "v11", "memory");
+    }
+}
+
+static void rvv_saxpy(float *y, const float *x, float a, size_t n)
+{
+    size_t vl;
+
+    for (; n > 0; n -= vl, x += vl, y += vl) {
+        asm volatile("vsetvli %0, %1, e32, m4, ta, ma\n\t"
+                     "vle32.v v8, (%2)\n\t"
+                     "vle32.v v12, (%3)\n\t"
+                     "vfmacc.vf v12, %4, v8\n\t"
+                     "vse32.v v12, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(x), "r"(y), "f"(a)
+                     : "v8", "v9", "v10", "v11",
+                       "v12", "v13", "v14", "v15", "memory");
+    }
+}
+
+static int32_t rvv_sum(const int32_t *p, size_t n)
+{
+    int32_t sum = 0;
+    size_t vl;
+
+    for (; n > 0; n -= vl, p += vl) {
+        asm volatile("vsetvli %0, %2, e32, m4, ta, ma\n\t"
+                     "vle32.v v8, (%3)\n\t"
+                     "vmv.s.x v4, %1\n\t"
+                     "vredsum.vs v4, v8, v4\n\t"
+                     "vmv.x.s %1, v4"
+                     : "=&r"(vl), "+r"(sum) : "r"(n), "r"(p)
+                     : "v4", "v8", "v9", "v10", "v11", "memory");
+    }
+    return sum;
+}
+
+/* Round trip a register group through memory, as in a callee save. */
+static void rvv_spill_fill(void *d, const void *s)
+{
+    asm volatile("vl4re8.v v8, (%0)\n\t"
+                 "vs4r.v v8, (%1)"
+                 : : "r"(s), "r"(d)
+                 : "v8", "v9", "v10", "v11", "memory");
+}
+
+static size_t vlenb(void)
+{
+    size_t r;
+
+    asm("csrr %0, vlenb" : "=r"(r));
+    return r;
+}
+
+static int check_memcpy(void)
+{
+    memset(dst8, 0, sizeof(dst8));
+    rvv_memcpy(dst8, src8, sizeof(src8));
+    return memcmp(dst8, src8, sizeof(src8)) != 0;
+}
+
+static int check_saxpy(void)
+{
+    for (int i = 0; i < N; i++) {
+        y[i] = i * 0.25f - 7.0f;
+        ref_y[i] = fmaf(1.5f, x[i], y[i]);
+    }
+    rvv_saxpy(y, x, 1.5f, N);
+    return memcmp(y, ref_y, sizeof(y)) != 0;
+}
+
+static int check_sum(void)
+{
+    int32_t ref = 0;
+
+    for (int i = 0; i < N; i++) {
+        ref += v32[i];
+    }
+    return rvv_sum(v32, N) != ref;
+}
+
+static int check_spill_fill(void)
+{
+    size_t n = vlenb() * 4;
+
+    memset(dst8, 0, sizeof(dst8));
+    rvv_spill_fill(dst8, src8);
+    return memcmp(dst8, src8, n) != 0 || dst8[n] != 0;
+}
+
+static const struct {
+    const char *name;
+    int (*check)(void);
+} kernels[] = {
+    { "memcpy", check_memcpy },
+    { "saxpy", check_saxpy },
+    { "sum", check_sum },
+    { "spill", check_spill_fill },
+};
+
+int main(void)
+{
+    int err = 0;
+
+    for (int i = 0; i < sizeof(src8); i++) {
+        src8[i] = i * 37 + 11;
+    }
+    for (int i = 0; i < N; i++) {
+        x[i] = i * 0.5f + 1.0f;
+        v32[i] = i * 101 - 5000;
+    }
+
+    for (int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k].check()) {
+            fprintf(stderr, "%s mismatch\n", kernels[k].name);
+            err = 1;
+        }
+    }
+
+    return err;
+}
@@ -16,6 +16,9 @@
 # ifndef HWCAP2_BTI
 #  define HWCAP2_BTI 0  /* added in glibc 2.32 */
 # endif
+# ifndef HWCAP_SHA512
+#  define HWCAP_SHA512 0  /* added in glibc 2.27 */
+# endif
 #endif
 #ifdef CONFIG_ELF_AUX_INFO
 #include <sys/auxv.h>
@@ -70,6 +73,9 @@ unsigned __attribute__((constructor)) cpuinfo_init(void)
     info |= (hwcap & HWCAP_USCAT ? CPUINFO_LSE2 : 0);
     info |= (hwcap & HWCAP_AES ? CPUINFO_AES : 0);
     info |= (hwcap & HWCAP_PMULL ? CPUINFO_PMULL : 0);
+    info |= (hwcap & HWCAP_CRC32 ? CPUINFO_CRC32 : 0);
+    info |= (hwcap & HWCAP_SHA2 ? CPUINFO_SHA256 : 0);
+    info |= (hwcap & HWCAP_SHA512 ? CPUINFO_SHA512 : 0);
 
     unsigned long hwcap2 = qemu_getauxval(AT_HWCAP2);
     info |= (hwcap2 & HWCAP2_BTI ? CPUINFO_BTI : 0);
@@ -80,6 +86,9 @@ unsigned __attribute__((constructor)) cpuinfo_init(void)
     info |= sysctl_for_bool("hw.optional.arm.FEAT_AES") * CPUINFO_AES;
     info |= sysctl_for_bool("hw.optional.arm.FEAT_PMULL") * CPUINFO_PMULL;
     info |= sysctl_for_bool("hw.optional.arm.FEAT_BTI") * CPUINFO_BTI;
+    info |= sysctl_for_bool("hw.optional.armv8_crc32") * CPUINFO_CRC32;
+    info |= sysctl_for_bool("hw.optional.arm.FEAT_SHA256") * CPUINFO_SHA256;
+    info |= sysctl_for_bool("hw.optional.arm.FEAT_SHA512") * CPUINFO_SHA512;
 #endif
 #if defined(__OpenBSD__) && !defined(CONFIG_ELF_AUX_INFO)
     int mib[2];
@@ -100,6 +109,15 @@ unsigned __attribute__((constructor)) cpuinfo_init(void)
         if (ID_AA64ISAR0_AES(isar0) >= ID_AA64ISAR0_AES_PMULL) {
             info |= CPUINFO_PMULL;
         }
+        if (ID_AA64ISAR0_CRC32(isar0) >= ID_AA64ISAR0_CRC32_BASE) {
+            info |= CPUINFO_CRC32;
+        }
+        if (ID_AA64ISAR0_SHA2(isar0) >= ID_AA64ISAR0_SHA2_BASE) {
+            info |= CPUINFO_SHA256;
+        }
+        if (ID_AA64ISAR0_SHA2(isar0) >= ID_AA64ISAR0_SHA2_512) {
+            info |= CPUINFO_SHA512;
+        }
     }
 
     mib[0] = CTL_MACHDEP;
@@ -503,6 +503,8 @@ const QEMULogItem qemu_log_items[] = {
       "open a separate log file per thread; filename must contain '%d'" },
     { CPU_LOG_TB_VPU, "vpu",
       "include VPU registers in the 'cpu' logging" },
+    { CPU_LOG_TB_CACHE, "tb_cache",
+      "user mode only: show the persistent TB cache statistics at exit" },
     { 0, NULL, NULL },
 };
 